@@ -34,28 +34,63 @@ BufferPoolManager::~BufferPoolManager() {
   delete replacer_;
 }
 
+void BufferPoolManager::WritePage(Page *page) {
+  // Write-ahead: the log records of the changes to the page reach the disk before the page does
+  if (enable_logging && log_manager_ != nullptr && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+    log_manager_->Flush(page->GetLSN());
+  }
+  disk_manager_->WritePage(page->GetPageId(), page->GetData());
+}
+
+void BufferPoolManager::SetRecLSN(Page *page) {
+  // Any change made while the page is pinned gets a later lsn than this
+  if (page->rec_lsn_ == INVALID_LSN && enable_logging && log_manager_ != nullptr) {
+    page->rec_lsn_ = log_manager_->GetNextLSN();
+  }
+}
+
 frame_id_t BufferPoolManager::GetAvailablePage() {
   frame_id_t frame_id;
   Page *page_ptr;
 
-  if (!free_list_.empty()) {
-    frame_id = free_list_.front();
-    free_list_.pop_front();
+  while (true) {
+    if (!free_list_.empty()) {
+      frame_id = free_list_.front();
+      free_list_.pop_front();
 
-    return frame_id;
-  }
+      return frame_id;
+    }
 
-  if (replacer_->Size() > 0) {
+    if (replacer_->Size() == 0) {
+      break;
+    }
     replacer_->Victim(&frame_id);
     page_ptr = GetPage(frame_id);
     page_id_t replace_page_id = page_ptr->GetPageId();
 
-    if (page_ptr->IsDirty()) {
-      disk_manager_->WritePage(replace_page_id, page_ptr->GetData());
+    if (!page_ptr->IsDirty()) {
+      page_table_.erase(replace_page_id);
+      return frame_id;
     }
-    page_table_.erase(replace_page_id);
 
-    return frame_id;
+    // Write-ahead may wait for a log flush, so the victim is written without the latch. It stays pinned and in the
+    // page table meanwhile: it is not picked twice, and a fetch of it finds it here rather than stale on disk.
+    page_ptr->AddPinCount();
+    page_ptr->SetDirty(false);
+    latch_.unlock();
+    page_ptr->RLatch();
+    WritePage(page_ptr);
+    page_ptr->RUnlatch();
+    latch_.lock();
+
+    // Fetched or changed again meanwhile, the page stays and another victim is picked
+    if (page_ptr->SubPinCount() == 0 && !page_ptr->IsDirty()) {
+      page_table_.erase(replace_page_id);
+      return frame_id;
+    }
+    if (page_ptr->GetPinCount() == 0) {
+      replacer_->Unpin(frame_id);
+    }
   }
 
   LOG_DEBUG("--Out of memory!\n");
@@ -84,7 +119,9 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
   if (frame_id != INVALID_FRAME_ID) {
     page_ptr = GetPage(frame_id);
     page_ptr->AddPinCount();
+    page_ptr->fetch_count_++;
     replacer_->Pin(frame_id);
+    SetRecLSN(page_ptr);
 
     latch_.unlock();
     return page_ptr;
@@ -96,11 +133,29 @@ Page *BufferPoolManager::FetchPageImpl(page_id_t page_id) {
     return nullptr;
   }
 
+  // Another thread may have read in the page while the victim was written back
+  frame_id_t loaded_frame_id = GetFrame(page_id);
+  if (loaded_frame_id != INVALID_FRAME_ID) {
+    GetPage(frame_id)->Reset();
+    free_list_.push_front(frame_id);
+    page_ptr = GetPage(loaded_frame_id);
+    page_ptr->AddPinCount();
+    page_ptr->fetch_count_++;
+    replacer_->Pin(loaded_frame_id);
+    SetRecLSN(page_ptr);
+
+    latch_.unlock();
+    return page_ptr;
+  }
+
   page_table_.insert({page_id, frame_id});
   page_ptr = GetPage(frame_id);
   page_ptr->SetPageId(page_id);
   page_ptr->SetPinCount(1);
   page_ptr->SetDirty(false);
+  page_ptr->fetch_count_ = 1;
+  page_ptr->rec_lsn_ = INVALID_LSN;
+  SetRecLSN(page_ptr);
   disk_manager_->ReadPage(page_id, page_ptr->GetData());
 
   latch_.unlock();
@@ -127,6 +182,9 @@ bool BufferPoolManager::UnpinPageImpl(page_id_t page_id, bool is_dirty) {
   pin_count = page_ptr->SubPinCount();
   if (pin_count == 0) {
     replacer_->Unpin(frame_id);
+    if (!page_ptr->IsDirty()) {
+      page_ptr->rec_lsn_ = INVALID_LSN;
+    }
   }
 
   latch_.unlock();
@@ -150,7 +208,7 @@ bool BufferPoolManager::FlushPageImpl(page_id_t page_id) {
   Page *page_ptr = GetPage(frame_id);
 
   if (page_ptr->IsDirty()) {
-    disk_manager_->WritePage(page_id, page_ptr->GetData());
+    WritePage(page_ptr);
   }
 
   page_ptr->Reset();
@@ -182,6 +240,7 @@ Page *BufferPoolManager::NewPageImpl(page_id_t *page_id) {
   page_ptr->Reset();
   page_ptr->SetPageId(new_page_id);
   page_ptr->SetPinCount(1);
+  SetRecLSN(page_ptr);
 
   page_table_.insert({new_page_id, frame_id});
 
@@ -233,6 +292,59 @@ void BufferPoolManager::FlushAllPagesImpl() {
   }
 }
 
+void BufferPoolManager::GetDirtyPageTable(std::vector<std::pair<page_id_t, lsn_t>> *dirty_pages) {
+  std::lock_guard<std::mutex> guard(latch_);
+  for (const auto &[page_id, frame_id] : page_table_) {
+    Page *page_ptr = GetPage(frame_id);
+    if (page_ptr->rec_lsn_ != INVALID_LSN) {
+      dirty_pages->emplace_back(page_id, page_ptr->rec_lsn_);
+    } else if (page_ptr->IsDirty()) {
+      // Changed while logging was off, redo has to start from the beginning of the log for it
+      dirty_pages->emplace_back(page_id, 0);
+    }
+  }
+}
+
+size_t BufferPoolManager::GetFetchCount(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  frame_id_t frame_id = GetFrame(page_id);
+  return frame_id == INVALID_FRAME_ID ? 0 : GetPage(frame_id)->fetch_count_;
+}
+
+bool BufferPoolManager::WriteBackPage(page_id_t page_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  latch_.lock();
+
+  frame_id_t frame_id = GetFrame(page_id);
+  if (frame_id == INVALID_FRAME_ID) {
+    latch_.unlock();
+    return false;
+  }
+  Page *page_ptr = GetPage(frame_id);
+  if (!page_ptr->IsDirty()) {
+    latch_.unlock();
+    return true;
+  }
+  page_ptr->AddPinCount();
+  replacer_->Pin(frame_id);
+  latch_.unlock();
+
+  // The read latch keeps the page from changing while it is written, without holding up the rest of the buffer pool
+  page_ptr->RLatch();
+  WritePage(page_ptr);
+  latch_.lock();
+  page_ptr->SetDirty(false);
+  page_ptr->rec_lsn_ = INVALID_LSN;
+  if (page_ptr->GetPinCount() > 1) {
+    SetRecLSN(page_ptr);
+  }
+  latch_.unlock();
+  page_ptr->RUnlatch();
+
+  UnpinPageImpl(page_id, false);
+  return true;
+}
+
 void BufferPoolManager::PrintOut() {
   LOG_DEBUG("\n  pool_size_:%zu", pool_size_);
   LOG_DEBUG("\n  replacer size:%zu", replacer_->Size());
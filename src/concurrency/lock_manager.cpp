@@ -18,112 +18,219 @@
 
 namespace bustub {
 
-bool LockManager::LockPrepare(Transaction *txn, const RID &rid) {
+LockManager::LockRequestQueue *LockManager::LockPrepare(Transaction *txn, LockTableShard *shard, const RID &rid) {
+  // A wounded transaction learns about it on its next lock request
+  if (txn->GetState() == TransactionState::ABORTED){
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    return nullptr;
+  }
   if (txn->GetState() == TransactionState::SHRINKING){
     txn->SetState(TransactionState::ABORTED);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
-    return false;
+    return nullptr;
   }
+  return FindOrCreateQueue(shard, rid);
+}
 
-  if (lock_table_.find(rid) == lock_table_.end()){
-    lock_table_.emplace(std::piecewise_construct,
-                        std::forward_as_tuple(rid),
-                        std::forward_as_tuple());
+LockManager::LockRequestQueue *LockManager::FindOrCreateQueue(LockTableShard *shard, const RID &rid) {
+  auto iter = shard->lock_table_.find(rid);
+  if (iter != shard->lock_table_.end()){
+    return &iter->second;
   }
-  return true;
+  // Reuse the map node of a queue dropped earlier instead of allocating one
+  if (!shard->free_queues_.empty()){
+    RowLockTable::node_type node = std::move(shard->free_queues_.back());
+    shard->free_queues_.pop_back();
+    node.key() = rid;
+    node.mapped().Reset();
+    return &shard->lock_table_.insert(std::move(node)).position->second;
+  }
+  return &shard->lock_table_.emplace(std::piecewise_construct,
+                                     std::forward_as_tuple(rid),
+                                     std::forward_as_tuple()).first->second;
 }
 
-std::list<LockManager::LockRequest>::iterator LockManager::GetIterator(std::list<LockRequest> &request_queue, txn_id_t txn_id) {
-  for (auto iter = request_queue.begin(); iter != request_queue.end(); ++iter){
-    if (iter->txn_id_ == txn_id){
-      return iter;
+LockRequest *LockManager::NewRequest(LockTableShard *shard, txn_id_t txn_id, LockMode lock_mode) {
+  if (shard->free_requests_ == nullptr){
+    auto chunk = std::make_unique<LockRequest[]>(REQUEST_CHUNK_SIZE);
+    for (size_t i = 0; i < REQUEST_CHUNK_SIZE; i++){
+      chunk[i].next_ = shard->free_requests_;
+      shard->free_requests_ = &chunk[i];
     }
+    shard->request_chunks_.push_back(std::move(chunk));
   }
-  return request_queue.end();
+  LockRequest *request = shard->free_requests_;
+  shard->free_requests_ = request->next_;
+  request->txn_id_ = txn_id;
+  request->lock_mode_ = lock_mode;
+  request->granted_ = false;
+  return request;
 }
 
-void LockManager::check_aborted(Transaction *txn, LockRequestQueue* request_queue) {
+void LockManager::FreeRequest(LockTableShard *shard, const RID &rid, LockRequestQueue *request_queue,
+                              LockRequest *request) {
+  request_queue->Remove(request);
+  request->next_ = shard->free_requests_;
+  shard->free_requests_ = request;
+
+  // Nobody holds or waits for this RID any more, so nobody waits on the condition variable either
+  if (request_queue->IsEmpty()){
+    if (shard->free_queues_.size() < MAX_FREE_QUEUES){
+      shard->free_queues_.push_back(shard->lock_table_.extract(rid));
+    } else {
+      shard->lock_table_.erase(rid);
+    }
+  }
+}
+
+void LockManager::check_aborted(Transaction *txn, LockTableShard *shard, const RID &rid, LockRequest *request) {
   if (txn->GetState() == TransactionState::ABORTED){
-    auto iter = GetIterator(request_queue->request_queue_, txn->GetTransactionId());
-    request_queue->request_queue_.erase(iter);
+    FreeRequest(shard, rid, GetQueue(rid), request);
     throw TransactionAbortException(txn->GetTransactionId(),
                                     AbortReason::DEADLOCK);
   }
 }
 
 bool LockManager::LockShared(Transaction *txn, const RID &rid) {
-  std::unique_lock<std::mutex> lock(latch_);
+  LockTableShard *shard = GetShard(rid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
 
   if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED){
     txn->SetState(TransactionState::ABORTED);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
     return false;
   }
-  if (!LockPrepare(txn, rid)){
-    return false;
-  }
 
-  LockRequestQueue* request_queue = &lock_table_.find(rid)->second;
-  request_queue->request_queue_.emplace_back(txn->GetTransactionId(),
-                                             LockMode::SHARED);
+  LockRequestQueue* request_queue = LockPrepare(txn, shard, rid);
+  LockRequest *request = NewRequest(shard, txn->GetTransactionId(), LockMode::SHARED);
+  request_queue->Append(request);
 
+  // Fast path, nobody writes this RID (e.g. the queue was just created) so the lock is granted
+  // right away, and the request came from the pool so nothing was allocated
   if (request_queue->is_writing_){
-    request_queue->cv_.wait(lock,
-                            [request_queue, txn]()
-                                ->bool{return txn->GetState() == TransactionState::ABORTED ||
-                                                 !request_queue->is_writing_;}
-                            );
+    WaitUntil(txn, &lock, &request_queue->cv_, WaitTarget{false, rid, 0},
+              [request_queue]()->bool{return !request_queue->is_writing_;},
+              [request_queue, request]()->std::vector<txn_id_t>{return GetBlockers(request_queue, request);});
   }
 
-  check_aborted(txn, request_queue);
+  check_aborted(txn, shard, rid, request);
 
-  txn->GetSharedLockSet()->emplace(rid);
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    txn->GetSharedLockSet()->emplace(rid, request);
+  }
   request_queue->sharing_count_++;
-  auto iter = GetIterator(request_queue->request_queue_, txn->GetTransactionId());
-  iter->granted_ = true;
+  request->granted_ = true;
+
+  // Granted ahead of waiting writers, they now wait for this txn too and must apply the deadlock
+  // policy to it
+  for (LockRequest *waiting = request_queue->head_; waiting != nullptr; waiting = waiting->next_){
+    if (!waiting->granted_){
+      request_queue->cv_.notify_all();
+      break;
+    }
+  }
 
   return true;
 }
 
-bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
-  std::unique_lock<std::mutex> lock(latch_);
+bool LockManager::TryLockShared(Transaction *txn, const RID &rid) {
+  LockTableShard *shard = GetShard(rid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
 
-  if (!LockPrepare(txn, rid)){
+  if (txn->GetState() != TransactionState::GROWING
+      || txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED){
     return false;
   }
+  auto iter = shard->lock_table_.find(rid);
+  if (iter != shard->lock_table_.end() && iter->second.is_writing_){
+    return false;
+  }
+  LockRequestQueue* request_queue = FindOrCreateQueue(shard, rid);
+  LockRequest *request = NewRequest(shard, txn->GetTransactionId(), LockMode::SHARED);
+  request_queue->Append(request);
+
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    txn->GetSharedLockSet()->emplace(rid, request);
+  }
+  request_queue->sharing_count_++;
+  request->granted_ = true;
+
+  // Same as LockShared, waiting writers now wait for this txn too
+  for (LockRequest *waiting = request_queue->head_; waiting != nullptr; waiting = waiting->next_){
+    if (!waiting->granted_){
+      request_queue->cv_.notify_all();
+      break;
+    }
+  }
+
+  return true;
+}
 
-  LockRequestQueue* request_queue = &lock_table_.find(rid)->second;
-  request_queue->request_queue_.emplace_back(txn->GetTransactionId(),
-                                             LockMode::EXCLUSIVE);
+bool LockManager::LockExclusive(Transaction *txn, const RID &rid) {
+  LockTableShard *shard = GetShard(rid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
+
+  LockRequestQueue* request_queue = LockPrepare(txn, shard, rid);
+  LockRequest *request = NewRequest(shard, txn->GetTransactionId(), LockMode::EXCLUSIVE);
+  request_queue->Append(request);
 
   if (request_queue->is_writing_ || request_queue->sharing_count_ > 0){
-    request_queue->cv_.wait(lock,
-                            [request_queue, txn]()
-                                ->bool{ return txn->GetState() == TransactionState::ABORTED ||
-                                                 (!request_queue->is_writing_ && request_queue->sharing_count_ == 0);}
-                            );
+    WaitUntil(txn, &lock, &request_queue->cv_, WaitTarget{false, rid, 0},
+              [request_queue]()->bool{return !request_queue->is_writing_ && request_queue->sharing_count_ == 0;},
+              [request_queue, request]()->std::vector<txn_id_t>{return GetBlockers(request_queue, request);});
+  }
+
+  check_aborted(txn, shard, rid, request);
+
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    txn->GetExclusiveLockSet()->emplace(rid, request);
   }
+  request_queue->is_writing_ = true;
+  request->granted_ = true;
 
-  check_aborted(txn, request_queue);
+  return true;
+}
+
+bool LockManager::TryLockExclusive(Transaction *txn, const RID &rid) {
+  LockTableShard *shard = GetShard(rid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
+
+  // A RID has a queue as long as someone holds or waits for a lock on it
+  if (txn->GetState() != TransactionState::GROWING || shard->lock_table_.count(rid) != 0){
+    return false;
+  }
+  LockRequestQueue* request_queue = FindOrCreateQueue(shard, rid);
+  LockRequest *request = NewRequest(shard, txn->GetTransactionId(), LockMode::EXCLUSIVE);
+  request_queue->Append(request);
 
-  txn->GetExclusiveLockSet()->emplace(rid);
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    txn->GetExclusiveLockSet()->emplace(rid, request);
+  }
   request_queue->is_writing_ = true;
-  auto iter = GetIterator(request_queue->request_queue_, txn->GetTransactionId());
-  iter->granted_ = true;
+  request->granted_ = true;
 
   return true;
 }
 
 bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
-  std::unique_lock<std::mutex> lock(latch_);
+  LockTableShard *shard = GetShard(rid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
 
+  if (txn->GetState() == TransactionState::ABORTED){
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    return false;
+  }
   if (txn->GetState() == TransactionState::SHRINKING){
     txn->SetState(TransactionState::ABORTED);
     throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
     return false;
   }
 
-  LockRequestQueue* request_queue = &lock_table_.find(rid)->second;
+  LockRequestQueue* request_queue = GetQueue(rid);
 
   if (request_queue->upgrading_){
     txn->SetState(TransactionState::ABORTED);
@@ -131,47 +238,56 @@ bool LockManager::LockUpgrade(Transaction *txn, const RID &rid) {
     return false;
   }
 
-  txn->GetSharedLockSet()->erase(rid);
+  LockRequest *request;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    request = txn->GetLockRequest(rid);
+    txn->GetSharedLockSet()->erase(rid);
+  }
   request_queue->sharing_count_--;
-  auto iter = GetIterator(request_queue->request_queue_, txn->GetTransactionId());
-  iter->lock_mode_ = LockMode::EXCLUSIVE;
-  iter->granted_ = false;
+  request->lock_mode_ = LockMode::EXCLUSIVE;
+  request->granted_ = false;
 
   if (request_queue->is_writing_ || request_queue->sharing_count_ > 0){
     request_queue->upgrading_ = true;
-    request_queue->cv_.wait(lock,
-                            [request_queue, txn]()
-                                ->bool{return txn->GetState() == TransactionState::ABORTED ||
-                                                 (!request_queue->is_writing_ && request_queue->sharing_count_ == 0);}
-                            );
+    WaitUntil(txn, &lock, &request_queue->cv_, WaitTarget{false, rid, 0},
+              [request_queue]()->bool{return !request_queue->is_writing_ && request_queue->sharing_count_ == 0;},
+              [request_queue, request]()->std::vector<txn_id_t>{return GetBlockers(request_queue, request);});
+    request_queue->upgrading_ = false;
   }
 
-  check_aborted(txn, request_queue);
+  check_aborted(txn, shard, rid, request);
 
-  txn->GetExclusiveLockSet()->emplace(rid);
-  request_queue->upgrading_ = false;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    txn->GetExclusiveLockSet()->emplace(rid, request);
+  }
   request_queue->is_writing_ = true;
-  iter = GetIterator(request_queue->request_queue_, txn->GetTransactionId());
-  iter->granted_ = true;
+  request->granted_ = true;
 
   return true;
 }
 
 bool LockManager::Unlock(Transaction *txn, const RID &rid) {
-  std::unique_lock<std::mutex> lock(latch_);
-
-  LockRequestQueue* request_queue = &lock_table_.find(rid)->second;
-
-  txn->GetSharedLockSet()->erase(rid);
-  txn->GetExclusiveLockSet()->erase(rid);
+  LockTableShard *shard = GetShard(rid);
+  std::unique_lock<std::mutex> lock(shard->latch_);
+
+  LockRequest *request;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    request = txn->GetLockRequest(rid);
+    if (request == nullptr){
+      return false;
+    }
+    txn->GetSharedLockSet()->erase(rid);
+    txn->GetExclusiveLockSet()->erase(rid);
+  }
+  LockRequestQueue* request_queue = GetQueue(rid);
 
-  auto iter = GetIterator(request_queue->request_queue_, txn->GetTransactionId());
-  LockMode mode = iter->lock_mode_;
-  request_queue->request_queue_.erase(iter);
+  LockMode mode = request->lock_mode_;
 
-  if (!(mode == LockMode::SHARED && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED)
-      && txn->GetState() == TransactionState::GROWING){
-    txn->SetState(TransactionState::SHRINKING);
+  if (!(mode == LockMode::SHARED && txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED)){
+    txn->CompareAndSetState(TransactionState::GROWING, TransactionState::SHRINKING);
   }
 
   if (mode == LockMode::SHARED){
@@ -184,82 +300,417 @@ bool LockManager::Unlock(Transaction *txn, const RID &rid) {
     request_queue->cv_.notify_all();
   }
 
+  if (deadlock_mode_ == DeadlockMode::DETECTION){
+    std::vector<txn_id_t> waiters;
+    for (LockRequest *waiting = request_queue->head_; waiting != nullptr; waiting = waiting->next_){
+      if (!waiting->granted_){
+        waiters.push_back(waiting->txn_id_);
+      }
+    }
+    ReleaseWaiters(waiters, txn->GetTransactionId());
+  }
+  FreeRequest(shard, rid, request_queue, request);
+
   return true;
 }
 
-void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
-  waits_for_[t1].push_back(t2);
+bool LockManager::Covers(LockMode held, LockMode requested) {
+  switch (held){
+    case LockMode::EXCLUSIVE:
+      return true;
+    case LockMode::SHARED_INTENTION_EXCLUSIVE:
+      return requested != LockMode::EXCLUSIVE;
+    case LockMode::SHARED:
+      return requested == LockMode::SHARED || requested == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_EXCLUSIVE:
+      return requested == LockMode::INTENTION_EXCLUSIVE || requested == LockMode::INTENTION_SHARED;
+    case LockMode::INTENTION_SHARED:
+      return requested == LockMode::INTENTION_SHARED;
+  }
+  return false;
 }
 
-void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
-  auto iter = std::find(waits_for_[t1].begin(), waits_for_[t1].end(), t1);
-  if (iter != waits_for_[t1].end()){
-    waits_for_[t1].erase(iter);
+bool LockManager::AreCompatible(LockMode granted, LockMode requested) {
+  if (granted == LockMode::EXCLUSIVE || requested == LockMode::EXCLUSIVE){
+    return false;
   }
+  // IS gets along with everything but X, the other modes each conflict with everything but IS,
+  // except that IX gets along with IX and S with S
+  if (granted == LockMode::INTENTION_SHARED || requested == LockMode::INTENTION_SHARED){
+    return true;
+  }
+  return granted == requested && granted != LockMode::SHARED_INTENTION_EXCLUSIVE;
 }
 
-void LockManager::DeleteNode(txn_id_t txn_id) {
-  waits_for_.erase(txn_id);
-  Transaction* txn = TransactionManager::GetTransaction(txn_id);
+bool LockManager::LockTable(Transaction *txn, table_oid_t oid, LockMode lock_mode) {
+  std::unique_lock<std::mutex> lock(table_latch_);
 
-  for (RID const &lock_rid : *(txn->GetSharedLockSet())){
-    for (LockRequest const &lock_request : lock_table_[lock_rid].request_queue_){
-      if (!lock_request.granted_){
-        RemoveEdge(lock_request.txn_id_, txn_id);
-      }
+  if (txn->GetState() == TransactionState::ABORTED){
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::DEADLOCK);
+    return false;
+  }
+  if (txn->GetState() == TransactionState::SHRINKING){
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
+    return false;
+  }
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED && lock_mode != LockMode::EXCLUSIVE
+      && lock_mode != LockMode::INTENTION_EXCLUSIVE){
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED);
+    return false;
+  }
+
+  LockMode held;
+  bool is_held;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    is_held = txn->IsTableLocked(oid, &held);
+  }
+  if (is_held && Covers(held, lock_mode)){
+    return true;
+  }
+  // Upgrade to the least mode covering both, the only combination covered by neither side
+  // is S with IX (or SIX), which makes SIX
+  if (is_held && !Covers(lock_mode, held)){
+    lock_mode = lock_mode == LockMode::EXCLUSIVE ? LockMode::EXCLUSIVE : LockMode::SHARED_INTENTION_EXCLUSIVE;
+  }
+
+  txn_id_t txn_id = txn->GetTransactionId();
+  TableLockQueue *queue = &table_lock_table_[oid];
+  if (!GetBlockers(queue, txn_id, lock_mode).empty()){
+    queue->waiting_[txn_id] = lock_mode;
+    WaitUntil(txn, &lock, &queue->cv_, WaitTarget{true, RID(), oid},
+              [queue, txn_id, lock_mode]()->bool{return GetBlockers(queue, txn_id, lock_mode).empty();},
+              [queue, txn_id, lock_mode]()->std::vector<txn_id_t>{return GetBlockers(queue, txn_id, lock_mode);});
+    queue->waiting_.erase(txn_id);
+  }
+
+  if (txn->GetState() == TransactionState::ABORTED){
+    if (queue->granted_.empty() && queue->waiting_.empty()){
+      table_lock_table_.erase(oid);
     }
+    throw TransactionAbortException(txn_id, AbortReason::DEADLOCK);
   }
 
-  for (RID const &lock_rid : *(txn->GetExclusiveLockSet())){
-    for (LockRequest const &lock_request : lock_table_[lock_rid].request_queue_){
-      if (!lock_request.granted_){
-        RemoveEdge(lock_request.txn_id_, txn_id);
-      }
+  queue->granted_[txn_id] = lock_mode;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    (*txn->GetTableLockSet())[oid] = lock_mode;
+  }
+  // Same as for shared row locks, the waiters may now also wait for this txn
+  if (!queue->waiting_.empty()){
+    queue->cv_.notify_all();
+  }
+  return true;
+}
+
+bool LockManager::UnlockTable(Transaction *txn, table_oid_t oid) {
+  std::unique_lock<std::mutex> lock(table_latch_);
+
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    if (txn->GetTableLockSet()->erase(oid) == 0){
+      return false;
+    }
+  }
+  txn->CompareAndSetState(TransactionState::GROWING, TransactionState::SHRINKING);
+
+  auto iter = table_lock_table_.find(oid);
+  iter->second.granted_.erase(txn->GetTransactionId());
+  if (iter->second.granted_.empty() && iter->second.waiting_.empty()){
+    table_lock_table_.erase(iter);
+    return true;
+  }
+  iter->second.cv_.notify_all();
+  if (deadlock_mode_ == DeadlockMode::DETECTION){
+    std::vector<txn_id_t> waiters;
+    for (auto const &waiting : iter->second.waiting_){
+      waiters.push_back(waiting.first);
+    }
+    ReleaseWaiters(waiters, txn->GetTransactionId());
+  }
+  return true;
+}
+
+bool LockManager::LockRowShared(Transaction *txn, table_oid_t oid, const RID &rid) {
+  LockMode table_mode;
+  bool is_table_locked;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    is_table_locked = txn->IsTableLocked(oid, &table_mode);
+    if ((is_table_locked && Covers(table_mode, LockMode::SHARED))
+        || txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)){
+      return true;
     }
   }
+  if (!is_table_locked){
+    LockTable(txn, oid, LockMode::INTENTION_SHARED);
+  }
 
+  // Under READ_COMMITTED shared row locks are released right after the read, they never pile up
+  bool escalate = false;
+  if (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ){
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    escalate = txn->AddRowLock(oid) > LOCK_ESCALATION_THRESHOLD;
+  }
+  if (escalate){
+    return LockTable(txn, oid, LockMode::SHARED);
+  }
+  return LockShared(txn, rid);
 }
 
-bool LockManager::dfs(txn_id_t txn_id) {
-  if (safe_set_.find(txn_id) != safe_set_.end()){
+bool LockManager::TryLockRowShared(Transaction *txn, table_oid_t oid, const RID &rid) {
+  bool repeatable = txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    LockMode table_mode;
+    bool is_table_locked = txn->IsTableLocked(oid, &table_mode);
+    if ((is_table_locked && Covers(table_mode, LockMode::SHARED))
+        || txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid)){
+      return true;
+    }
+    if (!is_table_locked || (repeatable && txn->GetRowLockCount(oid) >= LOCK_ESCALATION_THRESHOLD)){
+      return false;
+    }
+  }
+  if (!TryLockShared(txn, rid)){
     return false;
   }
-  active_set_.insert(txn_id);
+  if (repeatable){
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    txn->AddRowLock(oid);
+  }
+  return true;
+}
 
-  std::vector<txn_id_t> &next_node_vector = waits_for_[txn_id];
-  std::sort(next_node_vector.begin(), next_node_vector.end());
-  for (txn_id_t const next_node : next_node_vector){
-    if (active_set_.find(next_node) != active_set_.end()){
+bool LockManager::LockRowExclusive(Transaction *txn, table_oid_t oid, const RID &rid) {
+  LockMode table_mode;
+  bool is_table_locked;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    is_table_locked = txn->IsTableLocked(oid, &table_mode);
+    if ((is_table_locked && table_mode == LockMode::EXCLUSIVE) || txn->IsExclusiveLocked(rid)){
       return true;
     }
-    if (dfs(next_node)){
-      return true;
+  }
+  if (!is_table_locked || !Covers(table_mode, LockMode::INTENTION_EXCLUSIVE)){
+    LockTable(txn, oid, LockMode::INTENTION_EXCLUSIVE);
+  }
+
+  bool escalate;
+  bool upgrade;
+  {
+    std::scoped_lock set_latch(txn->GetLockSetLatch());
+    escalate = txn->AddRowLock(oid) > LOCK_ESCALATION_THRESHOLD;
+    upgrade = txn->IsSharedLocked(rid);
+  }
+  if (escalate){
+    return LockTable(txn, oid, LockMode::EXCLUSIVE);
+  }
+  if (upgrade){
+    return LockUpgrade(txn, rid);
+  }
+  return LockExclusive(txn, rid);
+}
+
+std::vector<txn_id_t> LockManager::GetBlockers(LockRequestQueue *request_queue, LockRequest *request) {
+  std::vector<txn_id_t> blockers;
+  for (LockRequest *granted = request_queue->head_; granted != nullptr; granted = granted->next_){
+    if (granted->granted_ && granted != request
+        && (granted->lock_mode_ == LockMode::EXCLUSIVE || request->lock_mode_ == LockMode::EXCLUSIVE)){
+      blockers.push_back(granted->txn_id_);
     }
   }
+  return blockers;
+}
 
-  active_set_.erase(txn_id);
-  safe_set_.insert(txn_id);
-  return false;
+std::vector<txn_id_t> LockManager::GetBlockers(TableLockQueue *queue, txn_id_t txn_id, LockMode lock_mode) {
+  std::vector<txn_id_t> blockers;
+  for (auto const &granted : queue->granted_){
+    if (granted.first != txn_id && !AreCompatible(granted.second, lock_mode)){
+      blockers.push_back(granted.first);
+    }
+  }
+  return blockers;
 }
 
-bool LockManager::HasCycle(txn_id_t *txn_id) {
-  for (auto const &start_txn_id : txn_set_){
-    if (dfs(start_txn_id)){
-      *txn_id = *active_set_.begin();
-      for (auto const &active_txn_id : active_set_){
-        *txn_id = std::max(*txn_id, active_txn_id);
+void LockManager::WaitUntil(Transaction *txn, std::unique_lock<std::mutex> *lock, std::condition_variable *cv,
+                            const WaitTarget &target, const std::function<bool()> &ready,
+                            const std::function<std::vector<txn_id_t>()> &blockers) {
+  // The blockers change while we sleep (new sharers get in ahead of us, holders leave), so the
+  // policy is applied again each time we are woken up and still cannot go
+  while (txn->GetState() != TransactionState::ABORTED && !ready()){
+    std::vector<txn_id_t> aborted = Block(txn, blockers(), target);
+    if (!aborted.empty()){
+      lock->unlock();
+      Wake(aborted);
+      lock->lock();
+      continue;
+    }
+    if (txn->GetState() == TransactionState::ABORTED){
+      break;
+    }
+    cv->wait(*lock);
+  }
+  Unblock(txn->GetTransactionId());
+}
+
+std::vector<txn_id_t> LockManager::Block(Transaction *txn, const std::vector<txn_id_t> &blockers,
+                                         const WaitTarget &target) {
+  std::scoped_lock graph_lock(graph_latch_);
+  txn_id_t txn_id = txn->GetTransactionId();
+  std::vector<txn_id_t> aborted;
+
+  switch (deadlock_mode_){
+    case DeadlockMode::DETECTION: {
+      // The graph had no cycle before, so a new one must go through txn, no need to look elsewhere
+      waits_for_[txn_id] = blockers;
+      txn_id_t victim;
+      if (FindCycle(txn_id, &victim)){
+        TransactionManager::GetTransaction(victim)->SetState(TransactionState::ABORTED);
+        waits_for_.erase(victim);
+        if (victim != txn_id){
+          aborted.push_back(victim);
+        }
+      }
+      break;
+    }
+    case DeadlockMode::WOUND_WAIT:
+      for (txn_id_t blocker : blockers){
+        Transaction *blocker_txn = TransactionManager::GetTransaction(blocker);
+        // A blocker that has just committed is gone from the registry, there is nothing to wound. One that is
+        // committing keeps its COMMITTED state, the compare and set only aborts a running transaction.
+        if (blocker > txn_id && blocker_txn != nullptr
+            && (blocker_txn->CompareAndSetState(TransactionState::GROWING, TransactionState::ABORTED)
+                || blocker_txn->CompareAndSetState(TransactionState::SHRINKING, TransactionState::ABORTED))){
+          aborted.push_back(blocker);
+        }
+      }
+      break;
+    case DeadlockMode::WAIT_DIE:
+      for (txn_id_t blocker : blockers){
+        if (blocker < txn_id){
+          txn->SetState(TransactionState::ABORTED);
+          break;
+        }
+      }
+      break;
+  }
+
+  waiting_on_[txn_id] = target;
+  return aborted;
+}
+
+void LockManager::Unblock(txn_id_t txn_id) {
+  std::scoped_lock graph_lock(graph_latch_);
+  waits_for_.erase(txn_id);
+  waiting_on_.erase(txn_id);
+}
+
+void LockManager::Wake(const std::vector<txn_id_t> &txn_ids) {
+  for (txn_id_t txn_id : txn_ids){
+    WaitTarget target{};
+    {
+      std::scoped_lock graph_lock(graph_latch_);
+      auto iter = waiting_on_.find(txn_id);
+      if (iter == waiting_on_.end()){
+        continue;
+      }
+      target = iter->second;
+    }
+
+    // The txn may have left in the meantime, taking its queue with it
+    if (target.is_table_){
+      std::scoped_lock lock(table_latch_);
+      auto iter = table_lock_table_.find(target.oid_);
+      if (iter != table_lock_table_.end()){
+        iter->second.cv_.notify_all();
+      }
+    } else {
+      LockTableShard *shard = GetShard(target.rid_);
+      std::scoped_lock lock(shard->latch_);
+      auto iter = shard->lock_table_.find(target.rid_);
+      if (iter != shard->lock_table_.end()){
+        iter->second.cv_.notify_all();
+      }
+    }
+  }
+}
+
+void LockManager::ReleaseWaiters(const std::vector<txn_id_t> &waiters, txn_id_t txn_id) {
+  if (waiters.empty()){
+    return;
+  }
+  std::scoped_lock graph_lock(graph_latch_);
+  for (txn_id_t waiter : waiters){
+    DropEdge(waiter, txn_id);
+  }
+}
+
+void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
+  std::scoped_lock graph_lock(graph_latch_);
+  waits_for_[t1].push_back(t2);
+}
+
+void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
+  std::scoped_lock graph_lock(graph_latch_);
+  DropEdge(t1, t2);
+}
+
+void LockManager::DropEdge(txn_id_t t1, txn_id_t t2) {
+  auto edges = waits_for_.find(t1);
+  if (edges == waits_for_.end()){
+    return;
+  }
+  auto iter = std::find(edges->second.begin(), edges->second.end(), t2);
+  if (iter != edges->second.end()){
+    edges->second.erase(iter);
+  }
+}
+
+bool LockManager::FindCycle(txn_id_t start, txn_id_t *victim) {
+  // Iterative dfs, the path holds each node with the index of the next edge to follow
+  std::unordered_set<txn_id_t> visited{start};
+  std::vector<std::pair<txn_id_t, size_t>> path{{start, 0}};
+  while (!path.empty()){
+    auto edges = waits_for_.find(path.back().first);
+    if (edges == waits_for_.end() || path.back().second >= edges->second.size()){
+      path.pop_back();
+      continue;
+    }
+    txn_id_t next_node = edges->second[path.back().second++];
+    if (next_node == start){
+      *victim = start;
+      for (auto const &node : path){
+        *victim = std::max(*victim, node.first);
       }
-      active_set_.clear();
       return true;
     }
+    if (visited.insert(next_node).second){
+      path.emplace_back(next_node, 0);
+    }
+  }
+  return false;
+}
 
-    active_set_.clear();
-    txn_set_.erase(start_txn_id);
+bool LockManager::HasCycle(txn_id_t *txn_id) {
+  std::scoped_lock graph_lock(graph_latch_);
+  std::vector<txn_id_t> nodes;
+  for (auto const &pair : waits_for_){
+    nodes.push_back(pair.first);
+  }
+  std::sort(nodes.begin(), nodes.end());
+  for (txn_id_t node : nodes){
+    if (FindCycle(node, txn_id)){
+      return true;
+    }
   }
   return false;
 }
 
 std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
+  std::scoped_lock graph_lock(graph_latch_);
   std::vector<std::pair<txn_id_t, txn_id_t>> result;
   for (auto const &pair : waits_for_){
     auto t1 = pair.first;
@@ -270,46 +721,4 @@ std::vector<std::pair<txn_id_t, txn_id_t>> LockManager::GetEdgeList() {
   return result;
 }
 
-// Dyy : In the handout they say 'throw a exception', but throw a exception
-//       out a thread will crash the whole process! So I don't throw exception
-//       in this function, but in Lock function
-void LockManager::RunCycleDetection() {
-  while (enable_cycle_detection_) {
-    std::this_thread::sleep_for(cycle_detection_interval);
-    {
-      // TODO(student): remove the continue and add your cycle detection and abort code here
-      // First build the entire graph
-      std::unique_lock<std::mutex> l(latch_);
-      for (auto const &pair : lock_table_){
-        for (auto const &lock_request_waiting : pair.second.request_queue_){
-          txn_set_.insert(lock_request_waiting.txn_id_);
-          // If it is waiting, add a edge to each lock-granted txn
-          if (lock_request_waiting.granted_) { continue; }
-          require_record_[lock_request_waiting.txn_id_] = pair.first;
-          for (auto const &lock_request_granted : pair.second.request_queue_){
-            if (!lock_request_granted.granted_) { continue; }
-            AddEdge(lock_request_waiting.txn_id_, lock_request_granted.txn_id_);
-          }
-        }
-      }
-
-      // Break every cycle
-      txn_id_t txn_id;
-      while (HasCycle(&txn_id)){
-        Transaction* txn = TransactionManager::GetTransaction(txn_id);
-        txn->SetState(TransactionState::ABORTED);
-        DeleteNode(txn_id);
-        lock_table_[require_record_[txn_id]].cv_.notify_all();
-      }
-
-      // clear internal data, next time we will construct them on-the-fly!
-      waits_for_.clear();
-      safe_set_.clear();
-      txn_set_.clear();
-      require_record_.clear();
-
-    }
-  }
-}
-
 }  // namespace bustub
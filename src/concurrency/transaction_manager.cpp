@@ -14,52 +14,105 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "catalog/catalog.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
+std::array<TransactionManager::TxnMapShard, TXN_MAP_SHARDS> TransactionManager::txn_map_;
 
-Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
+TransactionManager::~TransactionManager() {
+  for (auto &shard : txn_map_) {
+    std::scoped_lock lock(shard.latch_);
+    for (auto iter = shard.txns_.begin(); iter != shard.txns_.end();) {
+      iter = iter->second.first == this ? shard.txns_.erase(iter) : std::next(iter);
+    }
+  }
+}
 
+Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) {
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
   }
+  // Wait here while all transactions are blocked.
+  Enter(txn);
+
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+    txn->SetBeginLSN(txn->GetPrevLSN());
+  }
 
-  txn_map[txn->GetTransactionId()] = txn;
+  if (txn->IsSnapshot()) {
+    std::scoped_lock lock(commit_latch_);
+    VersionStore::AddSnapshot();
+    txn->SetReadTs(last_commit_ts_);
+    active_snapshots_.insert(last_commit_ts_);
+  }
   return txn;
 }
 
 void TransactionManager::Commit(Transaction *txn) {
   txn->SetState(TransactionState::COMMITTED);
 
-  // Perform all deletes before we commit.
+  // Stamp the versions written with the commit timestamp. The latest writes come first, so the version store
+  // learns whether a tuple was left deleted from the first commit of its RID.
   auto write_set = txn->GetWriteSet();
-  while (!write_set->empty()) {
-    auto &item = write_set->back();
-    auto table = item.table_;
-    if (item.wtype_ == WType::DELETE) {
-      // Note that this also releases the lock when holding the page latch.
-      table->ApplyDelete(item.rid_, txn);
+  bool collect = txn->IsSnapshot();
+  std::vector<std::pair<TableHeap *, RID>> deletes;
+  // Read-only transactions outside of a snapshot have nothing to stamp
+  if (!write_set->empty() || txn->IsSnapshot()) {
+    std::scoped_lock lock(commit_latch_);
+    if (!write_set->empty()) {
+      last_commit_ts_++;
+    }
+    for (auto item = write_set->rbegin(); item != write_set->rend(); ++item) {
+      if (item->table_->GetVersionStore()->Commit(txn->GetTransactionId(), item->rid_, last_commit_ts_,
+                                                  item->wtype_ == WType::DELETE)) {
+        gc_tables_.insert(item->table_);
+        collect = true;
+      } else if (item->wtype_ == WType::DELETE) {
+        deletes.emplace_back(item->table_, item->rid_);
+      }
     }
-    write_set->pop_back();
+    EndSnapshot(txn);
   }
   write_set->clear();
 
+  // No snapshot sees the deletes whose chain was dropped, perform them right away.
+  for (auto const &[table, rid] : deletes) {
+    // Note that this also releases the lock when holding the page latch.
+    table->ApplyDelete(rid, txn);
+  }
+
+  // Group commit: the locks are held until the commit record is on disk, along with those of the concurrent commits.
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    log_manager_->Flush(lsn);
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  Exit(txn);
+
+  if (collect) {
+    CollectGarbage();
+  }
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
   // Rollback before releasing the lock.
   auto table_write_set = txn->GetWriteSet();
+  std::vector<std::pair<TableHeap *, RID>> versions;
+  for (auto const &item : *table_write_set) {
+    versions.emplace_back(item.table_, item.rid_);
+  }
   while (!table_write_set->empty()) {
     auto &item = table_write_set->back();
     auto table = item.table_;
@@ -74,6 +127,14 @@ void TransactionManager::Abort(Transaction *txn) {
     table_write_set->pop_back();
   }
   table_write_set->clear();
+  // Only once the heap is back to the committed versions, or snapshots would see the intermediate ones
+  for (auto const &[table, rid] : versions) {
+    table->GetVersionStore()->Rollback(txn->GetTransactionId(), rid);
+  }
+  {
+    std::scoped_lock lock(commit_latch_);
+    EndSnapshot(txn);
+  }
   // Rollback index updates
   auto index_write_set = txn->GetIndexWriteSet();
   while (!index_write_set->empty()) {
@@ -100,14 +161,143 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  // Nothing waits for the abort record, the rollback's own records already undo the changes on recovery
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
-  // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  Exit(txn);
+
+  // The versions the snapshot kept alive may go now
+  if (txn->IsSnapshot()) {
+    CollectGarbage();
+  }
 }
 
-void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
+void TransactionManager::CollectGarbage() {
+  std::vector<TableHeap *> tables;
+  timestamp_t oldest_ts;
+  {
+    std::scoped_lock lock(commit_latch_);
+    tables.assign(gc_tables_.begin(), gc_tables_.end());
+    oldest_ts = active_snapshots_.empty() ? last_commit_ts_ : *active_snapshots_.begin();
+  }
+  std::vector<std::pair<TableHeap *, std::vector<RID>>> purges;
+  for (auto table : tables) {
+    std::vector<RID> rids;
+    table->GetVersionStore()->CollectGarbage(oldest_ts, &rids);
+    if (!rids.empty()) {
+      purges.emplace_back(table, std::move(rids));
+    }
+  }
+
+  // Its commit stamps nothing and ends no snapshot, so it does not collect in turn
+  if (!purges.empty()) {
+    Transaction *gc_txn = Begin();
+    for (auto const &[table, rids] : purges) {
+      table->Purge(rids, gc_txn);
+    }
+    Commit(gc_txn);
+    delete gc_txn;
+  }
+
+  // A concurrent pass may have dropped a table this one left work in, so decide for every table visited
+  std::scoped_lock lock(commit_latch_);
+  for (auto table : tables) {
+    if (table->GetVersionStore()->HasGarbage()) {
+      gc_tables_.insert(table);
+    } else {
+      gc_tables_.erase(table);
+    }
+  }
+}
+
+void TransactionManager::BlockAllTransactions() {
+  std::unique_lock lock(block_latch_);
+  blocked_.store(true);
+  block_cv_.wait(lock, [this] {
+    for (auto const &active : active_) {
+      if (active.count_.load() != 0) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+void TransactionManager::ResumeTransactions() {
+  {
+    std::scoped_lock lock(block_latch_);
+    blocked_.store(false);
+  }
+  block_cv_.notify_all();
+}
 
-void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
+lsn_t TransactionManager::GetActiveTransactions(std::vector<std::pair<txn_id_t, lsn_t>> *active_txns) {
+  lsn_t min_begin_lsn = INVALID_LSN;
+  // One shard at a time, a transaction stays in the registry until it has logged its commit or abort
+  for (auto &shard : txn_map_) {
+    std::scoped_lock lock(shard.latch_);
+    for (const auto &[txn_id, entry] : shard.txns_) {
+      auto [txn_mgr, txn] = entry;
+      if (txn_mgr != this) {
+        continue;
+      }
+      // The transaction keeps logging meanwhile, each lsn is read once. Begin sets the previous lsn first.
+      lsn_t begin_lsn = txn->GetBeginLSN();
+      lsn_t prev_lsn = txn->GetPrevLSN();
+      if (begin_lsn == INVALID_LSN) {
+        // Begun before logging was turned on, its records may go back to the start of the log. Otherwise it has not
+        // logged its BEGIN yet, which comes after anything logged so far.
+        if (prev_lsn == INVALID_LSN) {
+          continue;
+        }
+        begin_lsn = 0;
+      }
+      active_txns->emplace_back(txn_id, prev_lsn);
+      if (min_begin_lsn == INVALID_LSN || begin_lsn < min_begin_lsn) {
+        min_begin_lsn = begin_lsn;
+      }
+    }
+  }
+  return min_begin_lsn;
+}
+
+void TransactionManager::Enter(Transaction *txn) {
+  auto &active = active_[static_cast<uint32_t>(txn->GetTransactionId()) % TXN_MAP_SHARDS].count_;
+  // Count first and check the flag second, while BlockAllTransactions sets the flag first and sums the counts
+  // second: with both sequentially consistent, either it sees this transaction or this transaction sees the flag.
+  active.fetch_add(1);
+  while (blocked_.load()) {
+    active.fetch_sub(1);
+    std::unique_lock lock(block_latch_);
+    // The blocking thread may be waiting for this very count to drop
+    block_cv_.notify_all();
+    block_cv_.wait(lock, [this] { return !blocked_.load(); });
+    lock.unlock();
+    active.fetch_add(1);
+  }
+
+  TxnMapShard &shard = GetTxnMapShard(txn->GetTransactionId());
+  std::scoped_lock lock(shard.latch_);
+  shard.txns_[txn->GetTransactionId()] = {this, txn};
+}
+
+void TransactionManager::Exit(Transaction *txn) {
+  {
+    TxnMapShard &shard = GetTxnMapShard(txn->GetTransactionId());
+    std::scoped_lock lock(shard.latch_);
+    shard.txns_.erase(txn->GetTransactionId());
+  }
+  active_[static_cast<uint32_t>(txn->GetTransactionId()) % TXN_MAP_SHARDS].count_.fetch_sub(1);
+  // Same ordering as in Enter, the blocking thread only needs a wake up once it waits
+  if (blocked_.load()) {
+    std::scoped_lock lock(block_latch_);
+    block_cv_.notify_all();
+  }
+}
 
 }  // namespace bustub
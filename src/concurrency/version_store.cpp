@@ -0,0 +1,129 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/concurrency/version_store.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "concurrency/version_store.h"
+
+#include <utility>
+#include <vector>
+
+namespace bustub {
+
+std::atomic<size_t> VersionStore::active_snapshots_{0};
+
+bool VersionStore::CanWrite(Transaction *txn, const RID &rid) {
+  if (!txn->IsSnapshot()){
+    return true;
+  }
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  return iter == chains_.end() || iter->second.writer_ == txn->GetTransactionId()
+         || iter->second.newest_ts_ <= txn->GetReadTs();
+}
+
+void VersionStore::RecordWrite(Transaction *txn, const RID &rid, bool existed, const Tuple &old_tuple) {
+  std::scoped_lock lock(latch_);
+  VersionChain &chain = chains_[rid];
+  // The other transactions only ever see the version before txn's first write
+  if (chain.writer_ == txn->GetTransactionId()){
+    return;
+  }
+  chain.undo_.push_front(UndoVersion{chain.newest_ts_, existed, existed ? old_tuple : Tuple{}});
+  chain.writer_ = txn->GetTransactionId();
+  chain.newest_ts_ = INVALID_TS;
+  chain.deleted_ = false;
+}
+
+bool VersionStore::Commit(txn_id_t txn_id, const RID &rid, timestamp_t commit_ts, bool deleted) {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end() || iter->second.writer_ != txn_id){
+    return false;
+  }
+  // The snapshots that begin later all see this version
+  if (active_snapshots_.load() == 0){
+    chains_.erase(iter);
+    return false;
+  }
+  iter->second.writer_ = INVALID_TXN_ID;
+  iter->second.newest_ts_ = commit_ts;
+  iter->second.deleted_ = deleted;
+  committed_.emplace_back(commit_ts, rid);
+  return true;
+}
+
+void VersionStore::Rollback(txn_id_t txn_id, const RID &rid) {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end() || iter->second.writer_ != txn_id){
+    return;
+  }
+  VersionChain &chain = iter->second;
+  chain.writer_ = INVALID_TXN_ID;
+  chain.newest_ts_ = chain.undo_.front().begin_ts_;
+  chain.undo_.pop_front();
+  // Without older versions the restored one was already visible to every active snapshot
+  if (chain.undo_.empty()){
+    chains_.erase(iter);
+  }
+}
+
+VersionStore::Visibility VersionStore::Resolve(Transaction *txn, const RID &rid, Tuple *older) {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end()){
+    return Visibility::NEWEST;
+  }
+  const VersionChain &chain = iter->second;
+  timestamp_t read_ts = txn->GetReadTs();
+  if (chain.writer_ == txn->GetTransactionId() || (chain.writer_ == INVALID_TXN_ID && chain.newest_ts_ <= read_ts)){
+    return Visibility::NEWEST;
+  }
+  for (auto const &version : chain.undo_){
+    if (version.begin_ts_ <= read_ts){
+      if (!version.exists_){
+        return Visibility::NONE;
+      }
+      *older = version.tuple_;
+      return Visibility::OLDER;
+    }
+  }
+  return Visibility::NONE;
+}
+
+void VersionStore::CollectGarbage(timestamp_t oldest_ts, std::vector<RID> *purge) {
+  std::scoped_lock lock(latch_);
+  purge->insert(purge->end(), deferred_.begin(), deferred_.end());
+  deferred_.clear();
+  while (!committed_.empty() && committed_.front().first <= oldest_ts){
+    auto [commit_ts, rid] = committed_.front();
+    committed_.pop_front();
+    auto iter = chains_.find(rid);
+    if (iter == chains_.end()){
+      continue;
+    }
+    VersionChain &chain = iter->second;
+    // Every snapshot sees the newest version, the chain is of no use any more
+    if (chain.writer_ == INVALID_TXN_ID && chain.newest_ts_ <= oldest_ts){
+      if (chain.deleted_){
+        purge->push_back(rid);
+      }
+      chains_.erase(iter);
+      continue;
+    }
+    // Otherwise every snapshot sees the version committed at commit_ts or a newer one
+    while (!chain.undo_.empty() && chain.undo_.back().begin_ts_ < commit_ts){
+      chain.undo_.pop_back();
+    }
+  }
+}
+
+}  // namespace bustub
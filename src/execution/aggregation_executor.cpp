@@ -10,9 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "execution/executors/aggregation_executor.h"
+#include "execution/executors/seq_scan_executor.h"
+#include "execution/morsel_source.h"
+#include "execution/task_scheduler.h"
 
 namespace bustub {
 
@@ -21,21 +25,91 @@ AggregationExecutor::AggregationExecutor(ExecutorContext *exec_ctx, const Aggreg
     : AbstractExecutor(exec_ctx),
       plan_(plan),
       child_(std::move(child)),
-      aht_{plan->GetAggregates(), plan->GetAggregateTypes()},
-      aht_iterator_(aht_.Begin()){}
+      aht_iterator_(std::unordered_map<AggregateKey, AggregateValue>::const_iterator{}){}
 
 const AbstractExecutor *AggregationExecutor::GetChildExecutor() const { return child_.get(); }
 
 void AggregationExecutor::Init() {
-  Tuple temp_tuple;
-  RID temp_rid;
+  aht_partitions_.clear();
 
-  child_->Init();
+  if (plan_->GetParallelism() > 1 && plan_->GetChildPlan()->GetType() == PlanType::SeqScan){
+    ParallelAggregate();
+  } else {
+    TupleBatch batch;
 
-  while (child_->Next(&temp_tuple, &temp_rid)){
-    aht_.InsertCombine(MakeKey(&temp_tuple), MakeVal(&temp_tuple));
+    child_->Init();
+
+    aht_partitions_.emplace_back(plan_->GetAggregates(), plan_->GetAggregateTypes());
+    while (child_->NextBatch(&batch)){
+      for (size_t i = 0; i < batch.Size(); i++){
+        aht_partitions_[0].InsertCombine(MakeKey(&batch.GetTuple(i)), MakeVal(&batch.GetTuple(i)));
+      }
+    }
+  }
+  partition_idx_ = 0;
+  aht_iterator_ = aht_partitions_[0].Begin();
+}
+
+void AggregationExecutor::ParallelAggregate() {
+  auto scan_plan = dynamic_cast<const SeqScanPlanNode *>(plan_->GetChildPlan());
+  TableHeap *table_heap = GetExecutorContext()->GetCatalog()->GetTable(scan_plan->GetTableOid())->table_.get();
+  TaskScheduler *scheduler = GetExecutorContext()->GetTaskScheduler();
+  size_t num_partitions = plan_->GetParallelism();
+
+  // local_tables.At(w)[p] holds what worker w pre-aggregated for partition p
+  PerWorker<std::vector<SimpleAggregationHashTable>> local_tables(scheduler, [&]{
+    std::vector<SimpleAggregationHashTable> tables;
+    tables.reserve(num_partitions);
+    for (size_t p = 0; p < num_partitions; p++){
+      tables.emplace_back(plan_->GetAggregates(), plan_->GetAggregateTypes());
+    }
+    return tables;
+  });
+
+  // Phase 1: one task per morsel of pages, aggregating into the tables of the worker that runs it
+  // A table whose pages cannot be listed aborts the transaction, there is then no morsel to aggregate
+  std::vector<page_id_t> page_ids;
+  table_heap->GetPageIds(GetExecutorContext()->GetTransaction(), &page_ids);
+  MorselSource morsel_source{std::move(page_ids)};
+  {
+    TaskGroup group{scheduler};
+    page_id_t first_page_id;
+    page_id_t stop_page_id;
+    while (morsel_source.Claim(&first_page_id, &stop_page_id)){
+      group.Run([this, first_page_id, stop_page_id, scan_plan, num_partitions, &local_tables]{
+        SeqScanExecutor scan{GetExecutorContext(), scan_plan};
+        scan.SetPageRange(first_page_id, stop_page_id);
+        scan.Init();
+        auto &tables = local_tables.Local();
+        TupleBatch batch;
+        while (scan.NextBatch(&batch)){
+          for (size_t i = 0; i < batch.Size(); i++){
+            AggregateKey agg_key = MakeKey(&batch.GetTuple(i));
+            tables[Partition(agg_key, num_partitions)].InsertCombine(agg_key, MakeVal(&batch.GetTuple(i)));
+          }
+        }
+      });
+    }
+    group.Wait();
+  }
+
+  // Phase 2: the exchange at the pipeline breaker, task p merges partition p of every worker's tables
+  aht_partitions_.reserve(num_partitions);
+  for (size_t p = 0; p < num_partitions; p++){
+    aht_partitions_.emplace_back(plan_->GetAggregates(), plan_->GetAggregateTypes());
+  }
+  TaskGroup group{scheduler};
+  for (size_t p = 0; p < num_partitions; p++){
+    group.Run([this, p, &local_tables]{
+      for (size_t w = 0; w < local_tables.Size(); w++){
+        auto &table = local_tables.At(w)[p];
+        for (auto iter = table.Begin(); iter != table.End(); ++iter){
+          aht_partitions_[p].MergeCombine(iter.Key(), iter.Val());
+        }
+      }
+    });
   }
-  aht_iterator_ = aht_.Begin();
+  group.Wait();
 }
 
 Tuple AggregationExecutor::GenerateOutput() {
@@ -55,12 +129,17 @@ Tuple AggregationExecutor::GenerateOutput() {
  */
 bool AggregationExecutor::Next(Tuple *tuple, RID *rid) {
   while (true){
-    if (aht_iterator_ == aht_.End()){
-      return false;
+    if (aht_iterator_ == aht_partitions_[partition_idx_].End()){
+      if (partition_idx_ + 1 == aht_partitions_.size()){
+        return false;
+      }
+      aht_iterator_ = aht_partitions_[++partition_idx_].Begin();
+      continue;
     }
 
     if (plan_->GetHaving() == nullptr ||
-        plan_->GetHaving()->EvaluateAggregate(aht_iterator_.Key().group_bys_, aht_iterator_.Val().aggregates_).GetAs<bool>()){
+        AbstractExpression::IsTrue(plan_->GetHaving()->EvaluateAggregate(aht_iterator_.Key().group_bys_,
+                                                                         aht_iterator_.Val().aggregates_))){
       *tuple = GenerateOutput();
       ++aht_iterator_;
       return true;
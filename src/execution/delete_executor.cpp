@@ -55,13 +55,8 @@ void DeleteExecutor::DeleteTuple(Tuple &tuple, RID &rid) {
 
 void DeleteExecutor::LockInNode(RID &rid) {
   Transaction* txn = GetExecutorContext()->GetTransaction();
-  if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()){
-    GetExecutorContext()->GetLockManager()->LockUpgrade(txn, rid);
-    return;
-  }
-  if (txn->GetExclusiveLockSet()->find(rid) == txn->GetExclusiveLockSet()->end()){
-    GetExecutorContext()->GetLockManager()->LockExclusive(txn, rid);
-  }
+  // Upgrades a shared lock on the row, or nothing at all if the table is locked exclusively
+  GetExecutorContext()->GetLockManager()->LockRowExclusive(txn, plan_->TableOid(), rid);
 }
 
 bool DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) {
@@ -0,0 +1,191 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// expression_compiler.cpp
+//
+// Identification: src/execution/expression_compiler.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "execution/expression_compiler.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/comparison_kernels.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "type/limits.h"
+
+namespace bustub {
+
+namespace {
+
+/** @return make(Op{}) for the std:: comparison functor Op on T matching comp_type */
+template <typename T, typename Make>
+CompiledPredicate DispatchComparison(ComparisonType comp_type, Make &&make) {
+  switch (comp_type) {
+    case ComparisonType::Equal:
+      return make(std::equal_to<T>{});
+    case ComparisonType::NotEqual:
+      return make(std::not_equal_to<T>{});
+    case ComparisonType::LessThan:
+      return make(std::less<T>{});
+    case ComparisonType::LessThanOrEqual:
+      return make(std::less_equal<T>{});
+    case ComparisonType::GreaterThan:
+      return make(std::greater<T>{});
+    case ComparisonType::GreaterThanOrEqual:
+      return make(std::greater_equal<T>{});
+  }
+  return {};
+}
+
+/** @return compile(T{}, null value of T) for the C++ type T storing type_id, or nothing for other types */
+template <typename Compile>
+CompiledPredicate DispatchType(TypeId type_id, Compile &&compile) {
+  switch (type_id) {
+    case TypeId::TINYINT:
+      return compile(int8_t{}, BUSTUB_INT8_NULL);
+    case TypeId::SMALLINT:
+      return compile(int16_t{}, BUSTUB_INT16_NULL);
+    case TypeId::INTEGER:
+      return compile(int32_t{}, BUSTUB_INT32_NULL);
+    case TypeId::BIGINT:
+      return compile(int64_t{}, BUSTUB_INT64_NULL);
+    case TypeId::DECIMAL:
+      return compile(double{}, BUSTUB_DECIMAL_NULL);
+    default:
+      return {};
+  }
+}
+
+template <typename T>
+T ReadColumn(const char *data, uint32_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+/** (column cmp constant), batches go through the SIMD column kernel */
+template <typename T>
+CompiledPredicate CompileColumnConstant(uint32_t offset, T constant, T null_value, ComparisonType comp_type) {
+  return DispatchComparison<T>(comp_type, [=](auto op) {
+    using Op = decltype(op);
+    auto row_function = [offset, constant, null_value](const char *data) {
+      T value = ReadColumn<T>(data, offset);
+      return value != null_value && Op{}(value, constant);
+    };
+    auto batch_function = [offset, constant, null_value](const TupleBatch &batch, SelectionBitmap *selection) {
+      std::vector<T> column;
+      GatherColumn<T>(batch, offset, &column);
+      selection->Reset(batch.Size());
+      CompareColumnToConstant<T, Op>(column.data(), column.size(), constant, null_value, selection->GetWords());
+    };
+    return CompiledPredicate(row_function, batch_function);
+  });
+}
+
+/** (column cmp column) of one tuple */
+template <typename T>
+CompiledPredicate CompileColumnColumn(uint32_t left_offset, uint32_t right_offset, T null_value,
+                                      ComparisonType comp_type) {
+  return DispatchComparison<T>(comp_type, [=](auto op) {
+    using Op = decltype(op);
+    auto row_function = [left_offset, right_offset, null_value](const char *data) {
+      T left = ReadColumn<T>(data, left_offset);
+      T right = ReadColumn<T>(data, right_offset);
+      return left != null_value && right != null_value && Op{}(left, right);
+    };
+    return CompiledPredicate(row_function, nullptr);
+  });
+}
+
+}  // namespace
+
+CompiledPredicate ExpressionCompiler::CompilePredicate(const AbstractExpression *predicate, const Schema *schema) {
+  auto comparison = dynamic_cast<const ComparisonExpression *>(predicate);
+  if (comparison == nullptr) {
+    return {};
+  }
+  ComparisonType comp_type = comparison->GetComparisonType();
+  auto left_column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(0));
+  auto right_column = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(1));
+
+  if (left_column != nullptr && right_column != nullptr) {
+    const Column &left = schema->GetColumn(left_column->GetColIdx());
+    const Column &right = schema->GetColumn(right_column->GetColIdx());
+    if (left.GetType() != right.GetType()) {
+      return {};
+    }
+    return DispatchType(left.GetType(), [&](auto tag, auto null_value) {
+      using T = decltype(tag);
+      return CompileColumnColumn<T>(left.GetOffset(), right.GetOffset(), static_cast<T>(null_value), comp_type);
+    });
+  }
+
+  const ColumnValueExpression *column_expr = left_column;
+  auto constant_expr = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(1));
+  if (column_expr == nullptr) {
+    // (constant cmp column) is (column flipped-cmp constant)
+    column_expr = right_column;
+    constant_expr = dynamic_cast<const ConstantValueExpression *>(comparison->GetChildAt(0));
+    comp_type = ComparisonExpression::FlipComparison(comp_type);
+  }
+  if (column_expr == nullptr || constant_expr == nullptr) {
+    return {};
+  }
+  const Column &column = schema->GetColumn(column_expr->GetColIdx());
+  const Value &constant = constant_expr->GetValue();
+  if (column.GetType() != constant.GetTypeId() || constant.IsNull()) {
+    return {};
+  }
+  return DispatchType(column.GetType(), [&](auto tag, auto null_value) {
+    using T = decltype(tag);
+    return CompileColumnConstant<T>(column.GetOffset(), constant.GetAs<T>(), static_cast<T>(null_value), comp_type);
+  });
+}
+
+std::unique_ptr<CompiledProjection> ExpressionCompiler::CompileProjection(const Schema *output_schema,
+                                                                          const Schema *input_schema) {
+  std::vector<CompiledProjection::CopyOp> copy_ops;
+  for (const auto &output_column : output_schema->GetColumns()) {
+    auto column_expr = dynamic_cast<const ColumnValueExpression *>(output_column.GetExpr());
+    if (column_expr == nullptr || !output_column.IsInlined()) {
+      return nullptr;
+    }
+    const Column &input_column = input_schema->GetColumn(column_expr->GetColIdx());
+    if (input_column.GetType() != output_column.GetType()) {
+      return nullptr;
+    }
+    uint32_t size = input_column.GetFixedLength();
+    // Columns adjacent on both sides are copied in one go
+    if (!copy_ops.empty() && copy_ops.back().src_offset_ + copy_ops.back().size_ == input_column.GetOffset() &&
+        copy_ops.back().dst_offset_ + copy_ops.back().size_ == output_column.GetOffset()) {
+      copy_ops.back().size_ += size;
+    } else {
+      copy_ops.push_back({input_column.GetOffset(), output_column.GetOffset(), size});
+    }
+  }
+  return std::make_unique<CompiledProjection>(std::move(copy_ops), output_schema->GetLength());
+}
+
+Tuple CompiledProjection::Project(const char *input_data) const {
+  Tuple output;
+  output.allocated_ = true;
+  output.size_ = tuple_size_;
+  output.data_ = new char[tuple_size_];
+  // An all fixed-size schema is laid out back to back, so the copies cover every byte of the output
+  for (const auto &copy_op : copy_ops_) {
+    std::memcpy(output.data_ + copy_op.dst_offset_, input_data + copy_op.src_offset_, copy_op.size_);
+  }
+  return output;
+}
+
+}  // namespace bustub
@@ -9,7 +9,11 @@
 // Copyright (c) 2015-19, Carnegie Mellon University Database Group
 //
 //===----------------------------------------------------------------------===//
+#include <functional>
+
 #include "execution/executors/index_scan_executor.h"
+#include "execution/expressions/column_value_expression.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
@@ -22,9 +26,98 @@ void IndexScanExecutor::Init() {
   Index* index_ptr = index_info_ptr->index_.get();
   B_PLUS_TREE_INDEX_TYPE *b_plus_tree_index_ptr = reinterpret_cast<B_PLUS_TREE_INDEX_TYPE*>(index_ptr);
   table_metadata_ = catalog->GetTable(index_info_ptr->table_name_);
+  table_heap_ptr_ = table_metadata_->table_.get();
+  // The index holds the newest keys only: the entries of the rows deleted or rekeyed since the snapshot are gone
+  // from it. A snapshot scans the table instead.
+  if (exec_ctx_->GetTransaction()->IsSnapshot()){
+    snapshot_cursor_ = std::make_unique<TableCursor>(table_heap_ptr_, table_heap_ptr_->GetFirstPageId(),
+                                                     INVALID_PAGE_ID, nullptr, true);
+    return;
+  }
+  index_only_ = IsCovering(index_info_ptr);
+  // An index-only scan try-locks its rows while the iterator latches their leaf, which works once the table has
+  // its intention lock. Take it before the iterator latches anything, it may wait.
+  Transaction *txn = exec_ctx_->GetTransaction();
+  if (index_only_ && enable_logging && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED){
+    exec_ctx_->GetLockManager()->LockTable(txn, table_metadata_->oid_, LockMode::INTENTION_SHARED);
+  }
   index_iter_ = b_plus_tree_index_ptr->GetBeginIterator();
   end_iter_ = b_plus_tree_index_ptr->GetEndIterator();
-  table_heap_ptr_ = table_metadata_->table_.get();
+}
+
+bool IndexScanExecutor::IsCovering(IndexInfo *index_info) {
+  const Schema &table_schema = table_metadata_->schema_;
+  std::vector<bool> read(table_schema.GetColumnCount(), false);
+  std::function<void(const AbstractExpression *)> collect = [&](const AbstractExpression *expr){
+    if (auto column = dynamic_cast<const ColumnValueExpression *>(expr); column != nullptr){
+      read[column->GetColIdx()] = true;
+    }
+    for (auto child : expr->GetChildren()){
+      collect(child);
+    }
+  };
+  if (plan_->GetPredicate() != nullptr){
+    collect(plan_->GetPredicate());
+  }
+  for (auto const &col:GetOutputSchema()->GetColumns()){
+    collect(col.GetExpr());
+  }
+
+  // The index key schema has the table types of the key columns. GenericKey only holds inlined columns,
+  // and only those that fit in its key size.
+  covered_cols_.clear();
+  row_values_.clear();
+  key_schema_ = index_info->index_->GetKeySchema();
+  const std::vector<uint32_t> &key_attrs = index_info->index_->GetKeyAttrs();
+  for (uint32_t table_col = 0; table_col < read.size(); table_col++){
+    row_values_.push_back(ValueFactory::GetNullValueByType(table_schema.GetColumn(table_col).GetType()));
+    if (!read[table_col]){
+      continue;
+    }
+    uint32_t key_col = 0;
+    while (key_col < key_attrs.size() && key_attrs[key_col] != table_col){
+      key_col++;
+    }
+    if (key_col == key_attrs.size()){
+      return false;
+    }
+    const Column &col = key_schema_->GetColumn(key_col);
+    if (!col.IsInlined() || col.GetOffset() + col.GetFixedLength() > index_info->key_size_){
+      return false;
+    }
+    covered_cols_.emplace_back(table_col, key_col);
+  }
+  return true;
+}
+
+bool IndexScanExecutor::LockRid(const RID &rid) {
+  Transaction *txn = exec_ctx_->GetTransaction();
+  return !enable_logging || txn->IsSnapshot() || txn->IsSharedLocked(rid) || txn->IsExclusiveLocked(rid) ||
+         exec_ctx_->GetLockManager()->LockRowShared(txn, table_metadata_->oid_, rid);
+}
+
+bool IndexScanExecutor::TryLockRid(const RID &rid) {
+  Transaction *txn = exec_ctx_->GetTransaction();
+  return !enable_logging || txn->IsSnapshot() ||
+         exec_ctx_->GetLockManager()->TryLockRowShared(txn, table_metadata_->oid_, rid);
+}
+
+bool IndexScanExecutor::MatchesTable(const RID &rid) {
+  // The lock had to wait, a writer may have deleted the row or changed its key and committed in between. Its entry
+  // may still be there, and the index cannot be probed again while the iterator latches a leaf.
+  bool matches = false;
+  table_heap_ptr_->VisitTuple(rid, exec_ctx_->GetTransaction(), [&](const TupleView &view) {
+    Tuple borrowed = Tuple::Borrow(view);
+    matches = true;
+    for (auto [table_col, key_col] : covered_cols_){
+      if (borrowed.GetValue(&table_metadata_->schema_, table_col).CompareEquals(row_values_[table_col]) !=
+          CmpBool::CmpTrue){
+        matches = false;
+        break;
+      }
+    }
+  });
+  return matches;
 }
 
 Tuple IndexScanExecutor::GenerateTuple(Tuple &tuple) {
@@ -36,13 +129,62 @@ Tuple IndexScanExecutor::GenerateTuple(Tuple &tuple) {
 }
 
 bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  if (snapshot_cursor_ != nullptr){
+    Transaction *txn = exec_ctx_->GetTransaction();
+    Tuple version;
+    while (snapshot_cursor_->Advance()){
+      *rid = snapshot_cursor_->GetRid();
+      if (!snapshot_cursor_->GetTuple(&version, txn)){
+        continue;
+      }
+      if ((plan_->GetPredicate() == nullptr) ||
+          AbstractExpression::IsTrue(plan_->GetPredicate()->Evaluate(&version, &table_metadata_->schema_))) {
+        *tuple = GenerateTuple(version);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (index_only_){
+    // Rebuild the table row from the key, only the columns the scan reads are filled in
+    while (index_iter_ != end_iter_){
+      const auto &[key, value] = *index_iter_;
+      *rid = value;
+      for (auto [table_col, key_col] : covered_cols_){
+        row_values_[table_col] = key.ToValue(key_schema_, key_col);
+      }
+      // The iterator keeps the leaf latched, so no writer changes the entry meanwhile. If the row lock is granted
+      // right away no writer holds the row either: the entry is the committed one and the table is not read.
+      bool current = TryLockRid(*rid);
+      ++index_iter_;
+      if (!current && (!LockRid(*rid) || !MatchesTable(*rid))){
+        continue;
+      }
+      Tuple row{row_values_, &table_metadata_->schema_};
+      if ((plan_->GetPredicate() == nullptr) ||
+          AbstractExpression::IsTrue(plan_->GetPredicate()->Evaluate(&row, &table_metadata_->schema_))) {
+        *tuple = GenerateTuple(row);
+        return true;
+      }
+    }
+    return false;
+  }
+
   while (index_iter_!= end_iter_){
     *rid = (*index_iter_).second;
     ++index_iter_;
-    table_heap_ptr_->GetTuple(*rid, tuple, exec_ctx_->GetTransaction());
-    if ((plan_->GetPredicate() == nullptr) ||
-        plan_->GetPredicate()->Evaluate(tuple, &table_metadata_->schema_).GetAs<bool>()) {
-      *tuple = GenerateTuple(*tuple);
+    // Filter and project the tuple in its page instead of copying it out first
+    bool selected = false;
+    table_heap_ptr_->VisitTuple(*rid, exec_ctx_->GetTransaction(), [&](const TupleView &view) {
+      Tuple borrowed = Tuple::Borrow(view);
+      if ((plan_->GetPredicate() == nullptr) ||
+          AbstractExpression::IsTrue(plan_->GetPredicate()->Evaluate(&borrowed, &table_metadata_->schema_))) {
+        *tuple = GenerateTuple(borrowed);
+        selected = true;
+      }
+    });
+    if (selected) {
       return true;
     }
   }
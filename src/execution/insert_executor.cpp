@@ -24,6 +24,9 @@ void InsertExecutor::Init() {
   table_metadata_ptr_ = catalog->GetTable(plan_->TableOid());
   const std::string &table_name = table_metadata_ptr_->name_;
   index_info_vector_ = catalog->GetTableIndexes(table_name);  // Will there be copy elision(NRVO)?
+  // The new rows are locked exclusively by TableHeap::InsertTuple, announce it on the table first
+  GetExecutorContext()->GetLockManager()->LockTable(GetExecutorContext()->GetTransaction(), plan_->TableOid(),
+                                                    LockMode::INTENTION_EXCLUSIVE);
   if (plan_->IsRawInsert()){
     iter_ = plan_->RawValues().begin();
   }
@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "execution/executors/limit_executor.h"
 
 namespace bustub {
@@ -23,6 +25,7 @@ LimitExecutor::LimitExecutor(ExecutorContext *exec_ctx, const LimitPlanNode *pla
 
 void LimitExecutor::Init() {
   child_executor_->Init();
+  counter_ = 0;
 }
 
 bool LimitExecutor::Next(Tuple *tuple, RID *rid) {
@@ -43,4 +46,25 @@ bool LimitExecutor::Next(Tuple *tuple, RID *rid) {
   }
 }
 
+bool LimitExecutor::NextBatch(TupleBatch *batch) {
+  size_t end = plan_->GetOffset() + plan_->GetLimit();
+  while (counter_ < end){
+    if (!child_executor_->NextBatch(batch)){
+      return false;
+    }
+
+    // Keep the part of the child batch inside [offset, offset + limit)
+    size_t begin_idx = counter_ < plan_->GetOffset() ? std::min(plan_->GetOffset() - counter_, batch->Size()) : 0;
+    size_t end_idx = std::min(end - counter_, batch->Size());
+    counter_ += batch->Size();
+    if (begin_idx == end_idx){
+      continue;
+    }
+    batch->Slice(begin_idx, end_idx);
+    return true;
+  }
+  batch->Clear();
+  return false;
+}
+
 }  // namespace bustub
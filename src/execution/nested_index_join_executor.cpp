@@ -36,6 +36,8 @@ void NestIndexJoinExecutor::Init() {
   IndexInfo *index_info_ptr = catalog_ptr->GetIndex(plan_->GetIndexName(), table_name);
   table_ptr_ = table_metadata_ptr->table_.get();
   index_ptr_ = reinterpret_cast<B_PLUS_TREE_INDEX_TYPE*>(index_info_ptr->index_.get());
+  result_batch_.Clear();
+  result_idx_ = 0;
 }
 
 Tuple NestIndexJoinExecutor::CombineTuple(Tuple *left_tuple, Tuple *right_tuple) {
@@ -50,26 +52,45 @@ Tuple NestIndexJoinExecutor::CombineTuple(Tuple *left_tuple, Tuple *right_tuple)
 }
 
 bool NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) {
-  while (true){
-    if (!result_vector_.empty()){
-      RID right_rid = result_vector_.back();
-      result_vector_.pop_back();
-
-      Tuple right_tuple;
-      table_ptr_->GetTuple(right_rid, &right_tuple, GetExecutorContext()->GetTransaction());
-      *tuple = CombineTuple(&left_tuple_, &right_tuple);
-
-      return true;
+  // The join runs batch-at-a-time underneath, Next() hands out the current result batch tuple by tuple
+  if (result_idx_ >= result_batch_.Size()){
+    result_idx_ = 0;
+    if (!NextBatch(&result_batch_)){
+      return false;
     }
+  }
+  *tuple = std::move(result_batch_.GetTuple(result_idx_));
+  *rid = result_batch_.GetRid(result_idx_);
+  result_idx_++;
+  return true;
+}
 
-    if (!child_executor_ptr_->Next(&left_tuple_, rid)){
+bool NestIndexJoinExecutor::NextBatch(TupleBatch *batch) {
+  batch->Clear();
+  Transaction *txn = GetExecutorContext()->GetTransaction();
+  // The index is unique, so an outer batch joins to at most one batch of output.
+  // A batch may join to nothing, so keep pulling outer batches until something matches.
+  while (batch->IsEmpty()){
+    if (!child_executor_ptr_->NextBatch(&outer_batch_)){
       return false;
     }
 
-    index_ptr_->ScanKey(left_tuple_,
-                        &result_vector_,
-                        GetExecutorContext()->GetTransaction());
+    // Probe the index for the whole outer batch in one sweep of its leaves, in key order
+    matches_.clear();
+    index_ptr_->ScanKeys(outer_batch_.GetTuples(), &matches_);
+    match_rids_.clear();
+    for (const auto &match : matches_){
+      match_rids_.push_back(match.second);
+    }
+
+    // Then read the inner tuples grouped by page, joining against each in its page instead of copying it out
+    table_ptr_->VisitTuples(match_rids_, txn, [&](size_t idx, const TupleView &view) {
+      size_t outer_idx = matches_[idx].first;
+      Tuple right_tuple = Tuple::Borrow(view);
+      batch->Append(CombineTuple(&outer_batch_.GetTuple(outer_idx), &right_tuple), outer_batch_.GetRid(outer_idx));
+    });
   }
+  return true;
 }
 
 }  // namespace bustub
@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <utility>
+
 #include "execution/executors/nested_loop_join_executor.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
 
 namespace bustub {
 
@@ -19,13 +23,55 @@ NestedLoopJoinExecutor::NestedLoopJoinExecutor(ExecutorContext *exec_ctx, const
                                                std::unique_ptr<AbstractExecutor> &&right_executor)
     : AbstractExecutor(exec_ctx), plan_(plan),
       left_executor_ptr_(std::move(left_executor)),
-      right_executor_ptr_(std::move(right_executor)){}
+      right_executor_ptr_(std::move(right_executor)){
+  // The left side is the build side, its keys are pushed into the right scan as a Bloom filter.
+  // Only (column = column) predicates with one column on each side qualify. Keys are hashed by type, so both sides
+  // must have the same type: an INTEGER and a DECIMAL that compare equal hash differently.
+  auto comparison = dynamic_cast<const ComparisonExpression *>(plan_->Predicate());
+  auto right_scan = dynamic_cast<SeqScanExecutor *>(right_executor_ptr_.get());
+  if (comparison == nullptr || comparison->GetComparisonType() != ComparisonType::Equal || right_scan == nullptr){
+    return;
+  }
+  auto lhs = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(0));
+  auto rhs = dynamic_cast<const ColumnValueExpression *>(comparison->GetChildAt(1));
+  if (lhs == nullptr || rhs == nullptr || lhs->GetTupleIdx() == rhs->GetTupleIdx()){
+    return;
+  }
+  if (lhs->GetTupleIdx() != 0){
+    std::swap(lhs, rhs);
+  }
+  if (left_executor_ptr_->GetOutputSchema()->GetColumn(lhs->GetColIdx()).GetType() !=
+      right_scan->GetOutputSchema()->GetColumn(rhs->GetColIdx()).GetType()){
+    return;
+  }
+  right_scan_ = right_scan;
+  left_key_ = lhs;
+  right_scan_->SetBloomFilter(rhs->GetColIdx(), &bloom_filter_);
+}
 
 void NestedLoopJoinExecutor::Init() {
   left_executor_ptr_->Init();
+  // The right side is initialized once the first left block is known, see RescanRight
+  // The first left tuple is fetched lazily, Next() and NextBatch() pull it differently
+  left_ret_ = false;
+  started_ = false;
+  left_batch_.Clear();
+  right_batch_.Clear();
+  left_idx_ = 0;
+  right_idx_ = 0;
+}
+
+void NestedLoopJoinExecutor::RescanRight(const Tuple *left_tuples, size_t count) {
+  if (right_scan_ != nullptr){
+    // The right scan is usually over, but not if Init() restarted the join in the middle of it: its workers may
+    // still be reading the filter, stop them before it is rebuilt
+    right_scan_->Stop();
+    bloom_filter_.Reset(count);
+    for (size_t i = 0; i < count; i++){
+      bloom_filter_.Insert(left_key_->Evaluate(&left_tuples[i], left_executor_ptr_->GetOutputSchema()));
+    }
+  }
   right_executor_ptr_->Init();
-  RID temp_rid;
-  left_ret_ = left_executor_ptr_->Next(&left_tuple_, &temp_rid);
 }
 
 Tuple NestedLoopJoinExecutor::CombineTuple(Tuple *left_tuple, Tuple *right_tuple) {
@@ -45,25 +91,75 @@ Tuple NestedLoopJoinExecutor::CombineTuple(Tuple *left_tuple, Tuple *right_tuple
 bool NestedLoopJoinExecutor::Next(Tuple *tuple, RID *rid) {
   Tuple right_tuple;
   RID temp_rid;
+  if (!started_){
+    started_ = true;
+    left_ret_ = left_executor_ptr_->Next(&left_tuple_, &temp_rid);
+    if (left_ret_){
+      RescanRight(&left_tuple_, 1);
+    }
+  }
   while (true){
     if (!left_ret_){
       return false;
     }
 
     if (!right_executor_ptr_->Next(&right_tuple, &temp_rid)){
-      right_executor_ptr_->Init();
       left_ret_ = left_executor_ptr_->Next(&left_tuple_, &temp_rid);
+      if (left_ret_){
+        RescanRight(&left_tuple_, 1);
+      }
       continue;
     }
 
-    if (plan_->Predicate()->EvaluateJoin(&left_tuple_,
-                                         left_executor_ptr_->GetOutputSchema(),
-                                         &right_tuple,
-                                         right_executor_ptr_->GetOutputSchema()
-                                         ).GetAs<bool>()){
+    if (AbstractExpression::IsTrue(plan_->Predicate()->EvaluateJoin(&left_tuple_,
+                                                                    left_executor_ptr_->GetOutputSchema(),
+                                                                    &right_tuple,
+                                                                    right_executor_ptr_->GetOutputSchema()))){
       *tuple = CombineTuple(&left_tuple_, &right_tuple);
       return true;
     }
   }
 }
+
+bool NestedLoopJoinExecutor::NextBatch(TupleBatch *batch) {
+  batch->Clear();
+  if (!started_){
+    started_ = true;
+    left_ret_ = left_executor_ptr_->NextBatch(&left_batch_);
+    if (left_ret_){
+      RescanRight(left_batch_.GetTuples().data(), left_batch_.Size());
+    }
+  }
+  while (left_ret_ && !batch->IsFull()){
+    if (left_idx_ == left_batch_.Size()){
+      // This left block is joined against the current right batch, move on to the next right batch.
+      // Once the right side is exhausted, move on to the next left block and rescan the right side.
+      left_idx_ = 0;
+      if (!right_executor_ptr_->NextBatch(&right_batch_)){
+        left_ret_ = left_executor_ptr_->NextBatch(&left_batch_);
+        if (!left_ret_){
+          break;
+        }
+        RescanRight(left_batch_.GetTuples().data(), left_batch_.Size());
+      }
+      continue;
+    }
+
+    Tuple *left_tuple = &left_batch_.GetTuple(left_idx_);
+    for (; right_idx_ < right_batch_.Size() && !batch->IsFull(); right_idx_++){
+      Tuple *right_tuple = &right_batch_.GetTuple(right_idx_);
+      if (AbstractExpression::IsTrue(plan_->Predicate()->EvaluateJoin(left_tuple, left_executor_ptr_->GetOutputSchema(),
+                                                                      right_tuple,
+                                                                      right_executor_ptr_->GetOutputSchema()))){
+        batch->Append(CombineTuple(left_tuple, right_tuple), RID());
+      }
+    }
+    if (right_idx_ == right_batch_.Size()){
+      right_idx_ = 0;
+      left_idx_++;
+    }
+  }
+  return !batch->IsEmpty();
+}
+
 }  // namespace bustub
@@ -9,6 +9,10 @@
 // Copyright (c) 2015-19, Carnegie Mellon University Database Group
 //
 //===----------------------------------------------------------------------===//
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <utility>
+
 #include "execution/executors/seq_scan_executor.h"
 
 namespace bustub {
@@ -16,25 +20,101 @@ namespace bustub {
 SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
     : AbstractExecutor(exec_ctx), plan_(plan){}
 
+SeqScanExecutor::~SeqScanExecutor() { StopWorkers(false); }
+
 void SeqScanExecutor::Init() {
-  BufferPoolManager *bpm_ptr = exec_ctx_->GetBufferPoolManager();
   table_oid_t table_id = plan_->GetTableOid();
   table_metadata_ptr_ = GetExecutorContext()->GetCatalog()->GetTable(table_id);
   table_heap_ptr_ = table_metadata_ptr_->table_.get();
-  page_id_t first_page_id = table_heap_ptr_->GetFirstPageId();
+  if (IsParallel()){
+    StopWorkers(false);
+    StartWorkers();
+    return;
+  }
+  page_id_t first_page_id = first_page_id_ == INVALID_PAGE_ID ? table_heap_ptr_->GetFirstPageId() : first_page_id_;
 
-  Page *page_ptr = bpm_ptr->FetchPage(first_page_id);
+  if (plan_->GetPredicate() != nullptr){
+    compiled_predicate_ = ExpressionCompiler::CompilePredicate(plan_->GetPredicate(), &table_metadata_ptr_->schema_);
+  }
+  compiled_projection_ = ExpressionCompiler::CompileProjection(GetOutputSchema(), &table_metadata_ptr_->schema_);
+
+  // The cursor pins each page once for all its tuples, instead of fetching it again for every tuple.
+  // Under READ_UNCOMMITTED a compiled predicate is pushed down to the pages, so rejected tuples are never copied.
+  // The other levels must not skip a tuple on its unlocked bytes, which may hold a change not committed yet, so
+  // they filter it once it is locked (see Next). A snapshot may see an older version than the page holds, even a
+  // deleted one, so nothing is skipped for it in the page.
+  Transaction *txn = GetExecutorContext()->GetTransaction();
+  bool snapshot = txn->IsSnapshot();
+  bool push_down = !snapshot && txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED;
+  cursor_ = std::make_unique<TableCursor>(table_heap_ptr_, first_page_id, stop_page_id_,
+                                          push_down ? compiled_predicate_.GetRowFunction() : nullptr, snapshot);
+}
 
-  RID rid{};
-  TablePage *table_page_ptr = reinterpret_cast<TablePage *>(page_ptr);
-  table_page_ptr->GetFirstTupleRid(&rid);
+void SeqScanExecutor::StartWorkers() {
+  // A table whose pages cannot be listed aborts the transaction, there is then nothing to scan and no worker
+  std::vector<page_id_t> page_ids;
+  table_heap_ptr_->GetPageIds(GetExecutorContext()->GetTransaction(), &page_ids);
+  size_t num_workers = std::min<size_t>(plan_->GetParallelism(), page_ids.size());
+  morsel_source_ = std::make_unique<MorselSource>(std::move(page_ids));
+  // Two batches per worker in flight keeps the workers busy while the consumer catches up
+  exchange_ = std::make_unique<ExchangeQueue<TupleBatch>>(2 * num_workers, num_workers);
+  exchange_batch_.Clear();
+  exchange_idx_ = 0;
 
-  bpm_ptr->UnpinPage(first_page_id, false);
+  // Producers never wait on the exchange, a full one parks them (see Produce), so they do not hold the workers.
+  // There are only as many of them as the plan asks for, each claiming morsels until none is left, rather than
+  // one task per morsel
+  worker_group_ = std::make_unique<TaskGroup>(GetExecutorContext()->GetTaskScheduler());
+  for (size_t w = 0; w < num_workers; w++){
+    // A page range makes the worker's own scan serial
+    auto scan = std::make_shared<SeqScanExecutor>(GetExecutorContext(), plan_);
+    scan->SetBloomFilter(bloom_col_idx_, bloom_filter_);
+    worker_group_->Run([this, scan]{ Produce(scan); });
+  }
+}
 
-  table_iter_ = TableIterator(table_heap_ptr_, rid, GetExecutorContext()->GetTransaction());
+void SeqScanExecutor::Produce(const std::shared_ptr<SeqScanExecutor> &scan) {
+  try {
+    TupleBatch batch;
+    page_id_t first_page_id;
+    page_id_t stop_page_id;
+    while (!exchange_->IsClosed()){
+      // The scan has no cursor until it claimed its first morsel
+      if (scan->cursor_ == nullptr || !scan->NextBatch(&batch)){
+        if (!morsel_source_->Claim(&first_page_id, &stop_page_id)){
+          break;
+        }
+        scan->SetPageRange(first_page_id, stop_page_id);
+        scan->Init();
+        continue;
+      }
+      // Parked on a full exchange: stop here, the consumer resubmits the rest once it made room
+      if (!exchange_->Push(std::move(batch), [this, scan]{ worker_group_->Run([this, scan]{ Produce(scan); }); })){
+        return;
+      }
+    }
+  } catch (...) {
+    exchange_->Close();
+    exchange_->ProducerDone();
+    throw;
+  }
+  exchange_->ProducerDone();
+}
+
+void SeqScanExecutor::StopWorkers(bool rethrow) {
+  if (exchange_ != nullptr){
+    exchange_->Close();
+  }
+  if (worker_group_ != nullptr && rethrow){
+    worker_group_->Wait();
+  }
+  worker_group_.reset();
 }
 
 Tuple SeqScanExecutor::GenerateTuple(Tuple &tuple) {
+  if (compiled_projection_ != nullptr){
+    return compiled_projection_->Project(tuple);
+  }
   std::vector<Value> res_values;
   for (auto const &col:GetOutputSchema()->GetColumns()){
     res_values.push_back(col.GetExpr()->Evaluate(&tuple, &table_metadata_ptr_->schema_));
@@ -42,54 +122,175 @@ Tuple SeqScanExecutor::GenerateTuple(Tuple &tuple) {
   return {res_values, GetOutputSchema()};
 }
 
+bool SeqScanExecutor::Select(const TupleView &view, Tuple *tuple) {
+  Tuple borrowed = Tuple::Borrow(view);
+  bool selected = true;
+  if (compiled_predicate_.IsCompiled()){
+    selected = compiled_predicate_.GetRowFunction()(view.GetData());
+  } else if (plan_->GetPredicate() != nullptr){
+    selected = AbstractExpression::IsTrue(plan_->GetPredicate()->Evaluate(&borrowed, &table_metadata_ptr_->schema_));
+  }
+  selected = selected && MayMatchBloomFilter(borrowed);
+  if (selected){
+    *tuple = GenerateTuple(borrowed);
+  }
+  return selected;
+}
+
 void SeqScanExecutor::LockInNode(RID &rid) {
   Transaction *txn = GetExecutorContext()->GetTransaction();
-  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED){
+  // Snapshot reads never lock, writers do not block them
+  if (txn->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED || txn->IsSnapshot()){
     return ;
   }
-  if (txn->GetExclusiveLockSet()->find(rid) != txn->GetExclusiveLockSet()->end() ||
-      txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()){
-    return ;
+  {
+    // Parallel scans share one transaction, so its lock sets are only read under its latch
+    std::scoped_lock set_latch{txn->GetLockSetLatch()};
+    if (txn->IsExclusiveLocked(rid) || txn->IsSharedLocked(rid)){
+      return ;
+    }
   }
-  GetExecutorContext()->GetLockManager()->LockShared(txn, rid);
+  // The lock may wait for a writer, the other workers go on meanwhile: the lock manager takes the latch itself.
+  // Like TableHeap::VisitTuples, do not keep the page pinned while waiting, the read looks at the slot again.
+  cursor_->Unpin();
+  GetExecutorContext()->GetLockManager()->LockRowShared(txn, plan_->GetTableOid(), rid);
+  cursor_->Repin();
 }
 
 void SeqScanExecutor::UnlockInNode(RID &rid) {
   Transaction *txn = GetExecutorContext()->GetTransaction();
   // If in READ_COMMITTED isolation level and txn never lock this Record before this read
-  if (txn->GetIsolationLevel() == IsolationLevel::READ_COMMITTED &&
-      txn->GetExclusiveLockSet()->find(rid) == txn->GetExclusiveLockSet()->end()){
-    GetExecutorContext()->GetLockManager()->Unlock(txn, rid);
+  if (txn->GetIsolationLevel() != IsolationLevel::READ_COMMITTED){
+    return ;
+  }
+  {
+    std::scoped_lock set_latch{txn->GetLockSetLatch()};
+    if (!txn->IsSharedLocked(rid)){
+      return ;
+    }
   }
+  GetExecutorContext()->GetLockManager()->Unlock(txn, rid);
 }
 
-bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) {
-  while (table_iter_ != table_heap_ptr_->End()){
-    *tuple = *table_iter_;
-    *rid = tuple->GetRid();
+bool SeqScanExecutor::FetchNext(Tuple *tuple, RID *rid) {
+  while (cursor_->Advance()){
+    *rid = cursor_->GetRid();
 
     // Dyy:
-    // Well, seems stupid...
-    // use table_iter only to fetch the next tuple RID, assume RID
-    // is always available, then acquire the lock and fetch the tuple again
+    // use the cursor only to find the next tuple RID, assume RID
+    // is always available, then acquire the lock and copy the tuple from the pinned page
     // For different isolation level:
     //    READ_UNCOMMITTED: never acquire shared lock
     //    READ_COMMITTED: acquire shared lock and release it after read
     //    REPEATABLE_READ: acquire shared lock until commit or abort
-    LockInNode(*rid);
-    bool res = table_heap_ptr_->GetTuple(*rid, tuple, GetExecutorContext()->GetTransaction());
-    UnlockInNode(*rid);
-    table_iter_++;
-    if (!res){
+    Transaction *txn = GetExecutorContext()->GetTransaction();
+    bool res;
+    if (txn->IsSnapshot()){
+      res = cursor_->GetTuple(tuple, txn);
+    } else {
+      // The lock is taken here, the page read must not look at the lock sets of a transaction that parallel
+      // workers share: copy the tuple straight from the page
+      LockInNode(*rid);
+      TupleView view;
+      cursor_->RLatch();
+      res = cursor_->GetTupleView(&view);
+      if (res){
+        *tuple = Tuple(view);
+      }
+      cursor_->RUnlatch();
+      UnlockInNode(*rid);
+    }
+    if (res){
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) {
+  if (IsParallel()){
+    while (exchange_idx_ >= exchange_batch_.Size()){
+      if (!exchange_->Pop(&exchange_batch_)){
+        StopWorkers(true);
+        return false;
+      }
+      exchange_idx_ = 0;
+    }
+    *tuple = std::move(exchange_batch_.GetTuple(exchange_idx_));
+    *rid = exchange_batch_.GetRid(exchange_idx_);
+    exchange_idx_++;
+    return true;
+  }
+
+  // The table tuple is never copied, it is filtered and projected right in its page
+  Transaction *txn = GetExecutorContext()->GetTransaction();
+  while (cursor_->Advance()){
+    *rid = cursor_->GetRid();
+    if (txn->IsSnapshot()){
+      // The version seen may come from the version store, so it is copied out
+      Tuple version;
+      if (cursor_->GetTuple(&version, txn) && Select(version.GetView(), tuple)){
+        return true;
+      }
       continue;
     }
-    if ((plan_->GetPredicate() == nullptr) ||
-        plan_->GetPredicate()->Evaluate(tuple, plan_->OutputSchema()).GetAs<bool>()) {
-      *tuple = GenerateTuple(*tuple);
+    // Lock before latching, never the other way around (see TableCursor)
+    LockInNode(*rid);
+    TupleView view;
+    cursor_->RLatch();
+    bool selected = cursor_->GetTupleView(&view) && Select(view, tuple);
+    cursor_->RUnlatch();
+    UnlockInNode(*rid);
+    if (selected){
       return true;
     }
   }
   return false;
 }
 
+bool SeqScanExecutor::NextBatch(TupleBatch *batch) {
+  batch->Clear();
+  if (IsParallel()){
+    // Hand out what is left of a batch Next() started on first, then whole batches from the workers
+    if (exchange_idx_ < exchange_batch_.Size()){
+      exchange_batch_.Slice(exchange_idx_, exchange_batch_.Size());
+      std::swap(*batch, exchange_batch_);
+      exchange_batch_.Clear();
+      exchange_idx_ = 0;
+      return true;
+    }
+    if (!exchange_->Pop(batch)){
+      StopWorkers(true);
+      return false;
+    }
+    return true;
+  }
+  Tuple tuple;
+  RID rid;
+  // Read a whole batch of raw tuples first, then filter and project it in one pass.
+  // A batch may be filtered down to nothing, so keep reading until something survives.
+  while (batch->IsEmpty()){
+    raw_batch_.Clear();
+    while (!raw_batch_.IsFull() && FetchNext(&tuple, &rid)){
+      raw_batch_.Append(std::move(tuple), rid);
+    }
+    if (raw_batch_.IsEmpty()){
+      return false;
+    }
+
+    const AbstractExpression *predicate = plan_->GetPredicate();
+    if (compiled_predicate_.IsCompiled()){
+      compiled_predicate_.EvaluateBatch(raw_batch_, &selection_);
+    } else if (predicate != nullptr){
+      predicate->EvaluateBatch(raw_batch_, &table_metadata_ptr_->schema_, &selection_);
+    }
+    for (size_t i = 0; i < raw_batch_.Size(); i++){
+      if ((predicate == nullptr || selection_.Test(i)) && MayMatchBloomFilter(raw_batch_.GetTuple(i))){
+        batch->Append(GenerateTuple(raw_batch_.GetTuple(i)), raw_batch_.GetRid(i));
+      }
+    }
+  }
+  return true;
+}
+
 }  // namespace bustub
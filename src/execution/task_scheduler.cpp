@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// task_scheduler.cpp
+//
+// Identification: src/execution/task_scheduler.cpp
+//
+// Copyright (c) 2015-19, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/task_scheduler.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <utility>
+
+namespace bustub {
+
+namespace {
+/** The pool the calling thread works for, and its id in that pool. */
+thread_local TaskScheduler *current_scheduler = nullptr;
+thread_local size_t current_worker_id = TaskScheduler::NO_WORKER;
+}  // namespace
+
+TaskScheduler::TaskScheduler(size_t num_workers) : queues_(std::max<size_t>(num_workers, 1)) {
+  for (size_t w = 0; w < queues_.size(); w++) {
+    workers_.emplace_back([this, w] { WorkerLoop(w); });
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::scoped_lock lock(idle_latch_);
+    stop_ = true;
+  }
+  idle_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+TaskScheduler *TaskScheduler::GetInstance() {
+  static TaskScheduler instance{std::max<size_t>(std::thread::hardware_concurrency(), 2)};
+  return &instance;
+}
+
+size_t TaskScheduler::GetWorkerId() { return current_worker_id; }
+
+bool TaskScheduler::IsCurrentWorker() const { return current_scheduler == this; }
+
+void TaskScheduler::Submit(Task task) {
+  size_t queue_idx = IsCurrentWorker() ? current_worker_id : next_queue_++ % queues_.size();
+  {
+    // Counted under idle_latch_, so a worker going to sleep cannot miss it. Counted before the task is queued, so a
+    // worker that pops it right away never takes the count below zero
+    std::scoped_lock lock(idle_latch_);
+    queued_++;
+  }
+  {
+    std::scoped_lock lock(queues_[queue_idx].latch_);
+    queues_[queue_idx].tasks_.push_back(std::move(task));
+  }
+  idle_cv_.notify_one();
+}
+
+bool TaskScheduler::RunOne() {
+  BUSTUB_ASSERT(IsCurrentWorker(), "Only a worker of this pool runs its tasks.");
+  Task task;
+  if (!PopOrSteal(current_worker_id, &task)) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+bool TaskScheduler::PopOrSteal(size_t worker_id, Task *task) {
+  {
+    auto &own = queues_[worker_id];
+    std::scoped_lock lock(own.latch_);
+    if (!own.tasks_.empty()) {
+      *task = std::move(own.tasks_.back());
+      own.tasks_.pop_back();
+      queued_--;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); i++) {
+    auto &victim = queues_[(worker_id + i) % queues_.size()];
+    std::scoped_lock lock(victim.latch_);
+    if (!victim.tasks_.empty()) {
+      *task = std::move(victim.tasks_.front());
+      victim.tasks_.pop_front();
+      queued_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::WorkerLoop(size_t worker_id) {
+  current_scheduler = this;
+  current_worker_id = worker_id;
+  while (true) {
+    Task task;
+    if (PopOrSteal(worker_id, &task)) {
+      task();
+      continue;
+    }
+    std::unique_lock lock(idle_latch_);
+    idle_cv_.wait(lock, [&] { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+TaskGroup::~TaskGroup() { WaitAll(); }
+
+void TaskGroup::Run(TaskScheduler::Task task) {
+  {
+    std::scoped_lock lock(latch_);
+    pending_++;
+  }
+  scheduler_->Submit([this, task = std::move(task)] {
+    std::exception_ptr error;
+    try {
+      task();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::scoped_lock lock(latch_);
+    if (error != nullptr && error_ == nullptr) {
+      error_ = error;
+    }
+    if (--pending_ == 0) {
+      done_cv_.notify_all();
+    }
+  });
+}
+
+void TaskGroup::Wait() {
+  WaitAll();
+  std::exception_ptr error;
+  {
+    std::scoped_lock lock(latch_);
+    std::swap(error, error_);
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+void TaskGroup::WaitAll() {
+  std::unique_lock lock(latch_);
+  if (!scheduler_->IsCurrentWorker()) {
+    done_cv_.wait(lock, [&] { return pending_ == 0; });
+    return;
+  }
+  // A worker that just slept here could leave the group's own tasks queued behind it, so it runs tasks instead
+  while (pending_ != 0) {
+    lock.unlock();
+    bool ran = scheduler_->RunOne();
+    lock.lock();
+    if (!ran) {
+      done_cv_.wait_for(lock, std::chrono::milliseconds(1), [&] { return pending_ == 0; });
+    }
+  }
+}
+
+}  // namespace bustub
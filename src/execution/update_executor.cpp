@@ -29,13 +29,8 @@ void UpdateExecutor::Init() {
 
 void UpdateExecutor::LockInNode(RID &rid) {
   Transaction* txn = GetExecutorContext()->GetTransaction();
-  if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end()){
-    GetExecutorContext()->GetLockManager()->LockUpgrade(txn, rid);
-    return;
-  }
-  if (txn->GetExclusiveLockSet()->find(rid) == txn->GetExclusiveLockSet()->end()){
-    GetExecutorContext()->GetLockManager()->LockExclusive(txn, rid);
-  }
+  // Upgrades a shared lock on the row, or nothing at all if the table is locked exclusively
+  GetExecutorContext()->GetLockManager()->LockRowExclusive(txn, plan_->TableOid(), rid);
 }
 
 void UpdateExecutor::UpdateTuple(Tuple &tuple, RID &rid){
@@ -15,11 +15,14 @@
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -91,12 +94,61 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Fetch a page and pin it, the guard unpins it.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  BasicPageGuard FetchPageBasic(page_id_t page_id) { return {this, FetchPage(page_id)}; }
+
+  /**
+   * Fetch a page, pin it and read latch it, the guard releases both.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  ReadPageGuard FetchPageRead(page_id_t page_id) { return {this, FetchPage(page_id)}; }
+
+  /**
+   * Fetch a page, pin it and write latch it, the guard releases both.
+   * @param page_id id of page to be fetched
+   * @return a guard holding the page, empty if the page could not be fetched
+   */
+  WritePageGuard FetchPageWrite(page_id_t page_id) { return {this, FetchPage(page_id)}; }
+
+  /**
+   * Create a new page, pinned and write latched, the guard releases both.
+   * @param[out] page_id id of created page
+   * @return a guard holding the page, empty if no new page could be created
+   */
+  WritePageGuard NewPageGuarded(page_id_t *page_id) { return {this, NewPage(page_id)}; }
+
   /** @return pointer to all the pages in the buffer pool */
   Page *GetPages() { return pages_; }
 
   /** @return size of the buffer pool */
   size_t GetPoolSize() { return pool_size_; }
 
+  /**
+   * Collects the dirty page table: the pages that are dirty, or pinned and possibly being changed, each with its
+   * recLSN, the lsn of the first log record that may have changed it since it was last written.
+   * @param[out] dirty_pages the (page id, recLSN) pairs
+   */
+  void GetDirtyPageTable(std::vector<std::pair<page_id_t, lsn_t>> *dirty_pages);
+
+  /**
+   * Writes the page to disk if it is dirty, and keeps it in the buffer pool. Unlike FlushPage, the page may be pinned
+   * and in use meanwhile, writers only wait for the write itself.
+   * @param page_id id of page to be written
+   * @return false if the page could not be found in the page table, true otherwise
+   */
+  bool WriteBackPage(page_id_t page_id);
+
+  /**
+   * @param page_id id of a page
+   * @return the number of times the page was fetched since it was read into the buffer pool, 0 if it is not there
+   */
+  size_t GetFetchCount(page_id_t page_id);
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -166,8 +218,19 @@ class BufferPoolManager {
     return search->second;
   }
 
+  /**
+   * Takes a frame from the free list, or else evicts a victim. Called under latch_, which is released while a dirty
+   * victim is written back.
+   * @return the frame, or INVALID_FRAME_ID if every page is pinned
+   */
   frame_id_t GetAvailablePage();
 
+  /** Writes page to disk, once the log records up to its LSN are there. */
+  void WritePage(Page *page);
+
+  /** Sets the recLSN of a page that is about to be pinned, unless it has one already. */
+  void SetRecLSN(Page *page);
+
   /** Number of pages in the buffer pool. */
   size_t pool_size_;
   /** Array of buffer pool pages. */
@@ -175,7 +238,7 @@ class BufferPoolManager {
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
   /** Page table for keeping track of buffer pool pages. */
   std::unordered_map<page_id_t, frame_id_t> page_table_;
   /** Replacer to find unpinned pages for replacement. */
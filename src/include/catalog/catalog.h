@@ -80,6 +80,7 @@ class Catalog {
 
     table_oid_t table_oid = next_table_oid_++;
     std::unique_ptr<TableHeap> table(new TableHeap(bpm_, lock_manager_, log_manager_, txn));
+    table->SetOid(table_oid);
     std::unique_ptr<TableMetadata> table_meta_data_ptr(new TableMetadata(schema, table_name,
                                                                             std::move(table), table_oid));
     TableMetadata* ptr = table_meta_data_ptr.get();
@@ -18,9 +18,6 @@
 
 namespace bustub {
 
-/** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
-extern std::chrono::milliseconds cycle_detection_interval;
-
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
@@ -31,16 +28,23 @@ static constexpr int INVALID_FRAME_ID = -1;                                   //
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
+static constexpr int INVALID_TS = -1;                                         // invalid commit timestamp
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int BATCH_SIZE = 1024;                                       // max tuples per NextBatch() call
+static constexpr int MORSEL_SIZE = 8;                                         // heap pages per parallel scan morsel
+static constexpr int LOCK_TABLE_SHARDS = 64;                                  // latches of the lock manager table
+static constexpr size_t LOCK_ESCALATION_THRESHOLD = 4096;                     // row locks in a table before escalating
+static constexpr int TXN_MAP_SHARDS = 64;                                     // latches of the transaction registry
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
+using timestamp_t = int64_t;   // commit timestamp type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
@@ -13,12 +13,12 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <condition_variable>  // NOLINT
-#include <list>
+#include <functional>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <unordered_map>
-#include <set>
 #include <utility>
 #include <vector>
 
@@ -29,45 +29,105 @@ namespace bustub {
 class TransactionManager;
 
 /**
- * LockManager handles transactions asking for locks on records.
+ * LockRequest is one transaction's request for a lock on one RID. Requests are pooled by the lock manager and
+ * linked into the queue of their RID in place, the transaction keeps a handle on its granted requests.
  */
-class LockManager {
-  enum class LockMode { SHARED, EXCLUSIVE };
-
-  class LockRequest {
-   public:
-    LockRequest(txn_id_t txn_id, LockMode lock_mode) : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+class LockRequest {
+ public:
+  txn_id_t txn_id_{INVALID_TXN_ID};
+  LockMode lock_mode_{LockMode::SHARED};
+  bool granted_{false};
+  /** Neighbours in the queue of the RID, or the next free request of the pool */
+  LockRequest *prev_{nullptr};
+  LockRequest *next_{nullptr};
+};
 
-    txn_id_t txn_id_;
-    LockMode lock_mode_;
-    bool granted_;
-  };
+/**
+ * How the lock manager deals with deadlocks. DETECTION keeps a waits-for graph up to date as transactions block
+ * and aborts the newest transaction of a cycle as soon as it closes. WOUND_WAIT and WAIT_DIE prevent cycles by
+ * comparing transaction ids (older transactions have smaller ids) and need no graph: under WOUND_WAIT an older
+ * transaction aborts the younger ones it waits for, under WAIT_DIE a younger transaction aborts itself rather
+ * than wait for an older one.
+ */
+enum class DeadlockMode { DETECTION, WOUND_WAIT, WAIT_DIE };
 
+/**
+ * LockManager handles transactions asking for locks on records, and on the tables holding them.
+ */
+class LockManager {
   class LockRequestQueue {
    public:
-    std::list<LockRequest> request_queue_;
+    /** Append a request at the tail of this queue. */
+    void Append(LockRequest *request) {
+      request->prev_ = tail_;
+      request->next_ = nullptr;
+      (tail_ == nullptr ? head_ : tail_->next_) = request;
+      tail_ = request;
+    }
+
+    /** Unlink a request of this queue. */
+    void Remove(LockRequest *request) {
+      (request->prev_ == nullptr ? head_ : request->prev_->next_) = request->next_;
+      (request->next_ == nullptr ? tail_ : request->next_->prev_) = request->prev_;
+    }
+
+    /** @return true if no transaction holds or waits for a lock on this RID */
+    bool IsEmpty() const { return head_ == nullptr; }
+
+    /** Make this queue empty, for reuse on another RID. */
+    void Reset() {
+      head_ = tail_ = nullptr;
+      upgrading_ = false;
+      sharing_count_ = 0;
+      is_writing_ = false;
+    }
+
+    LockRequest *head_ = nullptr;
+    LockRequest *tail_ = nullptr;
     std::condition_variable cv_;  // for notifying blocked transactions on this rid
     bool upgrading_ = false;
     int sharing_count_ = 0;
     bool is_writing_ = false;
   };
 
- public:
+  using RowLockTable = std::unordered_map<RID, LockRequestQueue>;
+
   /**
-   * Creates a new lock manager configured for the deadlock detection policy.
+   * The transactions holding or waiting for a lock on one table. There are few tables and table locks are taken
+   * once per transaction, so requests are kept by transaction id rather than pooled like row requests.
    */
-  LockManager() {
-    enable_cycle_detection_ = true;
-    cycle_detection_thread_ = new std::thread(&LockManager::RunCycleDetection, this);
-    LOG_INFO("Cycle detection thread launched");
-  }
+  class TableLockQueue {
+   public:
+    std::unordered_map<txn_id_t, LockMode> granted_;
+    std::unordered_map<txn_id_t, LockMode> waiting_;
+    std::condition_variable cv_;  // for notifying blocked transactions on this table
+  };
 
-  ~LockManager() {
-    enable_cycle_detection_ = false;
-    cycle_detection_thread_->join();
-    delete cycle_detection_thread_;
-    LOG_INFO("Cycle detection thread stopped");
-  }
+  /** Requests are allocated this many at a time. */
+  static constexpr size_t REQUEST_CHUNK_SIZE = 64;
+  /** Empty queues kept per shard for reuse, beyond that they are freed. */
+  static constexpr size_t MAX_FREE_QUEUES = 64;
+
+  /**
+   * One partition of the lock table, the RIDs hashing to it share its latch. Waiters block on the condition
+   * variable of their own queue, releasing only this latch. Padded so neighbouring latches do not share a line.
+   * Queues are dropped once empty, their map nodes and requests are recycled so that locking an idle RID does
+   * not allocate once the shard is warm.
+   */
+  struct alignas(64) LockTableShard {
+    std::mutex latch_;
+    RowLockTable lock_table_;
+    std::vector<RowLockTable::node_type> free_queues_;
+    LockRequest *free_requests_ = nullptr;
+    std::vector<std::unique_ptr<LockRequest[]>> request_chunks_;
+  };
+
+ public:
+  /**
+   * Creates a new lock manager configured for the given deadlock policy.
+   * @param deadlock_mode how deadlocks are detected or prevented
+   */
+  explicit LockManager(DeadlockMode deadlock_mode = DeadlockMode::DETECTION) : deadlock_mode_(deadlock_mode) {}
 
   /*
    * [LOCK_NOTE]: For all locking functions, we:
@@ -77,7 +137,14 @@ class LockManager {
    *    is responsible for keeping track of its current locks.
    */
 
-  void check_aborted(Transaction* txn, LockRequestQueue* request_queue);
+  /**
+   * If txn was aborted while waiting, withdraw its request and throw.
+   * @param txn the waiting transaction
+   * @param shard the shard of rid, latched by the caller
+   * @param rid the RID txn is waiting for
+   * @param request the request of txn on rid
+   */
+  void check_aborted(Transaction* txn, LockTableShard *shard, const RID &rid, LockRequest *request);
 
   /**
    * Acquire a lock on RID in shared mode. See [LOCK_NOTE] in header file.
@@ -87,7 +154,16 @@ class LockManager {
    */
   bool LockShared(Transaction *txn, const RID &rid);
 
-  bool LockPrepare(Transaction* txn, const RID &rid);
+  /**
+   * Acquire a lock on RID in shared mode only if nobody writes it, without waiting. Never throws.
+   * @param txn the transaction requesting the shared lock
+   * @param rid the RID to be locked in shared mode
+   * @return true if the lock is granted, false if it is exclusively locked or txn is not growing
+   */
+  bool TryLockShared(Transaction *txn, const RID &rid);
+
+  /** @return the queue of rid in shard, created if it does not exist yet */
+  LockRequestQueue *LockPrepare(Transaction* txn, LockTableShard *shard, const RID &rid);
 
   /**
    * Acquire a lock on RID in exclusive mode. See [LOCK_NOTE] in header file.
@@ -97,6 +173,16 @@ class LockManager {
    */
   bool LockExclusive(Transaction *txn, const RID &rid);
 
+  /**
+   * Acquire a lock on RID in exclusive mode only if nobody holds or waits for one, without waiting. Never throws:
+   * the garbage collector, which purges with it, gives up on a RID it cannot lock right away, and an insert under
+   * the page latch passes over a free slot that is still locked.
+   * @param txn the transaction requesting the exclusive lock
+   * @param rid the RID to be locked in exclusive mode
+   * @return true if the lock is granted, false if it is not free or txn is not growing
+   */
+  bool TryLockExclusive(Transaction *txn, const RID &rid);
+
   /**
    * Upgrade a lock from a shared lock to an exclusive lock.
    * @param txn the transaction requesting the lock upgrade
@@ -113,12 +199,62 @@ class LockManager {
    */
   bool Unlock(Transaction *txn, const RID &rid);
 
-  std::list<LockRequest>::iterator GetIterator(std::list<LockRequest> &request_queue, txn_id_t txn_id);
+  /**
+   * Acquire a lock on a table. If txn already locks the table, its lock is upgraded to the weakest mode covering
+   * both the held and the requested one, e.g. SHARED and INTENTION_EXCLUSIVE make SHARED_INTENTION_EXCLUSIVE.
+   * @param txn the transaction requesting the lock
+   * @param oid the table to be locked
+   * @param lock_mode the mode to lock the table in
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockTable(Transaction *txn, table_oid_t oid, LockMode lock_mode);
 
-  /*** Graph API ***/
   /**
-   * Adds edge t1->t2
+   * Release the table lock held by the transaction.
+   * @param txn the transaction releasing the lock
+   * @param oid the table locked by the transaction
+   * @return true if the unlock is successful, false otherwise
    */
+  bool UnlockTable(Transaction *txn, table_oid_t oid);
+
+  /**
+   * Lock a row of a table in shared mode, under the matching intention lock on the table. Nothing is locked if
+   * the table lock already covers the row. Once txn keeps more than LOCK_ESCALATION_THRESHOLD row locks in the
+   * table, the table is locked SHARED instead of the row.
+   * @param txn the transaction requesting the shared lock
+   * @param oid the table of the row
+   * @param rid the RID to be locked in shared mode
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockRowShared(Transaction *txn, table_oid_t oid, const RID &rid);
+
+  /**
+   * Lock a row of a table in shared mode like LockRowShared, but only if that does not wait. Whatever might wait,
+   * taking the intention lock on the table, escalating or a writer on the row, is left to LockRowShared.
+   * @param txn the transaction requesting the shared lock
+   * @param oid the table of the row
+   * @param rid the RID to be locked in shared mode
+   * @return true if the row is locked, or the table lock covers it
+   */
+  bool TryLockRowShared(Transaction *txn, table_oid_t oid, const RID &rid);
+
+  /**
+   * Lock a row of a table in exclusive mode, upgrading a shared lock on it, under an INTENTION_EXCLUSIVE lock
+   * on the table. Escalates to an EXCLUSIVE table lock like LockRowShared does to a SHARED one.
+   * @param txn the transaction requesting the exclusive lock
+   * @param oid the table of the row
+   * @param rid the RID to be locked in exclusive mode
+   * @return true if the lock is granted, false otherwise
+   */
+  bool LockRowExclusive(Transaction *txn, table_oid_t oid, const RID &rid);
+
+  /** @return true if a table lock in mode held grants everything a lock in mode requested does */
+  static bool Covers(LockMode held, LockMode requested);
+
+  /** @return true if two transactions may lock one table in these modes at the same time */
+  static bool AreCompatible(LockMode granted, LockMode requested);
+
+  /*** Graph API ***/
 
   /** Adds an edge from t1 -> t2. */
   void AddEdge(txn_id_t t1, txn_id_t t2);
@@ -133,35 +269,111 @@ class LockManager {
    */
   bool HasCycle(txn_id_t *txn_id);
 
+  /** @return the number of RIDs with a lock queue, used for testing only! */
+  size_t GetQueueCount() {
+    size_t count = 0;
+    for (auto &shard : shards_) {
+      std::scoped_lock lock(shard.latch_);
+      count += shard.lock_table_.size();
+    }
+    return count;
+  }
+
   /** @return the set of all edges in the graph, used for testing only! */
   std::vector<std::pair<txn_id_t, txn_id_t>> GetEdgeList();
 
-  /** Abort a txn and delete all relative edges */
-  void DeleteNode(txn_id_t txn_id);
+ private:
+  /**
+   * @return the shard of the lock table holding rid. The page id sits in the high bits of the packed rid, so the bits
+   * are mixed with the murmur3 finalizer first; otherwise all rows with the same slot would share a shard.
+   */
+  LockTableShard *GetShard(const RID &rid) {
+    auto h = static_cast<uint64_t>(rid.Get());
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return &shards_[h % LOCK_TABLE_SHARDS];
+  }
+
+  /** @return the queue of rid, which must exist, the caller holds the latch of its shard */
+  LockRequestQueue *GetQueue(const RID &rid) { return &GetShard(rid)->lock_table_.find(rid)->second; }
 
-  /** Runs cycle detection in the background. */
-  void RunCycleDetection();
-  /** dfs function */
-  bool dfs(txn_id_t txn_id);
+  /** @return the queue of rid in shard, created if it does not exist yet, the caller holds the latch of shard */
+  LockRequestQueue *FindOrCreateQueue(LockTableShard *shard, const RID &rid);
 
+  /** @return a request of txn from the pool of shard */
+  LockRequest *NewRequest(LockTableShard *shard, txn_id_t txn_id, LockMode lock_mode);
 
- private:
-  std::mutex latch_;
-  std::atomic<bool> enable_cycle_detection_;
-  std::thread *cycle_detection_thread_;
+  /** Unlink a request from the queue of rid and return it to the pool, dropping the queue once it is empty. */
+  void FreeRequest(LockTableShard *shard, const RID &rid, LockRequestQueue *request_queue, LockRequest *request);
+
+  /** What a blocked transaction waits for, so that it can be woken up when it gets aborted. */
+  struct WaitTarget {
+    bool is_table_;
+    RID rid_;
+    table_oid_t oid_;
+  };
+
+  /** @return the transactions holding a lock on the queue's RID that conflicts with request */
+  static std::vector<txn_id_t> GetBlockers(LockRequestQueue *request_queue, LockRequest *request);
+
+  /** @return the transactions holding a lock on the queue's table that conflicts with lock_mode */
+  static std::vector<txn_id_t> GetBlockers(TableLockQueue *queue, txn_id_t txn_id, LockMode lock_mode);
+
+  /**
+   * Block txn on cv until ready() holds or txn gets aborted. Every time txn has to wait, the deadlock policy
+   * is applied to the transactions it waits for, as given by blockers().
+   * @param lock the latch of the wait target, held by the caller
+   */
+  void WaitUntil(Transaction *txn, std::unique_lock<std::mutex> *lock, std::condition_variable *cv,
+                 const WaitTarget &target, const std::function<bool()> &ready,
+                 const std::function<std::vector<txn_id_t>()> &blockers);
+
+  /**
+   * Apply the deadlock policy to txn waiting for blockers, which may abort txn or some of the blockers.
+   * @return the other transactions aborted, they must be woken up if they are waiting themselves
+   */
+  std::vector<txn_id_t> Block(Transaction *txn, const std::vector<txn_id_t> &blockers, const WaitTarget &target);
 
-  /** Lock table for lock requests. */
-  std::unordered_map<RID, LockRequestQueue> lock_table_;
-  /** Waits-for graph representation. */
+  /** txn no longer waits, drop its edges. */
+  void Unblock(txn_id_t txn_id);
+
+  /** Wake up the aborted transactions, if they are waiting. No latch may be held by the caller. */
+  void Wake(const std::vector<txn_id_t> &txn_ids);
+
+  /** Drop the edges from the waiters to txn_id, which just released a lock they wait for. */
+  void ReleaseWaiters(const std::vector<txn_id_t> &waiters, txn_id_t txn_id);
+
+  /** Removes an edge from t1 -> t2, the caller holds graph_latch_. */
+  void DropEdge(txn_id_t t1, txn_id_t t2);
+
+  /**
+   * Look for a cycle through start in the waits-for graph, the caller holds graph_latch_.
+   * @param[out] victim if there is a cycle, the newest transaction ID in it
+   * @return true if there is a cycle through start
+   */
+  bool FindCycle(txn_id_t start, txn_id_t *victim);
+
+  DeadlockMode deadlock_mode_;
+
+  /** Lock table for lock requests, partitioned by RID hash. */
+  std::array<LockTableShard, LOCK_TABLE_SHARDS> shards_;
+
+  /** Table locks, latched before the graph when both are needed. */
+  std::mutex table_latch_;
+  std::unordered_map<table_oid_t, TableLockQueue> table_lock_table_;
+
+  /**
+   * Waits-for graph, only kept under DETECTION. The out-edges of a transaction are set when it blocks and dropped
+   * once it is granted or aborted. Latched after the shard or table latch of the lock being waited for, and never
+   * while taking one.
+   */
+  std::mutex graph_latch_;
   std::unordered_map<txn_id_t, std::vector<txn_id_t>> waits_for_;
-  /** The nodes that is not included in a cycle */
-  std::set<txn_id_t> safe_set_;
-  /** all txns(nodes) */
-  std::set<txn_id_t> txn_set_;
-  /** all suspected txns in one dfs run */
-  std::unordered_set<txn_id_t> active_set_;
-  /** which Record a txn is waiting for, use to notify waiting txn */
-  std::unordered_map<txn_id_t, RID> require_record_;
+  /** What each blocked txn waits for, use to notify waiting txn */
+  std::unordered_map<txn_id_t, WaitTarget> waiting_on_;
 };
 
 }  // namespace bustub
@@ -15,8 +15,10 @@
 #include <atomic>
 #include <deque>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 
 #include "common/config.h"
@@ -46,7 +48,17 @@ enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 /**
  * Transaction isolation level.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+/**
+ * Isolation level. SNAPSHOT_ISOLATION reads the versions committed when the transaction began and takes no read
+ * locks, its writes still lock rows and abort if a newer version was committed since the snapshot.
+ */
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT_ISOLATION };
+
+/**
+ * Lock modes. Rows are only locked SHARED or EXCLUSIVE, tables in any mode: the intention modes announce
+ * row locks of that kind inside the table, SHARED_INTENTION_EXCLUSIVE is SHARED plus INTENTION_EXCLUSIVE.
+ */
+enum class LockMode { SHARED, EXCLUSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, SHARED_INTENTION_EXCLUSIVE };
 
 /**
  * Type of write operation.
@@ -55,6 +67,7 @@ enum class WType { INSERT = 0, DELETE, UPDATE };
 
 class TableHeap;
 class Catalog;
+class LockRequest;
 using table_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
@@ -107,7 +120,8 @@ enum class AbortReason {
   UNLOCK_ON_SHRINKING,
   UPGRADE_CONFLICT,
   DEADLOCK,
-  LOCKSHARED_ON_READ_UNCOMMITTED
+  LOCKSHARED_ON_READ_UNCOMMITTED,
+  WRITE_CONFLICT
 };
 
 /**
@@ -137,6 +151,9 @@ class TransactionAbortException : public std::exception {
         return "Transaction " + std::to_string(txn_id_) + " aborted on deadlock\n";
       case AbortReason::LOCKSHARED_ON_READ_UNCOMMITTED:
         return "Transaction " + std::to_string(txn_id_) + " aborted on lockshared on READ_UNCOMMITTED\n";
+      case AbortReason::WRITE_CONFLICT:
+        return "Transaction " + std::to_string(txn_id_) +
+               " aborted because a newer version was committed since its snapshot\n";
     }
     // Todo: Should fail with unreachable.
     return "";
@@ -154,8 +171,9 @@ class Transaction {
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
-        shared_lock_set_{new std::unordered_set<RID>},
-        exclusive_lock_set_{new std::unordered_set<RID>} {
+        shared_lock_set_{new std::unordered_map<RID, LockRequest *>},
+        exclusive_lock_set_{new std::unordered_map<RID, LockRequest *>},
+        table_lock_set_{new std::unordered_map<table_oid_t, LockMode>} {
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
@@ -216,11 +234,11 @@ class Transaction {
    */
   inline void AddIntoDeletedPageSet(page_id_t page_id) { deleted_page_set_->insert(page_id); }
 
-  /** @return the set of resources under a shared lock */
-  inline std::shared_ptr<std::unordered_set<RID>> GetSharedLockSet() { return shared_lock_set_; }
+  /** @return the set of resources under a shared lock, with the requests that granted them */
+  inline std::shared_ptr<std::unordered_map<RID, LockRequest *>> GetSharedLockSet() { return shared_lock_set_; }
 
-  /** @return the set of resources under an exclusive lock */
-  inline std::shared_ptr<std::unordered_set<RID>> GetExclusiveLockSet() { return exclusive_lock_set_; }
+  /** @return the set of resources under an exclusive lock, with the requests that granted them */
+  inline std::shared_ptr<std::unordered_map<RID, LockRequest *>> GetExclusiveLockSet() { return exclusive_lock_set_; }
 
   /** @return true if rid is shared locked by this transaction */
   bool IsSharedLocked(const RID &rid) { return shared_lock_set_->find(rid) != shared_lock_set_->end(); }
@@ -228,6 +246,52 @@ class Transaction {
   /** @return true if rid is exclusively locked by this transaction */
   bool IsExclusiveLocked(const RID &rid) { return exclusive_lock_set_->find(rid) != exclusive_lock_set_->end(); }
 
+  /** @return the tables locked by this transaction, with their lock mode */
+  inline std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> GetTableLockSet() { return table_lock_set_; }
+
+  /**
+   * @param oid the table
+   * @param[out] mode the mode this transaction locks the table in, if it does
+   * @return true if this transaction locks the table
+   */
+  bool IsTableLocked(table_oid_t oid, LockMode *mode) {
+    auto iter = table_lock_set_->find(oid);
+    if (iter == table_lock_set_->end()) {
+      return false;
+    }
+    *mode = iter->second;
+    return true;
+  }
+
+  /**
+   * Count one more row lock kept in a table, to know when to escalate to a table lock.
+   * @return the number of row locks kept in the table so far
+   */
+  inline size_t AddRowLock(table_oid_t oid) { return ++row_lock_count_[oid]; }
+
+  /** @return the number of row locks kept in a table so far */
+  size_t GetRowLockCount(table_oid_t oid) {
+    auto iter = row_lock_count_.find(oid);
+    return iter == row_lock_count_.end() ? 0 : iter->second;
+  }
+
+  /**
+   * The workers of a parallel query share their transaction, the lock manager reads and updates the lock sets
+   * under this latch. It is never held while waiting for a lock.
+   * @return the latch of the lock sets
+   */
+  std::mutex &GetLockSetLatch() { return lock_set_latch_; }
+
+  /** @return the request through which the lock manager granted this transaction its lock on rid, nullptr if none */
+  LockRequest *GetLockRequest(const RID &rid) {
+    auto iter = exclusive_lock_set_->find(rid);
+    if (iter != exclusive_lock_set_->end()) {
+      return iter->second;
+    }
+    iter = shared_lock_set_->find(rid);
+    return iter == shared_lock_set_->end() ? nullptr : iter->second;
+  }
+
   /** @return the current state of the transaction */
   inline TransactionState GetState() { return state_; }
 
@@ -237,6 +301,27 @@ class Transaction {
    */
   inline void SetState(TransactionState state) { state_ = state; }
 
+  /**
+   * Set the state of the transaction only if it still is the expected one. The lock manager aborts transactions
+   * from other threads, so a transition that must not undo such an abort, or that must not abort a transaction
+   * which has committed meanwhile, goes through here.
+   * @param expected the state the transaction must be in
+   * @param state new state
+   * @return true if the transaction was in the expected state and is now in the new one
+   */
+  inline bool CompareAndSetState(TransactionState expected, TransactionState state) {
+    return state_.compare_exchange_strong(expected, state);
+  }
+
+  /** @return true if this transaction reads from a snapshot */
+  inline bool IsSnapshot() const { return isolation_level_ == IsolationLevel::SNAPSHOT_ISOLATION; }
+
+  /** @return the timestamp of the snapshot this transaction reads, the last commit timestamp when it began */
+  inline timestamp_t GetReadTs() const { return read_ts_; }
+
+  /** @param read_ts the timestamp of the snapshot this transaction reads */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
   /** @return the previous LSN */
   inline lsn_t GetPrevLSN() { return prev_lsn_; }
 
@@ -246,9 +331,15 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the BEGIN record of the transaction */
+  inline lsn_t GetBeginLSN() { return begin_lsn_; }
+
+  /** @param begin_lsn the LSN of the BEGIN record of the transaction */
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
  private:
   /** The current transaction state. */
-  TransactionState state_;
+  std::atomic<TransactionState> state_;
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
   /** The thread ID, used in single-threaded transactions. */
@@ -260,18 +351,27 @@ class Transaction {
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
-  /** The LSN of the last record written by the transaction. */
-  lsn_t prev_lsn_;
+  /** The LSN of the last record written by the transaction, read by checkpoints while the transaction runs. */
+  std::atomic<lsn_t> prev_lsn_;
+  /** The LSN of the BEGIN record, the log is kept from there on while the transaction runs. */
+  std::atomic<lsn_t> begin_lsn_{INVALID_LSN};
+  /** TransactionManager: the snapshot of a SNAPSHOT_ISOLATION transaction. */
+  timestamp_t read_ts_{INVALID_TS};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
   /** Concurrent index: the page IDs that were deleted during index operation.*/
   std::shared_ptr<std::unordered_set<page_id_t>> deleted_page_set_;
 
-  /** LockManager: the set of shared-locked tuples held by this transaction. */
-  std::shared_ptr<std::unordered_set<RID>> shared_lock_set_;
-  /** LockManager: the set of exclusive-locked tuples held by this transaction. */
-  std::shared_ptr<std::unordered_set<RID>> exclusive_lock_set_;
+  /** LockManager: the set of shared-locked tuples held by this transaction, with their granted requests. */
+  std::shared_ptr<std::unordered_map<RID, LockRequest *>> shared_lock_set_;
+  /** LockManager: the set of exclusive-locked tuples held by this transaction, with their granted requests. */
+  std::shared_ptr<std::unordered_map<RID, LockRequest *>> exclusive_lock_set_;
+  /** LockManager: the tables locked by this transaction, and how many row locks it took in each of them. */
+  std::shared_ptr<std::unordered_map<table_oid_t, LockMode>> table_lock_set_;
+  std::unordered_map<table_oid_t, size_t> row_lock_count_;
+  /** LockManager: guards the lock sets above. */
+  std::mutex lock_set_latch_;
 };
 
 }  // namespace bustub
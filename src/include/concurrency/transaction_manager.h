@@ -12,13 +12,20 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction.h"
+#include "concurrency/version_store.h"
 #include "recovery/log_manager.h"
 
 namespace bustub {
@@ -32,7 +39,8 @@ class TransactionManager {
   explicit TransactionManager(LockManager *lock_manager, LogManager *log_manager = nullptr)
       : lock_manager_(lock_manager), log_manager_(log_manager) {}
 
-  ~TransactionManager() = default;
+  /** Drops the transactions still running, as after a crash, from the registry. */
+  ~TransactionManager();
 
   /**
    * Begins a new transaction.
@@ -54,32 +62,82 @@ class TransactionManager {
    */
   void Abort(Transaction *txn);
 
-  /**
-   * Global list of running transactions
-   */
-
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-
   /**
    * Locates and returns the transaction with the given transaction ID.
-   * @param txn_id the id of the transaction to be found, it must exist!
-   * @return the transaction with the given transaction id
+   * @param txn_id the id of the transaction to be found
+   * @return the transaction with the given transaction id, nullptr once it has committed or aborted
    */
   static Transaction *GetTransaction(txn_id_t txn_id) {
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
-    assert(res != nullptr);
-    return res;
+    TxnMapShard &shard = GetTxnMapShard(txn_id);
+    std::scoped_lock lock(shard.latch_);
+    auto iter = shard.txns_.find(txn_id);
+    return iter == shard.txns_.end() ? nullptr : iter->second.second;
   }
 
-  /** Prevents all transactions from performing operations, used for checkpointing. */
+  /**
+   * Prevents all transactions from performing operations, used for checkpointing. New transactions wait in Begin,
+   * and this returns once the running ones have committed or aborted. Only one caller may block at a time.
+   */
   void BlockAllTransactions();
 
   /** Resumes all transactions, used for checkpointing. */
   void ResumeTransactions();
 
+  /**
+   * Collects the active transaction table, used for fuzzy checkpointing: the running transactions are not blocked,
+   * so the table may be stale by the time it is returned.
+   * @param[out] active_txns the (transaction id, lsn of the last log record) pairs of the running transactions
+   * @return the lsn of the oldest BEGIN record of a running transaction, INVALID_LSN if none has logged yet
+   */
+  lsn_t GetActiveTransactions(std::vector<std::pair<txn_id_t, lsn_t>> *active_txns);
+
+  /** @return the timestamp of the last commit */
+  timestamp_t GetLastCommitTs() {
+    std::scoped_lock lock(commit_latch_);
+    return last_commit_ts_;
+  }
+
  private:
+  /** A latch of the transaction registry and the running transactions it covers. */
+  struct alignas(64) TxnMapShard {
+    std::mutex latch_;
+    /** The running transactions, with the transaction manager that began each. */
+    std::unordered_map<txn_id_t, std::pair<TransactionManager *, Transaction *>> txns_;
+  };
+
+  /** The number of running transactions begun on one shard, each in its own cache line. */
+  struct alignas(64) ActiveCount {
+    std::atomic<int64_t> count_{0};
+  };
+
+  /** @return the shard of the transaction registry holding txn_id */
+  static TxnMapShard &GetTxnMapShard(txn_id_t txn_id) {
+    return txn_map_[static_cast<uint32_t>(txn_id) % TXN_MAP_SHARDS];
+  }
+
+  /** Counts txn as running, waiting while all transactions are blocked. */
+  void Enter(Transaction *txn);
+
+  /** Stops counting txn as running and drops it from the registry. */
+  void Exit(Transaction *txn);
+
+  /**
+   * Drop the versions no snapshot sees any more and purge the deleted tuples that go with them, once a commit left
+   * new versions or a snapshot ended. The purges run in a transaction of their own, which locks each tuple and
+   * logs its delete: the transaction that triggered the pass has already released its locks.
+   */
+  void CollectGarbage();
+
+  /** Stop tracking the snapshot of txn once it ends, the caller holds commit_latch_. */
+  void EndSnapshot(Transaction *txn) {
+    if (txn->IsSnapshot() && txn->GetReadTs() != INVALID_TS) {
+      active_snapshots_.erase(active_snapshots_.find(txn->GetReadTs()));
+      VersionStore::RemoveSnapshot();
+      txn->SetReadTs(INVALID_TS);
+    }
+  }
+
+
   /**
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
@@ -87,22 +145,55 @@ class TransactionManager {
   void ReleaseLocks(Transaction *txn) {
     std::unordered_set<RID> lock_set;
     for (auto item : *txn->GetExclusiveLockSet()) {
-      lock_set.emplace(item);
+      lock_set.emplace(item.first);
     }
     for (auto item : *txn->GetSharedLockSet()) {
-      lock_set.emplace(item);
+      lock_set.emplace(item.first);
     }
     for (auto locked_rid : lock_set) {
       lock_manager_->Unlock(txn, locked_rid);
     }
+    // Table locks last, rows are locked under them
+    std::vector<table_oid_t> table_set;
+    for (auto const &item : *txn->GetTableLockSet()) {
+      table_set.emplace_back(item.first);
+    }
+    for (auto oid : table_set) {
+      lock_manager_->UnlockTable(txn, oid);
+    }
   }
 
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /**
+   * The registry of the running transactions of every transaction manager, sharded by transaction id so that
+   * begins and commits only contend with those hashing to the same latch.
+   */
+  static std::array<TxnMapShard, TXN_MAP_SHARDS> txn_map_;
+
+  /**
+   * Used for checkpointing, replacing a global reader-writer latch whose reader count every begin and commit
+   * would bounce: transactions only count themselves in their shard of active_, and read blocked_, which is only
+   * written by BlockAllTransactions and ResumeTransactions.
+   */
+  std::atomic<bool> blocked_{false};
+  std::array<ActiveCount, TXN_MAP_SHARDS> active_;
+  /** Guards the waits on blocked_ and on active_ draining. */
+  std::mutex block_latch_;
+  std::condition_variable block_cv_;
+
+  /**
+   * Commits are stamped one at a time under this latch, and snapshots are taken under it, so a snapshot sees
+   * either all or none of the versions of a commit.
+   */
+  std::mutex commit_latch_;
+  timestamp_t last_commit_ts_{0};
+  /** The read timestamps of the running snapshot transactions. */
+  std::multiset<timestamp_t> active_snapshots_;
+  /** The tables whose versions the garbage collector has yet to visit, guarded by commit_latch_. */
+  std::unordered_set<TableHeap *> gc_tables_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,140 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/concurrency/version_store.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the older versions of the tuples of one table heap, for snapshot reads. The heap always holds
+ * the newest version of a tuple, committed or not. The store holds, per RID, who wrote that newest version and
+ * when it was committed, and an undo chain of the versions it replaced, newest first. Each version is stamped
+ * with the commit timestamp of the transaction that wrote it.
+ *
+ * Writers record the version they replace while holding the page latch and an exclusive lock on the RID, readers
+ * resolve the version of their snapshot while holding the page latch, so a reader never sees a heap tuple and a
+ * chain that disagree. A RID nobody wrote since the oldest active snapshot has no chain at all.
+ *
+ * Every write keeps the version it replaces, as a snapshot may begin while the writer runs. A commit with no
+ * snapshot active drops the chain right away, every later snapshot sees the newest version.
+ */
+class VersionStore {
+ public:
+  /** Which version of a tuple a snapshot sees. */
+  enum class Visibility { NEWEST, OLDER, NONE };
+
+  /** A snapshot transaction begins. Counted across all the tables, under the commit latch of its manager. */
+  static void AddSnapshot() { active_snapshots_++; }
+
+  /** A snapshot transaction ends. */
+  static void RemoveSnapshot() { active_snapshots_--; }
+
+  /**
+   * First updater wins: a snapshot transaction may not overwrite a tuple whose newest version was committed after
+   * its snapshot. Called once txn holds an exclusive lock on rid, so that newest version is committed.
+   * @return true if txn may write rid
+   */
+  bool CanWrite(Transaction *txn, const RID &rid);
+
+  /**
+   * Record the version txn is about to replace in the heap, unless txn already wrote rid.
+   * @param txn the writing transaction
+   * @param rid the RID written
+   * @param existed false if there was no tuple at rid (an insert)
+   * @param old_tuple the replaced tuple, if it existed
+   */
+  void RecordWrite(Transaction *txn, const RID &rid, bool existed, const Tuple &old_tuple);
+
+  /**
+   * The version of rid written by txn_id is committed. Called under the commit latch, so no snapshot begins meanwhile.
+   * @param deleted true if txn_id deleted the tuple, which is then purged from the heap once no snapshot sees it
+   * @return false if no snapshot needs the chain of rid any more, a delete must then be applied right away
+   */
+  bool Commit(txn_id_t txn_id, const RID &rid, timestamp_t commit_ts, bool deleted);
+
+  /** The version of rid written by txn_id was rolled back in the heap, drop it from the chain. */
+  void Rollback(txn_id_t txn_id, const RID &rid);
+
+  /**
+   * Find the version of rid the snapshot of txn sees.
+   * @param[out] older the version seen if it is an older one
+   * @return NEWEST if txn sees the heap tuple, OLDER if it sees *older, NONE if the tuple did not exist yet
+   */
+  Visibility Resolve(Transaction *txn, const RID &rid, Tuple *older);
+
+  /**
+   * Drop the versions no snapshot at or after oldest_ts can see.
+   * @param oldest_ts the oldest snapshot still active, or the last commit timestamp if there is none
+   * @param[out] purge the deleted tuples no snapshot sees any more, to be removed from the heap, along with those
+   * deferred by earlier passes
+   */
+  void CollectGarbage(timestamp_t oldest_ts, std::vector<RID> *purge);
+
+  /** The deleted tuple at rid could not be purged yet, hand it to the next pass. */
+  void DeferPurge(const RID &rid) {
+    std::scoped_lock lock(latch_);
+    deferred_.push_back(rid);
+  }
+
+  /** @return true if a later pass of the garbage collector has work left in this table */
+  bool HasGarbage() {
+    std::scoped_lock lock(latch_);
+    return !committed_.empty() || !deferred_.empty();
+  }
+
+  /** @return the number of RIDs with older versions, used for testing only! */
+  size_t GetChainCount() {
+    std::scoped_lock lock(latch_);
+    return chains_.size();
+  }
+
+ private:
+  /** A replaced version, visible to the snapshots from begin_ts_ until the next newer version. */
+  struct UndoVersion {
+    timestamp_t begin_ts_;
+    bool exists_;
+    Tuple tuple_;
+  };
+
+  struct VersionChain {
+    /** The writer of the newest version while it is uncommitted, INVALID_TXN_ID after. */
+    txn_id_t writer_{INVALID_TXN_ID};
+    /** The commit timestamp of the newest version, 0 if older than every snapshot. */
+    timestamp_t newest_ts_{0};
+    /** The newest version is a committed delete, still marked in the heap. */
+    bool deleted_{false};
+    std::deque<UndoVersion> undo_;
+  };
+
+  std::mutex latch_;
+  std::unordered_map<RID, VersionChain> chains_;
+  /** The versions committed, in commit order, for the garbage collector to visit their chain once. */
+  std::deque<std::pair<timestamp_t, RID>> committed_;
+  /** The deleted tuples a pass could not purge, their row was locked. */
+  std::vector<RID> deferred_;
+
+  static std::atomic<size_t> active_snapshots_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// bloom_filter.h
+//
+// Identification: src/include/execution/bloom_filter.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common/util/hash_util.h"
+#include "type/value.h"
+
+namespace bustub {
+
+/**
+ * BloomFilter summarizes the join keys of the build side of a join, so that the probe side can drop
+ * rows that cannot match before they reach the join. It never rejects a key that was inserted, and
+ * accepts a key that was not with a probability of about 1% at BITS_PER_KEY bits per key.
+ * NULL keys never match an equi-join, so they are neither inserted nor accepted.
+ */
+class BloomFilter {
+ public:
+  static constexpr size_t BITS_PER_KEY = 10;
+  static constexpr size_t NUM_PROBES = 7;
+
+  /**
+   * Clear this filter and size it for a number of keys.
+   * @param expected_keys the number of keys that will be inserted
+   */
+  void Reset(size_t expected_keys) {
+    size_t num_bits = 64;
+    while (num_bits < expected_keys * BITS_PER_KEY) {
+      num_bits <<= 1;
+    }
+    words_.assign(num_bits / 64, 0);
+    mask_ = num_bits - 1;
+  }
+
+  /** Insert a key into this filter. */
+  void Insert(const Value &key) {
+    if (key.IsNull()) {
+      return;
+    }
+    uint64_t h1 = Mix(HashUtil::HashValue(&key));
+    uint64_t h2 = (h1 >> 32) | 1;
+    for (size_t i = 0; i < NUM_PROBES; i++) {
+      uint64_t bit = (h1 + i * h2) & mask_;
+      words_[bit >> 6] |= uint64_t{1} << (bit & 63);
+    }
+  }
+
+  /** @return false if the key was surely not inserted, true if it may have been */
+  bool MayContain(const Value &key) const {
+    if (key.IsNull()) {
+      return false;
+    }
+    uint64_t h1 = Mix(HashUtil::HashValue(&key));
+    uint64_t h2 = (h1 >> 32) | 1;
+    for (size_t i = 0; i < NUM_PROBES; i++) {
+      uint64_t bit = (h1 + i * h2) & mask_;
+      if (((words_[bit >> 6] >> (bit & 63)) & 1) == 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  /** HashValue barely mixes the bits of small integers, spread them over the whole word (murmur3 finalizer). */
+  static uint64_t Mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  std::vector<uint64_t> words_;
+  uint64_t mask_{0};
+};
+
+}  // namespace bustub
@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// exchange_queue.h
+//
+// Identification: src/include/execution/exchange_queue.h
+//
+// Copyright (c) 2015-19, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+namespace bustub {
+
+/**
+ * ExchangeQueue passes items from parallel producers to one consumer. It is bounded, so producers stop while the
+ * consumer is behind instead of buffering the whole result. A producer never waits for room: it parks a
+ * continuation instead, which the consumer resumes once it made room. Producers running on a fixed pool of workers
+ * thus never hold a worker that another producer, maybe of another exchange the same consumer reads, needs.
+ *
+ * Every producer calls ProducerDone() when it is finished; once all have and the queue is drained, Pop() returns
+ * false. A consumer that stops early calls Close(), which drops the parked producers and turns away the others.
+ */
+template <typename T>
+class ExchangeQueue {
+ public:
+  /**
+   * @param capacity the number of items the queue holds before producers are parked
+   * @param producer_count the number of producers
+   */
+  ExchangeQueue(size_t capacity, size_t producer_count) : capacity_(capacity), producers_left_(producer_count) {}
+
+  /**
+   * Push an item without waiting. When the queue is full the item is still taken, but the producer must stop: resume
+   * is called once the consumer made room, on the consumer's thread, and should only schedule the rest of the
+   * producer's work. The queue thus holds at most capacity items plus one per producer.
+   * @param item the item
+   * @param resume continues the producer, dropped if the queue is closed before there is room
+   * @return true if the producer may push more, false if it must stop: it is parked or the queue was closed
+   */
+  bool Push(T &&item, std::function<void()> resume) {
+    std::scoped_lock lock(latch_);
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    if (items_.size() < capacity_) {
+      return true;
+    }
+    parked_.push_back(std::move(resume));
+    return false;
+  }
+
+  /**
+   * Pop an item, waiting while the queue is empty and producers are left.
+   * @param[out] item the popped item
+   * @return false if all producers are done and the queue is drained, or the queue was closed
+   */
+  bool Pop(T *item) {
+    std::vector<std::function<void()>> resume;
+    std::unique_lock lock(latch_);
+    not_empty_.wait(lock, [&] { return closed_ || !items_.empty() || producers_left_ == 0; });
+    if (closed_ || items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    if (items_.size() < capacity_) {
+      std::swap(resume, parked_);
+    }
+    lock.unlock();
+    for (auto &producer : resume) {
+      producer();
+    }
+    return true;
+  }
+
+  /** Called by each producer once it pushed its last item. */
+  void ProducerDone() {
+    std::scoped_lock lock(latch_);
+    if (--producers_left_ == 0) {
+      not_empty_.notify_all();
+    }
+  }
+
+  /** @return true if the exchange was closed, producers should stop */
+  bool IsClosed() {
+    std::scoped_lock lock(latch_);
+    return closed_;
+  }
+
+  /** Stop the exchange: a waiting consumer returns, parked producers are dropped, later pushes fail. */
+  void Close() {
+    std::vector<std::function<void()>> parked;
+    std::scoped_lock lock(latch_);
+    closed_ = true;
+    // Destroyed once unlocked, a continuation may own the state of its producer
+    std::swap(parked, parked_);
+    not_empty_.notify_all();
+  }
+
+ private:
+  std::mutex latch_;
+  std::condition_variable not_empty_;
+  std::deque<T> items_;
+  /** Continuations of the producers that found the queue full. */
+  std::vector<std::function<void()>> parked_;
+  const size_t capacity_;
+  size_t producers_left_;
+  bool closed_{false};
+};
+
+}  // namespace bustub
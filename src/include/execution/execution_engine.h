@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
@@ -20,6 +23,8 @@
 #include "execution/executor_context.h"
 #include "execution/executor_factory.h"
 #include "execution/plans/abstract_plan.h"
+#include "execution/result_cursor.h"
+#include "execution/tuple_batch.h"
 #include "storage/table/tuple.h"
 namespace bustub {
 class ExecutionEngine {
@@ -29,33 +34,60 @@ class ExecutionEngine {
 
   DISALLOW_COPY_AND_MOVE(ExecutionEngine);
 
+  /**
+   * Receives the output of a query one batch at a time. The batch is reused after the sink returns,
+   * so tuples must be moved out of it to be kept.
+   * @return true to keep the query running, false to stop it early
+   */
+  using ResultSink = std::function<bool(TupleBatch *batch)>;
+
   bool Execute(const AbstractPlanNode *plan, std::vector<Tuple> *result_set, Transaction *txn,
                ExecutorContext *exec_ctx) {
-    // construct executor
-    auto executor = ExecutorFactory::CreateExecutor(exec_ctx, plan);
+    return Stream(plan, [result_set](TupleBatch *batch) {
+      if (result_set != nullptr) {
+        for (auto &tuple : batch->GetTuples()) {
+          result_set->push_back(std::move(tuple));
+        }
+      }
+      return true;
+    }, txn, exec_ctx);
+  }
 
-    // prepare
-    executor->Init();
+  /**
+   * Runs a query, handing each batch of its output to a sink as soon as it is produced.
+   * @param plan the plan to execute
+   * @param sink the consumer of the output
+   * @param txn the transaction the query runs in
+   * @param exec_ctx the executor context to run the query with
+   * @return false if the query failed: its transaction was aborted, or it threw; true otherwise, even if the sink
+   * stopped it early
+   */
+  bool Stream(const AbstractPlanNode *plan, const ResultSink &sink, Transaction *txn, ExecutorContext *exec_ctx) {
+    ResultCursor cursor{exec_ctx, txn, ExecutorFactory::CreateExecutor(exec_ctx, plan)};
 
     // execute
     try {
-      Tuple tuple;
-      RID rid;
-      while (executor->Next(&tuple, &rid)) {
-        if (result_set != nullptr) {
-          result_set->push_back(tuple);
-        }
+      TupleBatch batch;
+      while (cursor.NextBatch(&batch) && sink(&batch)) {
       }
     }
-    catch (TransactionAbortException &e){
-      std::cout << e.GetInfo();
-      exec_ctx->GetTransactionManager()->Abort(TransactionManager::GetTransaction(e.GetTransactionId()));
-    }
     catch (Exception &e) {
       // TODO(student): handle exceptions
+      return false;
     }
 
-    return true;
+    return !cursor.IsAborted();
+  }
+
+  /**
+   * Opens a query for pull-based consumption of its output.
+   * @param plan the plan to execute
+   * @param txn the transaction the query runs in
+   * @param exec_ctx the executor context to run the query with
+   * @return a cursor over the output of the query
+   */
+  std::unique_ptr<ResultCursor> Open(const AbstractPlanNode *plan, Transaction *txn, ExecutorContext *exec_ctx) {
+    return std::make_unique<ResultCursor>(exec_ctx, txn, ExecutorFactory::CreateExecutor(exec_ctx, plan));
   }
 
  private:
@@ -18,6 +18,7 @@
 
 #include "catalog/catalog.h"
 #include "concurrency/transaction.h"
+#include "execution/task_scheduler.h"
 #include "storage/page/tmp_tuple_page.h"
 
 namespace bustub {
@@ -60,6 +61,9 @@ class ExecutorContext {
   /** @return the transaction manager */
   TransactionManager *GetTransactionManager() { return txn_mgr_; }
 
+  /** @return the scheduler running the parallel parts of the query, its workers start with the first parallel plan */
+  TaskScheduler *GetTaskScheduler() { return TaskScheduler::GetInstance(); }
+
  private:
   Transaction *transaction_;
   Catalog *catalog_;
@@ -12,7 +12,10 @@
 
 #pragma once
 
+#include <utility>
+
 #include "execution/executor_context.h"
+#include "execution/tuple_batch.h"
 #include "storage/table/tuple.h"
 
 #define B_PLUS_TREE_INDEX_ITERATOR_TYPE IndexIterator<GenericKey<8>, RID, GenericComparator<8>>
@@ -20,7 +23,9 @@
 
 namespace bustub {
 /**
- * AbstractExecutor implements the Volcano tuple-at-a-time iterator model.
+ * AbstractExecutor implements the Volcano tuple-at-a-time iterator model, plus a batch-at-a-time
+ * NextBatch() that moves up to BATCH_SIZE tuples per call. Next() and NextBatch() must not be
+ * mixed on one executor between two calls to Init().
  */
 class AbstractExecutor {
  public:
@@ -47,6 +52,22 @@ class AbstractExecutor {
    */
   virtual bool Next(Tuple *tuple, RID *rid) = 0;
 
+  /**
+   * Produces the next batch of tuples from this executor. The default implementation loops over Next(),
+   * executors override it to spread their per-tuple overhead over the whole batch.
+   * @param[out] batch cleared, then filled with at most BATCH_SIZE tuples
+   * @return true if the batch holds at least one tuple, false if there are no more tuples
+   */
+  virtual bool NextBatch(TupleBatch *batch) {
+    batch->Clear();
+    Tuple tuple;
+    RID rid;
+    while (!batch->IsFull() && Next(&tuple, &rid)) {
+      batch->Append(std::move(tuple), rid);
+    }
+    return !batch->IsEmpty();
+  }
+
   /** @return the schema of the tuples that this executor produces */
   virtual const Schema *GetOutputSchema() = 0;
 
@@ -103,6 +103,35 @@ class SimpleAggregationHashTable {
     CombineAggregateValues(&ht[agg_key], agg_val);
   }
 
+  /**
+   * Merges a partial aggregate, built by another hash table over disjoint input, into this hash table.
+   * @param agg_key the key of the partial aggregate
+   * @param partial the partial aggregate
+   */
+  void MergeCombine(const AggregateKey &agg_key, const AggregateValue &partial) {
+    auto iter = ht.find(agg_key);
+    if (iter == ht.end()) {
+      ht.insert({agg_key, partial});
+      return;
+    }
+    AggregateValue *result = &iter->second;
+    for (uint32_t i = 0; i < agg_exprs_.size(); i++) {
+      switch (agg_types_[i]) {
+        case AggregationType::CountAggregate:
+        case AggregationType::SumAggregate:
+          // Partial counts and sums add up.
+          result->aggregates_[i] = result->aggregates_[i].Add(partial.aggregates_[i]);
+          break;
+        case AggregationType::MinAggregate:
+          result->aggregates_[i] = result->aggregates_[i].Min(partial.aggregates_[i]);
+          break;
+        case AggregationType::MaxAggregate:
+          result->aggregates_[i] = result->aggregates_[i].Max(partial.aggregates_[i]);
+          break;
+      }
+    }
+  }
+
   /**
    * An iterator through the simplified aggregation hash table.
    */
@@ -193,12 +222,26 @@ class AggregationExecutor : public AbstractExecutor {
   Tuple GenerateOutput();
 
  private:
+  /**
+   * Aggregate a sequential scan child on the task scheduler. Every morsel of heap pages is a task, which
+   * pre-aggregates into the hash tables of the worker running it, one per hash partition of the group by keys.
+   * Task p then merges partition p of every worker, so no hash table is ever shared between threads.
+   */
+  void ParallelAggregate();
+
+  /** @return the hash partition of the key among num_partitions partitions */
+  static size_t Partition(const AggregateKey &agg_key, size_t num_partitions) {
+    return std::hash<AggregateKey>{}(agg_key) % num_partitions;
+  }
+
   /** The aggregation plan node. */
   const AggregationPlanNode *plan_;
   /** The child executor whose tuples we are aggregating. */
   std::unique_ptr<AbstractExecutor> child_;
-  /** Simple aggregation hash table. */
-  SimpleAggregationHashTable aht_;
+  /** Simple aggregation hash tables, one per hash partition (a single one when aggregating serially). */
+  std::vector<SimpleAggregationHashTable> aht_partitions_;
+  /** The partition aht_iterator_ is walking. */
+  size_t partition_idx_{0};
   /** Simple aggregation hash table iterator. */
   SimpleAggregationHashTable::Iterator aht_iterator_;
 };
@@ -12,18 +12,22 @@
 
 #pragma once
 
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "common/rid.h"
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
 #include "execution/plans/index_scan_plan.h"
+#include "storage/table/table_cursor.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table. Under SNAPSHOT_ISOLATION it scans the table itself, the
+ * index only knows the newest versions, and returns the rows in table order rather than key order.
  *
  * Dyy: I think it would be better if it is a template class with <KeySize>,
  *      then we can replace every '8' with 'KeySize'
@@ -47,11 +51,42 @@ class IndexScanExecutor : public AbstractExecutor {
   Tuple GenerateTuple(Tuple &tuple);
 
  private:
+  /**
+   * Find whether the index covers the scan, i.e. every column the predicate and the output
+   * read is a key column stored in full in the keys. Fills covered_cols_ if so.
+   * @return true if the scan can be answered from the index keys alone
+   */
+  bool IsCovering(IndexInfo *index_info);
+
+  /** @return false if the lock on rid cannot be acquired, mirrors TableHeap::VisitTuple */
+  bool LockRid(const RID &rid);
+
+  /** @return false if the lock on rid cannot be acquired without waiting, see LockManager::TryLockRowShared */
+  bool TryLockRid(const RID &rid);
+
+  /**
+   * Check a row rebuilt from a key against the table, once its lock was granted after waiting for a writer.
+   * @return true if the row still exists and holds the key values in row_values_
+   */
+  bool MatchesTable(const RID &rid);
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
   B_PLUS_TREE_INDEX_ITERATOR_TYPE index_iter_;
   B_PLUS_TREE_INDEX_ITERATOR_TYPE end_iter_;
   TableHeap *table_heap_ptr_;
   TableMetadata* table_metadata_;
+  /**
+   * Index-only scan: output tuples are built from the keys. The table heap is only read, in place, when a row lock
+   * had to wait, to check that the row still matches its key. No row is copied out of it
+   */
+  bool index_only_{false};
+  Schema *key_schema_{nullptr};
+  /** Index-only scan: (table column, key column) of every column read by the scan */
+  std::vector<std::pair<uint32_t, uint32_t>> covered_cols_;
+  /** Index-only scan: a table row with NULL in every column the scan does not read, reused across tuples */
+  std::vector<Value> row_values_;
+  /** Snapshot scan: the cursor over the table, nullptr when the index is scanned */
+  std::unique_ptr<TableCursor> snapshot_cursor_;
 };
 }  // namespace bustub
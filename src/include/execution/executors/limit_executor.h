@@ -39,6 +39,8 @@ class LimitExecutor : public AbstractExecutor {
 
   bool Next(Tuple *tuple, RID *rid) override;
 
+  bool NextBatch(TupleBatch *batch) override;
+
  private:
   /** The limit plan node to be executed. */
   const LimitPlanNode *plan_;
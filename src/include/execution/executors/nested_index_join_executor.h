@@ -47,6 +47,12 @@ class NestIndexJoinExecutor : public AbstractExecutor {
 
   bool Next(Tuple *tuple, RID *rid) override;
 
+  /**
+   * Batched index nested loop join: each outer batch is probed against the index in key order,
+   * and the matching inner tuples are read grouped by page.
+   */
+  bool NextBatch(TupleBatch *batch) override;
+
   Tuple CombineTuple(Tuple *left_tuple, Tuple *right_tuple);
 
  private:
@@ -56,11 +62,14 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   std::unique_ptr<AbstractExecutor> child_executor_ptr_;
   /** Index */
   B_PLUS_TREE_INDEX_TYPE *index_ptr_;
-  /** A vector to store index scan result */
-  std::vector<RID> result_vector_;
   /** Innertable metadata */
   TableHeap *table_ptr_;
-  /** Current left tuple */
-  Tuple left_tuple_;
+  /** The current outer batch, and its (outer tuple index, inner rid) matches in the index */
+  TupleBatch outer_batch_;
+  std::vector<std::pair<size_t, RID>> matches_;
+  std::vector<RID> match_rids_;
+  /** The batch Next() hands out tuple by tuple, and its next tuple */
+  TupleBatch result_batch_;
+  size_t result_idx_{0};
 };
 }  // namespace bustub
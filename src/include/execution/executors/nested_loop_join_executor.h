@@ -15,8 +15,10 @@
 #include <memory>
 #include <utility>
 
+#include "execution/bloom_filter.h"
 #include "execution/executor_context.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/executors/seq_scan_executor.h"
 #include "execution/plans/nested_loop_join_plan.h"
 #include "storage/table/tuple.h"
 
@@ -45,14 +47,42 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
 
   bool Next(Tuple *tuple, RID *rid) override;
 
+  /**
+   * Block nested loop join: every left batch is joined against the right side in batches,
+   * so the right side is rescanned once per left batch instead of once per left tuple.
+   */
+  bool NextBatch(TupleBatch *batch) override;
+
   Tuple CombineTuple(Tuple *left_tuple, Tuple *right_tuple);
 
  private:
+  /**
+   * Restart the right side for a new left block. With a Bloom filter pushed down,
+   * the right scan only yields the tuples whose key may equal the key of one of the tuples of the block.
+   * @param left_tuples the left block
+   * @param count the number of tuples of the block
+   */
+  void RescanRight(const Tuple *left_tuples, size_t count);
+
   /** The NestedLoop plan node to be executed. */
   const NestedLoopJoinPlanNode *plan_;
   std::unique_ptr<AbstractExecutor> left_executor_ptr_;
   std::unique_ptr<AbstractExecutor> right_executor_ptr_;
   Tuple left_tuple_;
   bool left_ret_;
+  /** True once the first left tuple (or batch) is fetched */
+  bool started_;
+  /** State of NextBatch(): the current left block and right batch, and the next pair to join */
+  TupleBatch left_batch_;
+  TupleBatch right_batch_;
+  size_t left_idx_;
+  size_t right_idx_;
+  /**
+   * Sideways information passing: for a (left column = right column) predicate over a right seq scan, the scan
+   * and the left key expression. right_scan_ is nullptr when the filter is not pushed down.
+   */
+  SeqScanExecutor *right_scan_{nullptr};
+  const AbstractExpression *left_key_{nullptr};
+  BloomFilter bloom_filter_;
 };
 }  // namespace bustub
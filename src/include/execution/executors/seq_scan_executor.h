@@ -12,10 +12,16 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
+#include "execution/bloom_filter.h"
 #include "execution/executor_context.h"
+#include "execution/exchange_queue.h"
 #include "execution/executors/abstract_executor.h"
+#include "execution/expression_compiler.h"
+#include "execution/morsel_source.h"
+#include "execution/task_scheduler.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "storage/table/tuple.h"
 
@@ -33,24 +39,108 @@ class SeqScanExecutor : public AbstractExecutor {
    */
   SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan);
 
+  ~SeqScanExecutor() override;
+
   void Init() override;
 
   bool Next(Tuple *tuple, RID *rid) override;
 
+  bool NextBatch(TupleBatch *batch) override;
+
   Tuple GenerateTuple(Tuple &tuple);
 
   void LockInNode(RID &rid);
 
   void UnlockInNode(RID &rid);
 
+  /**
+   * Restrict the scan to the page range [first_page_id, stop_page_id) of the table, must be called before Init().
+   * @param first_page_id the first page to scan
+   * @param stop_page_id the first page not to scan, INVALID_PAGE_ID to scan to the tail
+   */
+  void SetPageRange(page_id_t first_page_id, page_id_t stop_page_id) {
+    first_page_id_ = first_page_id;
+    stop_page_id_ = stop_page_id;
+  }
+
+  /**
+   * Drop the tuples whose value in an output column is surely not in a Bloom filter, e.g. one a join built over
+   * the keys of its other side. The filter is read during the scan, so it must not change until the scan is over.
+   * @param col_idx the index of the key column in the output schema
+   * @param filter the filter, nullptr to keep every tuple
+   */
+  void SetBloomFilter(uint32_t col_idx, const BloomFilter *filter) {
+    bloom_col_idx_ = col_idx;
+    bloom_filter_ = filter;
+  }
+
+  /** Stop the workers of a parallel scan that is still running, e.g. before its Bloom filter changes. */
+  void Stop() { StopWorkers(false); }
+
   const Schema *GetOutputSchema() override { return plan_->OutputSchema(); }
 
  private:
+  /** @return false if the Bloom filter rules out the table tuple, before it is projected */
+  bool MayMatchBloomFilter(const Tuple &tuple) const {
+    return bloom_filter_ == nullptr ||
+           bloom_filter_->MayContain(plan_->OutputSchema()->GetColumn(bloom_col_idx_).GetExpr()->Evaluate(
+               &tuple, &table_metadata_ptr_->schema_));
+  }
+
+  /**
+   * Filter a table tuple and project it.
+   * @param view the table tuple
+   * @param[out] tuple the output tuple, if selected
+   * @return true if the tuple passes the predicate
+   */
+  bool Select(const TupleView &view, Tuple *tuple);
+
+  /** @return true if this scan runs on the task scheduler, i.e. the plan asks for it and no page range was set */
+  bool IsParallel() const { return plan_->GetParallelism() > 1 && first_page_id_ == INVALID_PAGE_ID; }
+
+  /**
+   * Start the workers of a parallel scan on the task scheduler,
+   * each scans the morsels it claims and pushes batches to the exchange
+   */
+  void StartWorkers();
+
+  /**
+   * Run a producer of a parallel scan: push the batches of the morsels it claims to the exchange, until none is left
+   * or the exchange is full, in which case the producer is parked and resumed later as a new task.
+   * @param scan the producer's own serial scan, kept across resumptions
+   */
+  void Produce(const std::shared_ptr<SeqScanExecutor> &scan);
+
+  /** Close the exchange and wait for the workers, rethrowing the first error one of them hit if rethrow is set. */
+  void StopWorkers(bool rethrow);
+
+  /** Copy the next visible tuple of the table out under the isolation level's locks */
+  bool FetchNext(Tuple *tuple, RID *rid);
+
   /** The sequential scan plan node to be executed. */
   const SeqScanPlanNode *plan_;
   TableMetadata *table_metadata_ptr_;
-  TableIterator table_iter_
-      = {nullptr, RID(), nullptr};  // Will reconstruct in `Init()`
+  std::unique_ptr<TableCursor> cursor_;  // Will construct in `Init()`
   TableHeap *table_heap_ptr_;
+  /** Page range of this scan, the whole table by default. */
+  page_id_t first_page_id_{INVALID_PAGE_ID};
+  page_id_t stop_page_id_{INVALID_PAGE_ID};
+  /** Join keys pushed down from a parent join, see SetBloomFilter. */
+  const BloomFilter *bloom_filter_{nullptr};
+  uint32_t bloom_col_idx_{0};
+  /** Raw table tuples of the current batch, before filtering and projection. */
+  TupleBatch raw_batch_;
+  /** Which tuples of raw_batch_ satisfy the predicate. */
+  SelectionBitmap selection_;
+  /** The predicate and projection compiled against the table schema, when the compiler supports them. */
+  CompiledPredicate compiled_predicate_;
+  std::unique_ptr<CompiledProjection> compiled_projection_;
+  /** Parallel scan: the pages left to claim, the batches the workers produced and the workers themselves. */
+  std::unique_ptr<MorselSource> morsel_source_;
+  std::unique_ptr<ExchangeQueue<TupleBatch>> exchange_;
+  std::unique_ptr<TaskGroup> worker_group_;
+  /** Parallel scan: the batch Next() hands out tuple by tuple, and its next tuple. */
+  TupleBatch exchange_batch_;
+  size_t exchange_idx_{0};
 };
 }  // namespace bustub
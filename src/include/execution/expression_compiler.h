@@ -0,0 +1,144 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// expression_compiler.h
+//
+// Identification: src/include/execution/expression_compiler.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "execution/expressions/abstract_expression.h"
+#include "execution/selection_bitmap.h"
+#include "execution/tuple_batch.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * CompiledPredicate is a predicate compiled against one input schema. It reads the tuple bytes directly
+ * through closures specialized on the column types, so evaluating it makes no virtual call on the
+ * expression tree and builds no Value.
+ */
+class CompiledPredicate {
+ public:
+  /** Evaluates the predicate on the raw data of one tuple. */
+  using RowFunction = std::function<bool(const char *)>;
+  /** Evaluates the predicate on a whole batch, see AbstractExpression::EvaluateBatch(). */
+  using BatchFunction = std::function<void(const TupleBatch &, SelectionBitmap *)>;
+
+  /** An empty CompiledPredicate, for predicates the compiler does not support. */
+  CompiledPredicate() = default;
+
+  /**
+   * @param row_function the per-tuple closure
+   * @param batch_function the batch closure, may be empty to loop over row_function
+   */
+  CompiledPredicate(RowFunction row_function, BatchFunction batch_function)
+      : row_function_(std::move(row_function)), batch_function_(std::move(batch_function)) {}
+
+  /** @return true if the predicate was compiled, false if it must be interpreted */
+  bool IsCompiled() const { return static_cast<bool>(row_function_); }
+
+  /** @return the per-tuple closure, e.g. to push it down into a TableIterator */
+  const RowFunction &GetRowFunction() const { return row_function_; }
+
+  /** @return true if the tuple satisfies the predicate */
+  bool Evaluate(const Tuple &tuple) const { return row_function_(tuple.GetData()); }
+
+  /**
+   * Evaluates the predicate over a batch.
+   * @param batch the tuples to evaluate
+   * @param[out] selection reset to the batch size, bit i is set iff tuple i satisfies the predicate
+   */
+  void EvaluateBatch(const TupleBatch &batch, SelectionBitmap *selection) const {
+    if (batch_function_) {
+      batch_function_(batch, selection);
+      return;
+    }
+    selection->Reset(batch.Size());
+    for (size_t i = 0; i < batch.Size(); i++) {
+      if (row_function_(batch.GetTuple(i).GetData())) {
+        selection->Set(i);
+      }
+    }
+  }
+
+ private:
+  RowFunction row_function_;
+  BatchFunction batch_function_;
+};
+
+/**
+ * CompiledProjection is a projection compiled against one input schema. Every output column is a plain
+ * copy of a fixed-size input column, so the output tuple is assembled with memcpy alone.
+ */
+class CompiledProjection {
+ public:
+  /** Copy size bytes from src_offset of the input tuple to dst_offset of the output tuple. */
+  struct CopyOp {
+    uint32_t src_offset_;
+    uint32_t dst_offset_;
+    uint32_t size_;
+  };
+
+  /**
+   * @param copy_ops the copies building an output tuple
+   * @param tuple_size the size of an output tuple
+   */
+  CompiledProjection(std::vector<CopyOp> &&copy_ops, uint32_t tuple_size)
+      : copy_ops_(std::move(copy_ops)), tuple_size_(tuple_size) {}
+
+  /**
+   * @param input the input tuple
+   * @return the projected output tuple
+   */
+  Tuple Project(const Tuple &input) const { return Project(input.GetData()); }
+
+  /**
+   * @param input_data the raw data of the input tuple, e.g. in place in its page
+   * @return the projected output tuple
+   */
+  Tuple Project(const char *input_data) const;
+
+ private:
+  std::vector<CopyOp> copy_ops_;
+  uint32_t tuple_size_;
+};
+
+/**
+ * ExpressionCompiler turns the predicate and projection expressions of a plan into closures specialized
+ * by type at C++ compile time. Trees it does not support are left to the interpreter.
+ */
+class ExpressionCompiler {
+ public:
+  /**
+   * Compile a predicate. Supported are comparisons between a fixed-size numeric column and a constant
+   * of the same type, and between two columns of the same fixed-size numeric type.
+   * @param predicate the predicate, evaluated with tuple index 0
+   * @param schema the schema of the tuples the predicate is evaluated on
+   * @return the compiled predicate, IsCompiled() is false if the predicate is not supported
+   */
+  static CompiledPredicate CompilePredicate(const AbstractExpression *predicate, const Schema *schema);
+
+  /**
+   * Compile a projection. Supported are output schemas made only of ColumnValueExpressions on fixed-size columns.
+   * @param output_schema the output schema, whose column expressions define the projection
+   * @param input_schema the schema of the input tuples
+   * @return the compiled projection, nullptr if the projection is not supported
+   */
+  static std::unique_ptr<CompiledProjection> CompileProjection(const Schema *output_schema,
+                                                               const Schema *input_schema);
+};
+
+}  // namespace bustub
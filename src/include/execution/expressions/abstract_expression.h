@@ -16,6 +16,8 @@
 #include <vector>
 
 #include "catalog/schema.h"
+#include "execution/selection_bitmap.h"
+#include "execution/tuple_batch.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -39,6 +41,29 @@ class AbstractExpression {
   /** @return the value obtained by evaluating the tuple with the given schema */
   virtual Value Evaluate(const Tuple *tuple, const Schema *schema) const = 0;
 
+  /**
+   * Evaluates this boolean expression over a whole batch of tuples, e.g. a scan predicate.
+   * The default implementation calls Evaluate() per tuple, expressions override it with batch kernels.
+   * @param batch the tuples to evaluate
+   * @param schema the schema of the tuples
+   * @param[out] selection reset to the batch size, bit i is set iff tuple i evaluates to true
+   */
+  virtual void EvaluateBatch(const TupleBatch &batch, const Schema *schema, SelectionBitmap *selection) const {
+    selection->Reset(batch.Size());
+    for (size_t i = 0; i < batch.Size(); i++) {
+      if (IsTrue(Evaluate(&batch.GetTuple(i), schema))) {
+        selection->Set(i);
+      }
+    }
+  }
+
+  /**
+   * A comparison with a NULL operand evaluates to a NULL boolean, whose storage is not a valid bool, so predicate
+   * results are tested here rather than with GetAs<bool>().
+   * @return true if the boolean value is true, false if it is false or NULL
+   */
+  static bool IsTrue(const Value &value) { return !value.IsNull() && value.GetAs<int8_t>() != 0; }
+
   /**
    * Returns the value obtained by evaluating a join.
    * @param left_tuple the left tuple
@@ -12,11 +12,16 @@
 
 #pragma once
 
+#include <functional>
 #include <utility>
 #include <vector>
 
 #include "catalog/schema.h"
 #include "execution/expressions/abstract_expression.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_kernels.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "type/limits.h"
 #include "storage/table/tuple.h"
 #include "type/value_factory.h"
 
@@ -53,6 +58,35 @@ class ComparisonExpression : public AbstractExpression {
     return ValueFactory::GetBooleanValue(PerformComparison(lhs, rhs));
   }
 
+  /**
+   * (column cmp constant) and (constant cmp column) on a fixed-size numeric column run a typed kernel
+   * over the gathered column, everything else is evaluated per tuple.
+   */
+  void EvaluateBatch(const TupleBatch &batch, const Schema *schema, SelectionBitmap *selection) const override {
+    if (!EvaluateBatchKernel(batch, schema, selection)) {
+      AbstractExpression::EvaluateBatch(batch, schema, selection);
+    }
+  }
+
+  /** @return the type of this comparison */
+  ComparisonType GetComparisonType() const { return comp_type_; }
+
+  /** @return the comparison with its operands swapped, e.g. a < b is b > a */
+  static ComparisonType FlipComparison(ComparisonType comp_type) {
+    switch (comp_type) {
+      case ComparisonType::LessThan:
+        return ComparisonType::GreaterThan;
+      case ComparisonType::LessThanOrEqual:
+        return ComparisonType::GreaterThanOrEqual;
+      case ComparisonType::GreaterThan:
+        return ComparisonType::LessThan;
+      case ComparisonType::GreaterThanOrEqual:
+        return ComparisonType::LessThanOrEqual;
+      default:
+        return comp_type;
+    }
+  }
+
  private:
   CmpBool PerformComparison(const Value &lhs, const Value &rhs) const {
     switch (comp_type_) {
@@ -73,6 +107,76 @@ class ComparisonExpression : public AbstractExpression {
     }
   }
 
+  /** @return false if this comparison has no batch kernel */
+  bool EvaluateBatchKernel(const TupleBatch &batch, const Schema *schema, SelectionBitmap *selection) const {
+    auto column = dynamic_cast<const ColumnValueExpression *>(GetChildAt(0));
+    auto constant = dynamic_cast<const ConstantValueExpression *>(GetChildAt(1));
+    ComparisonType comp_type = comp_type_;
+    if (column == nullptr || constant == nullptr) {
+      // (constant cmp column) is (column flipped-cmp constant)
+      column = dynamic_cast<const ColumnValueExpression *>(GetChildAt(1));
+      constant = dynamic_cast<const ConstantValueExpression *>(GetChildAt(0));
+      comp_type = FlipComparison(comp_type_);
+      if (column == nullptr || constant == nullptr) {
+        return false;
+      }
+    }
+    const Column &col = schema->GetColumn(column->GetColIdx());
+    const Value &val = constant->GetValue();
+    if (!col.IsInlined() || col.GetType() != val.GetTypeId() || val.IsNull()) {
+      return false;
+    }
+
+    selection->Reset(batch.Size());
+    switch (col.GetType()) {
+      case TypeId::TINYINT:
+        RunKernel<int8_t>(batch, col.GetOffset(), val.GetAs<int8_t>(), BUSTUB_INT8_NULL, comp_type, selection);
+        return true;
+      case TypeId::SMALLINT:
+        RunKernel<int16_t>(batch, col.GetOffset(), val.GetAs<int16_t>(), BUSTUB_INT16_NULL, comp_type, selection);
+        return true;
+      case TypeId::INTEGER:
+        RunKernel<int32_t>(batch, col.GetOffset(), val.GetAs<int32_t>(), BUSTUB_INT32_NULL, comp_type, selection);
+        return true;
+      case TypeId::BIGINT:
+        RunKernel<int64_t>(batch, col.GetOffset(), val.GetAs<int64_t>(), BUSTUB_INT64_NULL, comp_type, selection);
+        return true;
+      case TypeId::DECIMAL:
+        RunKernel<double>(batch, col.GetOffset(), val.GetAs<double>(), BUSTUB_DECIMAL_NULL, comp_type, selection);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  template <typename T>
+  static void RunKernel(const TupleBatch &batch, uint32_t offset, T constant, T null_value, ComparisonType comp_type,
+                        SelectionBitmap *selection) {
+    std::vector<T> column;
+    GatherColumn<T>(batch, offset, &column);
+    uint64_t *words = selection->GetWords();
+    switch (comp_type) {
+      case ComparisonType::Equal:
+        CompareColumnToConstant<T, std::equal_to<T>>(column.data(), column.size(), constant, null_value, words);
+        break;
+      case ComparisonType::NotEqual:
+        CompareColumnToConstant<T, std::not_equal_to<T>>(column.data(), column.size(), constant, null_value, words);
+        break;
+      case ComparisonType::LessThan:
+        CompareColumnToConstant<T, std::less<T>>(column.data(), column.size(), constant, null_value, words);
+        break;
+      case ComparisonType::LessThanOrEqual:
+        CompareColumnToConstant<T, std::less_equal<T>>(column.data(), column.size(), constant, null_value, words);
+        break;
+      case ComparisonType::GreaterThan:
+        CompareColumnToConstant<T, std::greater<T>>(column.data(), column.size(), constant, null_value, words);
+        break;
+      case ComparisonType::GreaterThanOrEqual:
+        CompareColumnToConstant<T, std::greater_equal<T>>(column.data(), column.size(), constant, null_value, words);
+        break;
+    }
+  }
+
   std::vector<const AbstractExpression *> children_;
   ComparisonType comp_type_;
 };
@@ -0,0 +1,164 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// comparison_kernels.h
+//
+// Identification: src/include/execution/expressions/comparison_kernels.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "execution/tuple_batch.h"
+
+namespace bustub {
+
+/**
+ * Copies the fixed-size column stored at offset of every tuple of the batch into a contiguous vector.
+ * @param batch the tuples
+ * @param offset the offset of the column inside a tuple
+ * @param[out] column the column values, one per tuple
+ */
+template <typename T>
+void GatherColumn(const TupleBatch &batch, uint32_t offset, std::vector<T> *column) {
+  column->resize(batch.Size());
+  for (size_t i = 0; i < batch.Size(); i++) {
+    std::memcpy(&(*column)[i], batch.GetTuple(i).GetData() + offset, sizeof(T));
+  }
+}
+
+/**
+ * How a std:: comparison functor maps onto the two comparisons SIMD offers, equal and greater than:
+ * Op(a, b) == negate ^ (is_eq ? a == b : (swap ? b > a : a > b)).
+ */
+template <typename Op>
+struct SimdOpTraits;
+template <typename T>
+struct SimdOpTraits<std::equal_to<T>> {
+  static constexpr bool IS_EQ = true, SWAP = false, NEGATE = false;
+};
+template <typename T>
+struct SimdOpTraits<std::not_equal_to<T>> {
+  static constexpr bool IS_EQ = true, SWAP = false, NEGATE = true;
+};
+template <typename T>
+struct SimdOpTraits<std::greater<T>> {
+  static constexpr bool IS_EQ = false, SWAP = false, NEGATE = false;
+};
+template <typename T>
+struct SimdOpTraits<std::less<T>> {
+  static constexpr bool IS_EQ = false, SWAP = true, NEGATE = false;
+};
+template <typename T>
+struct SimdOpTraits<std::less_equal<T>> {
+  static constexpr bool IS_EQ = false, SWAP = false, NEGATE = true;
+};
+template <typename T>
+struct SimdOpTraits<std::greater_equal<T>> {
+  static constexpr bool IS_EQ = false, SWAP = true, NEGATE = true;
+};
+
+#if defined(__AVX2__)
+/** The AVX2 operations needed by the comparison kernel, per column type. */
+template <typename T>
+struct Avx2Lanes;
+
+template <>
+struct Avx2Lanes<int32_t> {
+  using Vec = __m256i;
+  static constexpr size_t WIDTH = 8;
+  static Vec Broadcast(int32_t v) { return _mm256_set1_epi32(v); }
+  static Vec Load(const int32_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+  static Vec Eq(Vec a, Vec b) { return _mm256_cmpeq_epi32(a, b); }
+  static Vec Gt(Vec a, Vec b) { return _mm256_cmpgt_epi32(a, b); }
+  static uint64_t MoveMask(Vec m) { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(m))); }
+};
+
+template <>
+struct Avx2Lanes<int64_t> {
+  using Vec = __m256i;
+  static constexpr size_t WIDTH = 4;
+  static Vec Broadcast(int64_t v) { return _mm256_set1_epi64x(v); }
+  static Vec Load(const int64_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+  static Vec Eq(Vec a, Vec b) { return _mm256_cmpeq_epi64(a, b); }
+  static Vec Gt(Vec a, Vec b) { return _mm256_cmpgt_epi64(a, b); }
+  static uint64_t MoveMask(Vec m) { return static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(m))); }
+};
+
+template <>
+struct Avx2Lanes<double> {
+  using Vec = __m256d;
+  static constexpr size_t WIDTH = 4;
+  static Vec Broadcast(double v) { return _mm256_set1_pd(v); }
+  static Vec Load(const double *p) { return _mm256_loadu_pd(p); }
+  static Vec Eq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  static Vec Gt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static uint64_t MoveMask(Vec m) { return static_cast<uint32_t>(_mm256_movemask_pd(m)); }
+};
+
+template <typename T>
+constexpr bool HAS_AVX2_LANES = std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, double>;
+#endif
+
+/**
+ * Compares every value of a column against a constant, selecting row i iff Op(column[i], constant) holds.
+ * NULL values (stored as null_value) are never selected. With AVX2 the column is compared 64 rows, one
+ * bitmap word, at a time; the tail and the narrow types go through the scalar loop.
+ * @param column the column values
+ * @param n the number of values
+ * @param constant the constant to compare against
+ * @param null_value the in-storage representation of NULL for this type
+ * @param[out] words the selection bitmap words, must be cleared by the caller
+ */
+template <typename T, typename Op>
+void CompareColumnToConstant(const T *column, size_t n, T constant, T null_value, uint64_t *words) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  if constexpr (HAS_AVX2_LANES<T>) {
+    using Lanes = Avx2Lanes<T>;
+    using Traits = SimdOpTraits<Op>;
+    const auto constants = Lanes::Broadcast(constant);
+    const auto nulls = Lanes::Broadcast(null_value);
+    for (; i + 64 <= n; i += 64) {
+      uint64_t word = 0;
+      for (size_t j = 0; j < 64; j += Lanes::WIDTH) {
+        const auto values = Lanes::Load(column + i + j);
+        uint64_t bits;
+        if constexpr (Traits::IS_EQ) {
+          bits = Lanes::MoveMask(Lanes::Eq(values, constants));
+        } else if constexpr (Traits::SWAP) {
+          bits = Lanes::MoveMask(Lanes::Gt(constants, values));
+        } else {
+          bits = Lanes::MoveMask(Lanes::Gt(values, constants));
+        }
+        if constexpr (Traits::NEGATE) {
+          bits ^= (uint64_t{1} << Lanes::WIDTH) - 1;
+        }
+        bits &= ~Lanes::MoveMask(Lanes::Eq(values, nulls));
+        word |= bits << j;
+      }
+      words[i >> 6] = word;
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (column[i] != null_value && Op{}(column[i], constant)) {
+      words[i >> 6] |= uint64_t{1} << (i & 63);
+    }
+  }
+}
+
+}  // namespace bustub
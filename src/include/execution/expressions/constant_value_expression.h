@@ -36,6 +36,9 @@ class ConstantValueExpression : public AbstractExpression {
     return val_;
   }
 
+  /** @return the constant this expression evaluates to */
+  const Value &GetValue() const { return val_; }
+
  private:
   Value val_;
 };
@@ -0,0 +1,64 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// morsel_source.h
+//
+// Identification: src/include/execution/morsel_source.h
+//
+// Copyright (c) 2015-19, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * MorselSource hands out the pages of a table heap to parallel scan workers, a morsel of consecutive pages at a
+ * time. Workers claim morsels until none is left, so a fast worker simply claims more of them.
+ */
+class MorselSource {
+ public:
+  /**
+   * @param page_ids the pages of the table, in chain order
+   * @param morsel_size the number of pages per morsel
+   */
+  explicit MorselSource(std::vector<page_id_t> page_ids, size_t morsel_size = MORSEL_SIZE)
+      : page_ids_(std::move(page_ids)), morsel_size_(morsel_size) {}
+
+  /**
+   * Claim the next morsel, the page range [first_page_id, stop_page_id).
+   * @param[out] first_page_id the first page of the morsel
+   * @param[out] stop_page_id the first page after the morsel, INVALID_PAGE_ID for the last morsel
+   * @return false if every morsel has been claimed
+   */
+  bool Claim(page_id_t *first_page_id, page_id_t *stop_page_id) {
+    size_t begin = next_.fetch_add(morsel_size_);
+    if (begin >= page_ids_.size()) {
+      return false;
+    }
+    size_t end = begin + morsel_size_;
+    *first_page_id = page_ids_[begin];
+    // The last morsel runs to the tail, which also covers pages appended since the page ids were read.
+    *stop_page_id = end >= page_ids_.size() ? INVALID_PAGE_ID : page_ids_[end];
+    return true;
+  }
+
+  /** @return the number of morsels */
+  size_t GetMorselCount() const { return (page_ids_.size() + morsel_size_ - 1) / morsel_size_; }
+
+ private:
+  const std::vector<page_id_t> page_ids_;
+  const size_t morsel_size_;
+  /** Index of the first page of the next morsel. */
+  std::atomic<size_t> next_{0};
+};
+
+}  // namespace bustub
@@ -27,9 +27,11 @@ class SeqScanPlanNode : public AbstractPlanNode {
    * @param output the output format of this scan plan node
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) = true or predicate = nullptr
    * @param table_oid the identifier of table to be scanned
+   * @param parallelism the number of tasks scanning morsels of pages on the task scheduler, 1 runs serially
    */
-  SeqScanPlanNode(const Schema *output, const AbstractExpression *predicate, table_oid_t table_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, table_oid_(table_oid) {}
+  SeqScanPlanNode(const Schema *output, const AbstractExpression *predicate, table_oid_t table_oid,
+                  uint32_t parallelism = 1)
+      : AbstractPlanNode(output, {}), predicate_{predicate}, table_oid_(table_oid), parallelism_(parallelism) {}
 
   PlanType GetType() const override { return PlanType::SeqScan; }
 
@@ -39,11 +41,16 @@ class SeqScanPlanNode : public AbstractPlanNode {
   /** @return the identifier of the table that should be scanned */
   table_oid_t GetTableOid() const { return table_oid_; }
 
+  /** @return the number of tasks scanning the table */
+  uint32_t GetParallelism() const { return parallelism_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
   /** The table whose tuples should be scanned. */
   table_oid_t table_oid_;
+  /** The number of tasks scanning the table. */
+  uint32_t parallelism_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// result_cursor.h
+//
+// Identification: src/include/execution/result_cursor.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "common/logger.h"
+#include "concurrency/transaction_manager.h"
+#include "execution/executor_context.h"
+#include "execution/executors/abstract_executor.h"
+#include "execution/tuple_batch.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * ResultCursor streams the output of a query to its client. Rows are pulled from the root executor
+ * one batch at a time as the client asks for them, so at most one batch of results is in memory and
+ * the first row is available as soon as the executor tree produces it. Destroying the cursor before
+ * the end of the stream stops the query.
+ */
+class ResultCursor {
+ public:
+  /**
+   * Creates a cursor over an executor, which must not have been initialized yet.
+   * @param exec_ctx the executor context the executor runs with
+   * @param txn the transaction the query runs in, aborted if the query hits a transaction abort
+   * @param executor the root executor of the query
+   */
+  ResultCursor(ExecutorContext *exec_ctx, Transaction *txn, std::unique_ptr<AbstractExecutor> executor)
+      : exec_ctx_(exec_ctx), txn_(txn), executor_(std::move(executor)) {
+    BUSTUB_ASSERT(txn_ == exec_ctx_->GetTransaction(), "The query must run in the transaction of its context.");
+    executor_->Init();
+  }
+
+  DISALLOW_COPY_AND_MOVE(ResultCursor);
+
+  /**
+   * Yields the next row of the result.
+   * @param[out] tuple the next row
+   * @return true if a row was produced, false at the end of the result
+   */
+  bool Next(Tuple *tuple) {
+    if (batch_idx_ >= batch_.Size()) {
+      batch_idx_ = 0;
+      if (!NextBatch(&batch_)) {
+        return false;
+      }
+    }
+    *tuple = std::move(batch_.GetTuple(batch_idx_++));
+    return true;
+  }
+
+  /**
+   * Yields the next batch of rows of the result. Must not be mixed with Next().
+   * @param[out] batch the next rows, replacing its previous content
+   * @return true if the batch holds at least one row, false at the end of the result
+   */
+  bool NextBatch(TupleBatch *batch) {
+    if (done_) {
+      batch->Clear();
+      return false;
+    }
+    try {
+      done_ = !executor_->NextBatch(batch);
+    } catch (TransactionAbortException &e) {
+      LOG_DEBUG("%s", e.GetInfo().c_str());
+      exec_ctx_->GetTransactionManager()->Abort(txn_);
+      batch->Clear();
+      done_ = true;
+      aborted_ = true;
+    }
+    return !done_;
+  }
+
+  /** @return true if the query stopped because its transaction was aborted, false if it ran fine so far */
+  bool IsAborted() const { return aborted_; }
+
+  /** @return the schema of the rows of the result */
+  const Schema *GetOutputSchema() { return executor_->GetOutputSchema(); }
+
+ private:
+  ExecutorContext *exec_ctx_;
+  Transaction *txn_;
+  std::unique_ptr<AbstractExecutor> executor_;
+  /** Rows pulled from the executor but not handed out by Next() yet. */
+  TupleBatch batch_;
+  size_t batch_idx_{0};
+  bool done_{false};
+  bool aborted_{false};
+};
+
+}  // namespace bustub
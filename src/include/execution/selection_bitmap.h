@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// selection_bitmap.h
+//
+// Identification: src/include/execution/selection_bitmap.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace bustub {
+
+/**
+ * SelectionBitmap marks which tuples of a TupleBatch satisfy a predicate, one bit per tuple,
+ * packed into 64-bit words so that batch kernels can fill a whole word at once.
+ */
+class SelectionBitmap {
+ public:
+  /**
+   * Resize this bitmap to size bits, all cleared.
+   * @param size the number of tuples covered by this bitmap
+   */
+  void Reset(size_t size) {
+    size_ = size;
+    words_.assign((size + 63) / 64, 0);
+  }
+
+  /** @return the number of tuples covered by this bitmap */
+  size_t Size() const { return size_; }
+
+  /** @return true if tuple idx is selected */
+  bool Test(size_t idx) const { return (words_[idx >> 6] >> (idx & 63)) & 1; }
+
+  /** Select tuple idx. */
+  void Set(size_t idx) { words_[idx >> 6] |= uint64_t{1} << (idx & 63); }
+
+  /** @return the words of this bitmap, bit (i % 64) of word (i / 64) is tuple i */
+  uint64_t *GetWords() { return words_.data(); }
+
+  /** @return the number of selected tuples */
+  size_t Count() const {
+    size_t count = 0;
+    for (auto word : words_) {
+      count += __builtin_popcountll(word);
+    }
+    return count;
+  }
+
+ private:
+  std::vector<uint64_t> words_;
+  size_t size_{0};
+};
+
+}  // namespace bustub
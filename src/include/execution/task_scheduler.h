@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// task_scheduler.h
+//
+// Identification: src/include/execution/task_scheduler.h
+//
+// Copyright (c) 2015-19, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * TaskScheduler runs tasks on a fixed pool of worker threads. Every worker has its own task deque: it runs its
+ * newest task first, and when its deque is empty it steals the oldest task of another worker. A task submitted
+ * from a worker goes to that worker's deque, so work a morsel spawns stays on the core whose caches hold it.
+ *
+ * Tasks should not block on each other, except through TaskGroup::Wait(), which keeps a waiting worker busy.
+ */
+class TaskScheduler {
+ public:
+  using Task = std::function<void()>;
+
+  /** The worker id of threads outside of any pool. */
+  static constexpr size_t NO_WORKER = SIZE_MAX;
+
+  /** @param num_workers the number of worker threads */
+  explicit TaskScheduler(size_t num_workers);
+
+  /** Runs the tasks still queued, then stops the workers. */
+  ~TaskScheduler();
+
+  DISALLOW_COPY_AND_MOVE(TaskScheduler);
+
+  /** @return the scheduler shared by all queries, with one worker per hardware thread */
+  static TaskScheduler *GetInstance();
+
+  /** @return the id of the calling worker in [0, GetWorkerCount()), NO_WORKER if it is not a worker of any pool */
+  static size_t GetWorkerId();
+
+  /** @return true if the calling thread is a worker of this pool */
+  bool IsCurrentWorker() const;
+
+  /** @return the number of worker threads */
+  size_t GetWorkerCount() const { return workers_.size(); }
+
+  /** Queue a task, on the calling worker's deque if it is one of ours, round robin otherwise. */
+  void Submit(Task task);
+
+  /**
+   * Run one queued task on the calling thread, which must be a worker of this pool.
+   * @return false if no task was queued
+   */
+  bool RunOne();
+
+ private:
+  /** A worker's deque, on its own cache lines so that workers do not contend on each other's latch. */
+  struct alignas(64) WorkerQueue {
+    std::mutex latch_;
+    std::deque<Task> tasks_;
+  };
+
+  void WorkerLoop(size_t worker_id);
+
+  /** Pop the newest task of the worker's own deque, or else steal the oldest task of another deque. */
+  bool PopOrSteal(size_t worker_id, Task *task);
+
+  std::vector<WorkerQueue> queues_;
+  std::vector<std::thread> workers_;
+  /** Next deque for tasks submitted from outside the pool. */
+  std::atomic<size_t> next_queue_{0};
+  /**
+   * Number of queued tasks, idle workers sleep on idle_cv_ while it is 0. It is raised before a task is queued, so it
+   * may briefly count a task not queued yet, never one already taken.
+   */
+  std::atomic<size_t> queued_{0};
+  std::mutex idle_latch_;
+  std::condition_variable idle_cv_;
+  bool stop_{false};
+};
+
+/**
+ * TaskGroup tracks a set of tasks run on a scheduler, so that their submitter can wait for all of them. The first
+ * exception a task throws is rethrown by Wait().
+ */
+class TaskGroup {
+ public:
+  /** @param scheduler the scheduler running the tasks */
+  explicit TaskGroup(TaskScheduler *scheduler) : scheduler_(scheduler) {}
+
+  /** Waits for the tasks, dropping any exception. */
+  ~TaskGroup();
+
+  DISALLOW_COPY_AND_MOVE(TaskGroup);
+
+  /** Submit a task of this group. */
+  void Run(TaskScheduler::Task task);
+
+  /**
+   * Wait until every task of this group finished. A worker keeps running queued tasks meanwhile.
+   * @throws the first exception a task of this group threw
+   */
+  void Wait();
+
+ private:
+  /** Wait until every task of this group finished. */
+  void WaitAll();
+
+  TaskScheduler *scheduler_;
+  std::mutex latch_;
+  std::condition_variable done_cv_;
+  size_t pending_{0};
+  std::exception_ptr error_;
+};
+
+/**
+ * PerWorker keeps one T per worker of a scheduler, each on its own cache lines, so that tasks accumulate state
+ * without sharing or false sharing. A task reaches its worker's T through Local(). One more T is kept for the thread
+ * outside of the pool that waits for the tasks, which runs none of them itself but may still call Local().
+ */
+template <typename T>
+class PerWorker {
+ public:
+  /**
+   * @param scheduler the scheduler whose workers own the values
+   * @param make creates the value of one worker
+   */
+  PerWorker(TaskScheduler *scheduler, const std::function<T()> &make) : scheduler_(scheduler) {
+    slots_.reserve(scheduler->GetWorkerCount() + 1);
+    for (size_t w = 0; w <= scheduler->GetWorkerCount(); w++) {
+      slots_.push_back(Slot{make()});
+    }
+  }
+
+  /**
+   * @return the value of the calling worker. A thread that is not a worker of this scheduler, even one of another
+   * pool, gets the last value, which only one such thread may use at a time
+   */
+  T &Local() {
+    return slots_[scheduler_->IsCurrentWorker() ? TaskScheduler::GetWorkerId() : slots_.size() - 1].value_;
+  }
+
+  /** @return the value of worker w */
+  T &At(size_t w) { return slots_[w].value_; }
+
+  /** @return the number of values, one per worker and one for the threads outside of the pool */
+  size_t Size() const { return slots_.size(); }
+
+ private:
+  struct alignas(64) Slot {
+    T value_;
+  };
+  TaskScheduler *scheduler_;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace bustub
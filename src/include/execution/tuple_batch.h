@@ -0,0 +1,89 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_batch.h
+//
+// Identification: src/include/execution/tuple_batch.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * TupleBatch carries up to BATCH_SIZE tuples, together with their rids, from one executor to its parent
+ * in a single NextBatch() call. A batch is reused across calls, so its buffers are only allocated once.
+ */
+class TupleBatch {
+ public:
+  TupleBatch() {
+    tuples_.reserve(BATCH_SIZE);
+    rids_.reserve(BATCH_SIZE);
+  }
+
+  /** Drop all tuples of this batch, keeping the reserved capacity. */
+  void Clear() {
+    tuples_.clear();
+    rids_.clear();
+  }
+
+  /**
+   * Append a tuple to this batch.
+   * @param tuple the tuple, moved into the batch
+   * @param rid the rid of the tuple
+   */
+  void Append(Tuple &&tuple, const RID &rid) {
+    tuples_.emplace_back(std::move(tuple));
+    rids_.emplace_back(rid);
+  }
+
+  /**
+   * Keep only the tuples in [begin, end) of this batch.
+   * @param begin the index of the first tuple to keep
+   * @param end one past the index of the last tuple to keep
+   */
+  void Slice(size_t begin, size_t end) {
+    tuples_.erase(tuples_.begin() + end, tuples_.end());
+    tuples_.erase(tuples_.begin(), tuples_.begin() + begin);
+    rids_.erase(rids_.begin() + end, rids_.end());
+    rids_.erase(rids_.begin(), rids_.begin() + begin);
+  }
+
+  /** @return the number of tuples in this batch */
+  size_t Size() const { return tuples_.size(); }
+
+  /** @return true if this batch holds no tuple */
+  bool IsEmpty() const { return tuples_.empty(); }
+
+  /** @return true if no more tuple should be appended to this batch */
+  bool IsFull() const { return tuples_.size() >= static_cast<size_t>(BATCH_SIZE); }
+
+  /** @return the idx'th tuple of this batch */
+  Tuple &GetTuple(size_t idx) { return tuples_[idx]; }
+
+  /** @return the idx'th tuple of this batch */
+  const Tuple &GetTuple(size_t idx) const { return tuples_[idx]; }
+
+  /** @return the rid of the idx'th tuple of this batch */
+  const RID &GetRid(size_t idx) const { return rids_[idx]; }
+
+  /** @return all tuples of this batch, e.g. to move them out */
+  std::vector<Tuple> &GetTuples() { return tuples_; }
+
+ private:
+  std::vector<Tuple> tuples_;
+  std::vector<RID> rids_;
+};
+
+}  // namespace bustub
@@ -19,7 +19,13 @@
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints, while the transactions keep running.
+ *
+ * BeginCheckpoint logs a CHECKPOINT record with the active transaction table and the dirty page table, whose
+ * smallest recLSN is where redo has to start from, or several records if the tables do not fit in a log buffer,
+ * and then writes back the pages that were dirty, one at a time, so that the next checkpoint starts redo later.
+ * EndCheckpoint makes the log persistent and drops the log before the oldest record that recovery may still need:
+ * the recLSN of a dirty page, or the BEGIN of a running transaction.
  */
 class CheckpointManager {
  public:
@@ -35,9 +41,11 @@ class CheckpointManager {
   void EndCheckpoint();
 
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  /** The lsn of the first CHECKPOINT record of the checkpoint in progress. */
+  lsn_t checkpoint_lsn_{INVALID_LSN};
 };
 
 }  // namespace bustub
@@ -13,9 +13,11 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,20 +27,29 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * The log is double buffered: records are appended to one buffer while the flush thread writes the other, and the
+ * two are swapped before each write. Committing transactions only ask for a flush and wait for it (see Flush), so
+ * all the commits appended while a write is in progress share the next write.
+ *
+ * Appending takes no latch. An appender reserves its lsn and its bytes in the buffer being filled with one
+ * compare-and-swap on reservation_, copies its record there, and then adds its size to the fill watermark of that
+ * buffer. The flush thread swaps buffers by flipping the buffer bit of reservation_, and writes the old buffer once
+ * its watermark has caught up with the bytes reserved in it.
  */
 class LogManager {
  public:
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : reservation_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
+    buffers_[0] = new char[LOG_BUFFER_SIZE];
+    buffers_[1] = new char[LOG_BUFFER_SIZE];
   }
 
   ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    delete[] buffers_[0];
+    delete[] buffers_[1];
+    buffers_[0] = nullptr;
+    buffers_[1] = nullptr;
   }
 
   void RunFlushThread();
@@ -46,29 +57,91 @@ class LogManager {
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
-  inline lsn_t GetNextLSN() { return next_lsn_; }
+  /**
+   * Blocks until the log records up to and including lsn are on disk, writing them out if the flush thread is not
+   * running. Concurrent callers are served by the same write.
+   * @param lsn the last log sequence number that must be persistent
+   */
+  void Flush(lsn_t lsn);
+
+  /**
+   * Drops the log records before lsn from the log file, once they are no longer needed for recovery. The records
+   * to drop must be persistent already. Writes of the log wait meanwhile, appends do not.
+   * @param lsn the first log sequence number to keep
+   */
+  void TruncateLog(lsn_t lsn);
+
+  /**
+   * Continues the log after the records recovery found on disk, which are all persistent. Nothing may have been
+   * appended before.
+   * @param lsn the next log sequence number, one past the last record on disk
+   */
+  void SetNextLSN(lsn_t lsn);
+
+  inline lsn_t GetNextLSN() { return LsnOf(reservation_); }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  inline char *GetLogBuffer() { return buffers_[BufferOf(reservation_)]; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** The low bits of a reservation count the bytes reserved in the buffer being filled. */
+  static constexpr int OFFSET_BITS = 31;
+  static constexpr uint64_t OFFSET_MASK = (uint64_t{1} << OFFSET_BITS) - 1;
+
+  /** @return the next lsn of a reservation word */
+  static lsn_t LsnOf(uint64_t reservation) { return static_cast<lsn_t>(reservation >> 32); }
+  /** @return the index of the buffer being filled of a reservation word */
+  static int BufferOf(uint64_t reservation) { return static_cast<int>((reservation >> OFFSET_BITS) & 1); }
+  /** @return the bytes reserved in the buffer being filled of a reservation word */
+  static int OffsetOf(uint64_t reservation) { return static_cast<int>(reservation & OFFSET_MASK); }
+  static uint64_t MakeReservation(lsn_t lsn, int buffer, int offset) {
+    return (static_cast<uint64_t>(lsn) << 32) | (static_cast<uint64_t>(buffer) << OFFSET_BITS) |
+           static_cast<uint64_t>(offset);
+  }
 
-  /** The atomic counter which records the next log sequence number. */
-  std::atomic<lsn_t> next_lsn_;
+  /**
+   * Swaps the buffers and writes out the records appended so far. Only one thread writes at a time.
+   * @param lock the held latch_, released during the write
+   */
+  void FlushBuffer(std::unique_lock<std::mutex> *lock);
+
+  /**
+   * Waits until the buffer of reservation, which is too full for the caller's record, has been swapped out.
+   * @param reservation the reservation word seen by the caller
+   */
+  void WaitForRoom(uint64_t reservation);
+
+  /** Copies log_record into the log. */
+  static void SerializeLogRecord(LogRecord *log_record, char *pos);
+
+  /**
+   * The next log sequence number (high 32 bits), the buffer being filled (1 bit) and the number of bytes reserved in
+   * it (low 31 bits). All three change together, so the records lie in the buffers in lsn order.
+   */
+  std::atomic<uint64_t> reservation_;
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
-  char *log_buffer_;
-  char *flush_buffer_;
+  char *buffers_[2];
+  /** The fill watermarks, the number of bytes of each buffer whose records have been copied in. */
+  std::atomic<int> filled_[2] = {0, 0};
 
+  /** Guards the flags below, and the buffer swaps so that waiting for one misses no wake up. */
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
+  /** True while a write is in progress, the buffer written must not be swapped back in until it is done. */
+  bool flushing_{false};
+  /** True when a committer or a full buffer is waiting on the flush thread, which then skips the timeout. */
+  bool flush_requested_{false};
+  bool stop_{false};
 
+  /** Wakes up the flush thread. */
   std::condition_variable cv_;
+  /** Wakes up the appenders waiting for room and the committers waiting for their records to be persistent. */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
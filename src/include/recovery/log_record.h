@@ -14,6 +14,8 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,6 +34,8 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** A fuzzy checkpoint, with the active transactions and the dirty pages at the time it was taken. */
+  CHECKPOINT,
 };
 
 /**
@@ -54,9 +58,13 @@ enum class LogRecordType {
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-----------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-----------------------------------
+ * For checkpoint type log record, followed by the (txn_id, last_lsn) and the (page_id, rec_lsn) pairs
+ *------------------------------------------------------------------------------------------------
+ * | HEADER | redo_lsn | txn_count | active_txns[txn_count] | page_count | dirty_pages[page_count] |
+ *------------------------------------------------------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -110,6 +118,18 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for CHECKPOINT type
+  LogRecord(lsn_t redo_lsn, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : log_record_type_(LogRecordType::CHECKPOINT),
+        redo_lsn_(redo_lsn),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    // calculate log record size
+    size_ = HEADER_SIZE + sizeof(lsn_t) + 2 * sizeof(int32_t) +
+            (active_txns_.size() + dirty_pages_.size()) * (sizeof(int32_t) + sizeof(lsn_t));
+  }
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -128,6 +148,12 @@ class LogRecord {
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline lsn_t GetRedoLSN() { return redo_lsn_; }
+
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() { return active_txns_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() { return dirty_pages_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -176,6 +202,11 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for checkpoint, redo can start from redo_lsn_
+  lsn_t redo_lsn_{INVALID_LSN};
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
@@ -15,20 +15,28 @@
 #include <algorithm>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
+#include "recovery/log_manager.h"
 #include "recovery/log_record.h"
 
 namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Redo repeats history page by page: the records of different pages are independent, so they are partitioned by page
+ * id and replayed by one worker thread per partition, each in lsn order. Undo then rolls back the transactions that
+ * were active at the crash, in reverse lsn order. Redo skips the records before the redo lsn of the last checkpoint,
+ * which are on disk already. The log manager then continues the log after the last record found.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, LogManager *log_manager)
+      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), log_manager_(log_manager), offset_(0) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
@@ -39,18 +47,47 @@ class LogRecovery {
 
   void Redo();
   void Undo();
+
+  /**
+   * Deserializes the log record at data, which points into the log buffer.
+   * @param data the start of the log record
+   * @param[out] log_record the deserialized log record
+   * @return true means deserialize succeed, otherwise can't deserialize cause incomplete log record
+   */
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A log record to redo on the page with the given id. */
+  using RedoTask = std::pair<page_id_t, LogRecord>;
+
+  /**
+   * Redoes log_record on the page page_id if the page has not seen it yet. A NEWPAGE record is redone both on the new
+   * page, and on the page before it, which links to the new page.
+   */
+  void RedoRecord(page_id_t page_id, LogRecord *log_record);
+
+  /** Rolls back the change of log_record. */
+  void UndoRecord(LogRecord *log_record);
+
+  /** Ends each transaction rolled back by Undo with an ABORT record, once its rollback is on disk. */
+  void LogAborts();
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
   /** Mapping the log sequence number to log file offset for undos. */
   std::unordered_map<lsn_t, int> lsn_mapping_;
 
-  int offset_ __attribute__((__unused__));
+  /** Redo starts at this lsn, from the last checkpoint in the log. */
+  lsn_t redo_lsn_{INVALID_LSN};
+  /** One past the last lsn in the log. */
+  lsn_t next_lsn_{0};
+
+  /** The log file offset of log_buffer_. */
+  int offset_;
   char *log_buffer_;
 };
 
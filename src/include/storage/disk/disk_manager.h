@@ -70,6 +70,12 @@ class DiskManager {
    */
   bool ReadLog(char *log_data, int size, int offset);
 
+  /**
+   * Drop the beginning of the log file, which is rewritten with the rest of the log only.
+   * @param offset offset of the first byte of the log to keep
+   */
+  void TruncateLog(int offset);
+
   /**
    * Allocate a page on disk.
    * @return the id of the allocated page
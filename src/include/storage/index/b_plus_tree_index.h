@@ -13,6 +13,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "storage/index/b_plus_tree.h"
@@ -33,6 +34,13 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /**
+   * Look up many keys at once. The keys are sorted first, so the tree is probed in one sweep of its leaves.
+   * @param keys the key tuples, in any order
+   * @param[out] result (index into keys, rid) of every key found, in key order
+   */
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::pair<size_t, RID>> *result);
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
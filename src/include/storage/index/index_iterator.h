@@ -27,6 +27,12 @@ class IndexIterator {
   IndexIterator(Page* page_ptr, int index, BufferPoolManager* bpm_ptr);
   ~IndexIterator();
 
+  // the iterator owns the read latch and the pin of its leaf, so it can be moved but not copied
+  IndexIterator(IndexIterator &&other) noexcept;
+  IndexIterator &operator=(IndexIterator &&other) noexcept;
+  IndexIterator(const IndexIterator &) = delete;
+  IndexIterator &operator=(const IndexIterator &) = delete;
+
   bool isEnd();
 
   const MappingType &operator*();
@@ -44,6 +50,9 @@ class IndexIterator {
   B_PLUS_TREE_LEAF_PAGE_TYPE* SafelyGetAndLatchLeafPage();
 
  private:
+  // release the latch and the pin of the current leaf, if any
+  void ReleaseLeafPage();
+
   // add your own private member variables here
   page_id_t page_id_;
   int index_;
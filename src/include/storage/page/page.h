@@ -89,6 +89,8 @@ class Page {
     page_id_ = INVALID_PAGE_ID;
     is_dirty_ = false;
     pin_count_ = 0;
+    fetch_count_ = 0;
+    rec_lsn_ = INVALID_LSN;
   }
 
  protected:
@@ -111,6 +113,13 @@ class Page {
   int pin_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
   bool is_dirty_ = false;
+  /** The number of times the page was fetched since it was read into its frame. */
+  size_t fetch_count_ = 0;
+  /**
+   * The lsn of the first log record that may have changed the page since it was last written, INVALID_LSN while the
+   * page is clean and unpinned. Maintained by the buffer pool manager for checkpoints.
+   */
+  lsn_t rec_lsn_ = INVALID_LSN;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
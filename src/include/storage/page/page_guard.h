@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+
+/**
+ * BasicPageGuard holds the pin of a buffer pool page and unpins it when it goes out of scope.
+ * Guards are move-only: moving one hands the pin over without touching the buffer pool.
+ * A default-constructed or moved-from guard holds nothing, check it with IsValid().
+ */
+class BasicPageGuard {
+ public:
+  BasicPageGuard() = default;
+
+  /**
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+
+  BasicPageGuard &operator=(BasicPageGuard &&that) noexcept;
+
+  DISALLOW_COPY(BasicPageGuard);
+
+  ~BasicPageGuard() { Drop(); }
+
+  /** Unpin the page now, the guard is empty afterwards. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  inline bool IsValid() const { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  inline page_id_t PageId() const { return page_->GetPageId(); }
+
+  /** @return the guarded page */
+  inline Page *GetPage() const { return page_; }
+
+  /** @return the guarded page as a page type, e.g. TablePage */
+  template <class T>
+  T *As() const {
+    return reinterpret_cast<T *>(page_);
+  }
+
+  /** Write the page back when it is unpinned. */
+  inline void MarkDirty() { is_dirty_ = true; }
+
+ private:
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard holds the pin and the read latch of a page, and releases both when it goes out of scope.
+ */
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+
+  /**
+   * Read latch an already pinned page.
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page);
+
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+
+  ReadPageGuard &operator=(ReadPageGuard &&that) noexcept;
+
+  DISALLOW_COPY(ReadPageGuard);
+
+  ~ReadPageGuard() { Drop(); }
+
+  /** Unlatch and unpin the page now, the guard is empty afterwards. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  inline bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  inline page_id_t PageId() const { return guard_.PageId(); }
+
+  /** @return the guarded page as a page type, which must only be read */
+  template <class T>
+  T *As() const {
+    return guard_.As<T>();
+  }
+
+ private:
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard holds the pin and the write latch of a page, and releases both when it goes out of scope.
+ * The page is only written back if it was marked dirty.
+ */
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+
+  /**
+   * Write latch an already pinned page.
+   * @param bpm the buffer pool manager the page was pinned in
+   * @param page the pinned page, nullptr for an empty guard
+   */
+  WritePageGuard(BufferPoolManager *bpm, Page *page);
+
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+
+  WritePageGuard &operator=(WritePageGuard &&that) noexcept;
+
+  DISALLOW_COPY(WritePageGuard);
+
+  ~WritePageGuard() { Drop(); }
+
+  /** Unlatch and unpin the page now, the guard is empty afterwards. */
+  void Drop();
+
+  /** @return true if the guard holds a page */
+  inline bool IsValid() const { return guard_.IsValid(); }
+
+  /** @return the id of the guarded page */
+  inline page_id_t PageId() const { return guard_.PageId(); }
+
+  /** @return the guarded page as a page type */
+  template <class T>
+  T *As() const {
+    return guard_.As<T>();
+  }
+
+  /** Write the page back when it is unpinned. */
+  inline void MarkDirty() { guard_.MarkDirty(); }
+
+ private:
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <cstring>
+#include <functional>
 
 #include "common/rid.h"
 #include "concurrency/lock_manager.h"
@@ -24,6 +25,12 @@ static constexpr uint64_t DELETE_MASK = (1U << (8 * sizeof(uint32_t) - 1));
 
 namespace bustub {
 
+/**
+ * A scan predicate pushed down to the page: it is evaluated on the raw bytes of a tuple in place,
+ * under the page latch, so rejected tuples are never copied or locked.
+ */
+using TupleFilter = std::function<bool(const char *)>;
+
 /**
  * Slotted page format:
  *  ---------------------------------------------------------
@@ -77,17 +84,26 @@ class TablePage : public Page {
    * @param tuple tuple to insert
    * @param[out] rid rid of the inserted tuple
    * @param txn transaction performing the insert
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager to lock the new tuple with, nullptr if a table lock of txn already covers it
    * @param log_manager the log manager
    * @return true if the insert is successful (i.e. there is enough space)
    */
   bool InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager);
 
+  /**
+   * To be called on recovery, which logs nothing. Insert a tuple into the slot it was logged in: the insert may
+   * have passed over free slots that were still locked, so the first free slot is not necessarily the one.
+   * @param tuple tuple to insert
+   * @param rid rid the tuple was inserted at, a free slot or the next new one
+   * @return true if the slot was free and the page had room for the tuple
+   */
+  bool InsertTupleAt(const Tuple &tuple, const RID &rid);
+
   /**
    * Mark a tuple as deleted. This does not actually delete the tuple.
    * @param rid rid of the tuple to mark as deleted
    * @param txn transaction performing the delete
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if a table lock of txn already covers the tuple
    * @param log_manager the log manager
    * @return true if marking the tuple as deleted is successful (i.e the tuple exists)
    */
@@ -99,7 +115,7 @@ class TablePage : public Page {
    * @param[out] old_tuple old value of the tuple
    * @param rid rid of the tuple
    * @param txn transaction performing the update
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if a table lock of txn already covers the tuple
    * @param log_manager the log manager
    * @return true if updating the tuple succeeded
    */
@@ -112,30 +128,63 @@ class TablePage : public Page {
   /** To be called on abort. Rollback a delete, i.e. this reverses a MarkDelete. */
   void RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager);
 
+  /**
+   * To be called on recovery, which logs nothing. Put a tuple removed by ApplyDelete back into its slot, marked
+   * deleted: the delete it undoes was either committed, or is rolled back by the undo of the records before it.
+   * @param tuple the removed tuple
+   * @param rid rid the tuple had
+   * @return true if the slot was free and the page had room for the tuple
+   */
+  bool RestoreDeleted(const Tuple &tuple, const RID &rid);
+
   /**
    * Read a tuple from a table.
    * @param rid rid of the tuple to read
    * @param[out] tuple the tuple that was read
    * @param txn transaction performing the read
-   * @param lock_manager the lock manager
+   * @param lock_manager the lock manager, nullptr if a table lock of txn already covers the tuple
    * @return true if the read is successful (i.e. the tuple exists)
    */
   bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager);
 
-  /** @return the rid of the first tuple in this page */
+  /**
+   * Locate a tuple in place, without copying it. The caller must hold a latch on this page for as long as it
+   * reads the returned data, and is responsible for any tuple lock.
+   * @param rid rid of the tuple to locate
+   * @param[out] data the tuple data inside this page
+   * @param[out] size the size of the tuple
+   * @return true if the tuple exists
+   */
+  bool GetTupleData(const RID &rid, const char **data, uint32_t *size);
+
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param filter if set, tuples whose raw data it rejects are skipped. The data is read unlocked, so only a reader
+   * that may see uncommitted changes anyway (READ_UNCOMMITTED) can skip on it
+   * @param marked_deleted if true, tuples marked deleted are not skipped, for snapshot reads
    * @return true if the first tuple exists, false otherwise
    */
-  bool GetFirstTupleRid(RID *first_rid);
+  bool GetFirstTupleRid(RID *first_rid, const TupleFilter &filter = nullptr, bool marked_deleted = false);
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param filter if set, tuples whose raw data it rejects are skipped. The data is read unlocked, so only a reader
+   * that may see uncommitted changes anyway (READ_UNCOMMITTED) can skip on it
+   * @param marked_deleted if true, tuples marked deleted are not skipped, for snapshot reads
    * @return true if the next tuple exists, false otherwise
    */
-  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID *next_rid, const TupleFilter &filter = nullptr,
+                       bool marked_deleted = false);
+
+  /** @return the number of bytes left for new tuples and their slots */
+  uint32_t GetFreeSpaceRemaining() {
+    return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount();
+  }
+
+  /** @return the bytes a new tuple of the given size takes, including its slot */
+  static constexpr uint32_t SpaceNeeded(uint32_t tuple_size) { return tuple_size + SIZE_TUPLE; }
 
  private:
   static_assert(sizeof(page_id_t) == 4);
@@ -166,10 +215,6 @@ class TablePage : public Page {
   /** Set the number of tuples in this page. */
   void SetTupleCount(uint32_t tuple_count) { memcpy(GetData() + OFFSET_TUPLE_COUNT, &tuple_count, sizeof(uint32_t)); }
 
-  uint32_t GetFreeSpaceRemaining() {
-    return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount();
-  }
-
   /** @return tuple offset at slot slot_num */
   uint32_t GetTupleOffsetAtSlot(uint32_t slot_num) {
     return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num);
@@ -193,6 +238,11 @@ class TablePage : public Page {
   /** @return true if the tuple is deleted or empty */
   static bool IsDeleted(uint32_t tuple_size) { return static_cast<bool>(tuple_size & DELETE_MASK) || tuple_size == 0; }
 
+  /** @return true if the slot holds a tuple, marked deleted or not */
+  static bool IsOccupied(uint32_t tuple_size, bool marked_deleted) {
+    return marked_deleted ? UnsetDeletedFlag(tuple_size) != 0 : !IsDeleted(tuple_size);
+  }
+
   /** @return tuple size with the deleted flag set */
   static uint32_t SetDeletedFlag(uint32_t tuple_size) { return static_cast<uint32_t>(tuple_size | DELETE_MASK); }
 
@@ -0,0 +1,86 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.h
+//
+// Identification: src/include/storage/table/free_space_map.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * FreeSpaceMap keeps the free bytes of every page of a table heap, so an insert goes straight to a page with room
+ * instead of walking the table from its first page.
+ *
+ * The map lives in memory only; an opened table rebuilds it from its pages (see TableHeap::LoadFreeSpaceMap), so
+ * it never leaves pages behind on disk. Its entries are split in chunks of consecutive heap pages, each with its
+ * own latch, so inserters going to different parts of the table do not wait on each other.
+ *
+ * The recorded free bytes are hints: the caller still tries the insert on the page under its write latch and
+ * reports the real free bytes back with UpdatePage.
+ */
+class FreeSpaceMap {
+ public:
+  FreeSpaceMap() = default;
+
+  DISALLOW_COPY_AND_MOVE(FreeSpaceMap);
+
+  /**
+   * Register a new heap page.
+   * @param page_id the heap page
+   * @param free_bytes its free bytes
+   */
+  void AddPage(page_id_t page_id, uint32_t free_bytes);
+
+  /**
+   * Record the free bytes of a heap page. Pages that were never added are ignored.
+   * @param page_id the heap page
+   * @param free_bytes its free bytes
+   */
+  void UpdatePage(page_id_t page_id, uint32_t free_bytes);
+
+  /**
+   * Find a heap page that has at least the given free bytes.
+   * @param needed the free bytes needed
+   * @return the first such heap page in the order they were added, INVALID_PAGE_ID if none
+   */
+  page_id_t FindPage(uint32_t needed);
+
+ private:
+  /** The number of heap pages in one chunk. */
+  static constexpr uint32_t CHUNK_SIZE = 256;
+
+  struct Chunk {
+    /** Guards the free bytes of the entries. */
+    std::mutex latch_;
+    /** (heap page id, free bytes), in the order the pages were added. */
+    std::vector<std::pair<page_id_t, uint32_t>> entries_;
+    /** An upper bound of the free bytes of the entries, so a search can skip the chunk without latching it. */
+    std::atomic<uint32_t> max_free_{0};
+  };
+
+  /** Taken shared to look up and update entries, exclusive to add them. */
+  std::shared_mutex latch_;
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  /** Heap page id -> index of its entry across the chunks. */
+  std::unordered_map<page_id_t, uint32_t> entry_index_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_cursor.h
+//
+// Identification: src/include/storage/table/table_cursor.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "common/macros.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/page/page_guard.h"
+#include "storage/page/table_page.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+class TableHeap;
+
+/**
+ * TableCursor scans a TableHeap a page at a time. Unlike TableIterator, which fetches its page once per tuple and
+ * copies every tuple out, the cursor keeps its current page pinned until it moves past the last tuple of that
+ * page, and lets the caller read tuples in place.
+ *
+ * Reading in place:
+ *   cursor.RLatch();
+ *   if (cursor.GetTupleView(&view)) { ... view is valid until RUnlatch() ... }
+ *   cursor.RUnlatch();
+ * Never acquire a tuple lock while holding the latch, a writer holding that lock may be waiting for the page.
+ * A lock may also wait for a long time, so release the pin around it too:
+ *   cursor.Unpin();
+ *   ... lock cursor.GetRid() ...
+ *   cursor.Repin();
+ * The tuple may have changed or gone meanwhile, GetTupleView and GetTuple look at the slot again.
+ */
+class TableCursor {
+ public:
+  /**
+   * @param table_heap the table heap to scan
+   * @param first_page_id the first page of the scan
+   * @param stop_page_id the first page not to scan, INVALID_PAGE_ID to scan to the tail
+   * @param filter if set, tuples whose raw data it rejects are skipped in place
+   * @param marked_deleted if true, tuples marked deleted are visited too, a snapshot may still see them
+   */
+  TableCursor(TableHeap *table_heap, page_id_t first_page_id, page_id_t stop_page_id = INVALID_PAGE_ID,
+              TupleFilter filter = nullptr, bool marked_deleted = false);
+
+  DISALLOW_COPY_AND_MOVE(TableCursor);
+
+  /**
+   * Move to the next tuple, the first one on the first call.
+   * @return false if the scan is over
+   */
+  bool Advance();
+
+  /** @return the rid of the current tuple */
+  const RID &GetRid() const { return rid_; }
+
+  /** Release the pin of the current page, the cursor stays on the current tuple. */
+  void Unpin() { page_guard_.Drop(); }
+
+  /** Pin the page of the current tuple again after Unpin(). */
+  void Repin();
+
+  /** Read latch the current page. */
+  void RLatch() { GetPage()->RLatch(); }
+
+  /** Release the read latch of the current page. */
+  void RUnlatch() { GetPage()->RUnlatch(); }
+
+  /**
+   * View the current tuple in the pinned page, the caller must hold the read latch.
+   * @param[out] view the current tuple, valid until the latch is released
+   * @return false if the tuple was deleted since the cursor moved to it
+   */
+  bool GetTupleView(TupleView *view) {
+    const char *data;
+    uint32_t size;
+    if (!GetPage()->GetTupleData(rid_, &data, &size)) {
+      return false;
+    }
+    *view = TupleView(data, size, rid_);
+    return true;
+  }
+
+  /**
+   * Copy the current tuple out of the pinned page, or the version of it a snapshot transaction sees.
+   * @param[out] tuple the current tuple
+   * @param txn the transaction performing the scan
+   * @return false if the tuple was deleted since the cursor moved to it, or the snapshot does not see it
+   */
+  bool GetTuple(Tuple *tuple, Transaction *txn);
+
+ private:
+  TablePage *GetPage() const { return page_guard_.As<TablePage>(); }
+
+  TableHeap *table_heap_;
+  page_id_t stop_page_id_;
+  TupleFilter filter_;
+  bool marked_deleted_;
+  /** The pin of the current page, empty once the scan is over. */
+  BasicPageGuard page_guard_;
+  /** The current tuple, page id INVALID_PAGE_ID before the first tuple of page_. */
+  RID rid_;
+};
+
+}  // namespace bustub
@@ -12,9 +12,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "concurrency/version_store.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
+#include "storage/table/free_space_map.h"
+#include "storage/table/table_cursor.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
 
@@ -22,10 +30,13 @@ namespace bustub {
 
 /**
  * TableHeap represents a physical table on disk.
- * This is just a doubly-linked list of pages.
+ * This is just a doubly-linked list of pages, with a free space map to find a page with room for an insert.
+ * The pages hold the newest version of each tuple, the older ones live in the version store for snapshot reads.
+ * A committed delete stays marked in its page until no snapshot sees the tuple any more.
  */
 class TableHeap {
   friend class TableIterator;
+  friend class TableCursor;
 
  public:
   ~TableHeap() = default;
@@ -76,6 +87,14 @@ class TableHeap {
    */
   bool UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn);
 
+  /**
+   * Called by the garbage collector to delete the tuples no snapshot sees any more. Each one is locked exclusively
+   * first, without waiting: a locked one is left to a later pass.
+   * @param rids rids of the deleted tuples to purge
+   * @param txn the transaction of the garbage collector, which performs the purge and keeps the locks
+   */
+  void Purge(const std::vector<RID> &rids, Transaction *txn);
+
   /**
    * Called on Commit/Abort to actually delete a tuple or rollback an insert.
    * @param rid rid of the tuple to delete
@@ -99,20 +118,112 @@ class TableHeap {
    */
   bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
 
+  /**
+   * Read a tuple in place. The page stays pinned and read latched while the visitor runs, so the visitor must
+   * neither keep the view nor acquire locks.
+   * @param rid rid of the tuple to read
+   * @param txn transaction performing the read
+   * @param visitor called with a view of the tuple if it exists
+   * @return true if the read was successful (i.e. the tuple exists)
+   */
+  bool VisitTuple(const RID &rid, Transaction *txn, const std::function<void(const TupleView &)> &visitor);
+
+  /**
+   * Read many tuples in place, visiting them grouped by page so that each page is pinned once for all its tuples.
+   * Each tuple is locked before its page is latched, as in VisitTuple, and tuples that do not exist are skipped.
+   * A page is unpinned before a lock request, which may wait, and pinned again after it.
+   * @param rids rids of the tuples to read, in any order
+   * @param txn transaction performing the reads
+   * @param visitor called with the index of the rid in rids and a view of its tuple, in page order
+   */
+  void VisitTuples(const std::vector<RID> &rids, Transaction *txn,
+                   const std::function<void(size_t idx, const TupleView &)> &visitor);
+
+  /**
+   * Read the version of a tuple the snapshot of txn sees, in place.
+   * @param page the page of the tuple, read latched by the caller
+   * @param rid rid of the tuple to read
+   * @param txn snapshot transaction performing the read
+   * @param visitor called with a view of the version, if the snapshot sees one
+   * @return true if the snapshot sees a version of the tuple
+   * @throws TransactionAbortException if this table was written without keeping the versions of the snapshot
+   */
+  bool VisitSnapshot(TablePage *page, const RID &rid, Transaction *txn,
+                     const std::function<void(const TupleView &)> &visitor);
+
+  /** @return the older versions of the tuples of this table */
+  VersionStore *GetVersionStore() { return &versions_; }
+
   /** @return the begin iterator of this table */
   TableIterator Begin(Transaction *txn);
 
+  /**
+   * Begin a scan over the page range [first_page_id, stop_page_id) of this table.
+   * @param txn transaction performing the scan
+   * @param first_page_id the first page of the range
+   * @param stop_page_id the first page after the range, INVALID_PAGE_ID to scan to the tail
+   * @param filter if set, a predicate pushed down into the pages, tuples it rejects are skipped in place without
+   * being locked, so only for READ_UNCOMMITTED scans
+   * @return the begin iterator of the page range
+   */
+  TableIterator Begin(Transaction *txn, page_id_t first_page_id, page_id_t stop_page_id,
+                      const TupleFilter &filter = nullptr);
+
+  /**
+   * List the pages of this table, in chain order.
+   * @param txn the transaction listing the pages, aborted if one of them cannot be fetched
+   * @param[out] page_ids the ids of all pages of this table, none on failure
+   * @return false if a page could not be fetched
+   */
+  bool GetPageIds(Transaction *txn, std::vector<page_id_t> *page_ids);
+
   /** @return the end iterator of this table */
   TableIterator End();
 
   /** @return the id of the first page of this table */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  /** @param oid the oid the catalog registered this table under, its table locks then cover the rows of this heap */
+  inline void SetOid(table_oid_t oid) {
+    oid_ = oid;
+    has_oid_ = true;
+  }
+
  private:
+  /** Register every page of an opened table in the free space map, and find the tail. Runs once. */
+  void LoadFreeSpaceMap();
+
+  /**
+   * Insert at the tail of the table, appending a new page when the tail is full.
+   * @param[out] appended_page set to true if the tuple went into a newly appended page
+   * @return the guard of the page holding the tuple, empty if no page could be fetched or created
+   */
+  WritePageGuard InsertAtTail(const Tuple &tuple, RID *rid, Transaction *txn, bool *appended_page);
+
+  /**
+   * @return the lock manager to lock a row of this table in mode through, nullptr if a table lock of txn already
+   * covers the row, e.g. once its row locks were escalated
+   */
+  LockManager *RowLockManager(Transaction *txn, LockMode mode);
+
+  /**
+   * Lock a row of this table in shared mode. With an oid the row is locked under an intention lock on the table, so
+   * it waits for a writer that escalated to a table lock, and it escalates in turn.
+   * @return true if the lock is granted
+   */
+  bool LockRowShared(Transaction *txn, const RID &rid);
+
   BufferPoolManager *buffer_pool_manager_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
+  table_oid_t oid_{};
+  bool has_oid_{false};
   page_id_t first_page_id_{};
+  /** A hint of the last page of the table; the true tail is found by following next page ids from it. */
+  std::atomic<page_id_t> last_page_id_{INVALID_PAGE_ID};
+  FreeSpaceMap free_space_map_;
+  std::once_flag free_space_map_loaded_;
+  VersionStore versions_;
 };
 
 }  // namespace bustub
@@ -13,9 +13,11 @@
 #pragma once
 
 #include <cassert>
+#include <utility>
 
 #include "common/rid.h"
 #include "concurrency/transaction.h"
+#include "storage/page/table_page.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -29,10 +31,22 @@ class TableIterator {
   friend class Cursor;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  /**
+   * @param table_heap the table heap to iterate
+   * @param rid the rid of the first tuple
+   * @param txn the transaction performing the scan
+   * @param stop_page_id the iterator reaches End() instead of entering this page (INVALID_PAGE_ID scans to the tail)
+   * @param filter if set, the iterator skips the tuples it rejects without copying them out of their page
+   */
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, page_id_t stop_page_id = INVALID_PAGE_ID,
+                TupleFilter filter = nullptr);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        stop_page_id_(other.stop_page_id_),
+        filter_(other.filter_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -52,6 +66,8 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    stop_page_id_ = other.stop_page_id_;
+    filter_ = other.filter_;
     return *this;
   }
 
@@ -59,6 +75,10 @@ class TableIterator {
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** The page this iterator stops in front of, used to split a scan into page ranges. */
+  page_id_t stop_page_id_;
+  /** The predicate pushed down into the pages, empty if none. */
+  TupleFilter filter_;
 };
 
 }  // namespace bustub
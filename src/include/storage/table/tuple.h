@@ -17,6 +17,7 @@
 
 #include "catalog/schema.h"
 #include "common/rid.h"
+#include "storage/table/tuple_view.h"
 #include "type/value.h"
 
 namespace bustub {
@@ -34,6 +35,8 @@ class Tuple {
 
   friend class TableIterator;
 
+  friend class CompiledProjection;
+
  public:
   // Default constructor (to create a dummy tuple)
   Tuple() = default;
@@ -44,12 +47,24 @@ class Tuple {
   // constructor for creating a new tuple based on input value
   Tuple(std::vector<Value> values, const Schema *schema);
 
+  // constructor copying the tuple a view points to, deep copy
+  explicit Tuple(const TupleView &view);
+
+  // a tuple that does not own its data but borrows it from a view, only valid as long as the view
+  static Tuple Borrow(const TupleView &view);
+
   // copy constructor, deep copy
   Tuple(const Tuple &other);
 
+  // move constructor, steals the data of other
+  Tuple(Tuple &&other) noexcept;
+
   // assign operator, deep copy
   Tuple &operator=(const Tuple &other);
 
+  // move assign operator, steals the data of other
+  Tuple &operator=(Tuple &&other) noexcept;
+
   ~Tuple() {
     if (allocated_) {
       delete[] data_;
@@ -72,6 +87,9 @@ class Tuple {
   // Get length of the tuple, including varchar legth
   inline uint32_t GetLength() const { return size_; }
 
+  // Get a view of this tuple, valid as long as the tuple is alive and unchanged
+  inline TupleView GetView() const { return TupleView(data_, size_, rid_); }
+
   // Get the value of a specified column (const)
   // checks the schema to see how to return the Value.
   Value GetValue(const Schema *schema, uint32_t column_idx) const;
@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_view.h
+//
+// Identification: src/include/storage/table/tuple_view.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cassert>
+
+#include "catalog/schema.h"
+#include "common/rid.h"
+#include "type/value.h"
+
+namespace bustub {
+
+/**
+ * TupleView reads a tuple where it lies, in a pinned page or in a batch buffer, without owning or copying it.
+ * It has the same format as Tuple and is only valid as long as whatever provides it keeps that memory in place:
+ * the read latch of a TableCursor, the callback of TableHeap::VisitTuple, or the lifetime of the Tuple it views.
+ */
+class TupleView {
+ public:
+  TupleView() = default;
+
+  /**
+   * @param data the tuple data
+   * @param size the size of the tuple
+   * @param rid the rid of the tuple, if it lives in a table
+   */
+  TupleView(const char *data, uint32_t size, RID rid = RID()) : data_(data), size_(size), rid_(rid) {}
+
+  /** @return the tuple data */
+  inline const char *GetData() const { return data_; }
+
+  /** @return the size of the tuple, including varchar data */
+  inline uint32_t GetLength() const { return size_; }
+
+  /** @return the rid of the tuple, if it lives in a table */
+  inline RID GetRid() const { return rid_; }
+
+  /** @return the value of a column, the schema tells how to read it */
+  Value GetValue(const Schema *schema, uint32_t column_idx) const {
+    const TypeId column_type = schema->GetColumn(column_idx).GetType();
+    return Value::DeserializeFrom(GetColumnPtr(data_, schema, column_idx), column_type);
+  }
+
+  /** @return true if the column value is null */
+  inline bool IsNull(const Schema *schema, uint32_t column_idx) const {
+    return GetValue(schema, column_idx).IsNull();
+  }
+
+  /**
+   * @param data the data of a tuple
+   * @param schema the schema of the tuple
+   * @param column_idx the column to locate
+   * @return the starting storage address of the column
+   */
+  static const char *GetColumnPtr(const char *data, const Schema *schema, uint32_t column_idx) {
+    assert(schema);
+    assert(data);
+    const auto &col = schema->GetColumn(column_idx);
+    // For inline type, data is stored where it is.
+    if (col.IsInlined()) {
+      return data + col.GetOffset();
+    }
+    // We read the relative offset from the tuple data.
+    int32_t offset = *reinterpret_cast<const int32_t *>(data + col.GetOffset());
+    // And return the beginning address of the real data for the VARCHAR type.
+    return data + offset;
+  }
+
+ private:
+  const char *data_{nullptr};
+  uint32_t size_{0};
+  RID rid_{};
+};
+
+}  // namespace bustub
@@ -12,16 +12,73 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 namespace bustub {
 
 void CheckpointManager::BeginCheckpoint() {
-  // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
-  // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
-  // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
+  if (!enable_logging) {
+    return;
+  }
+  // Any change to a page that is clean by now is logged after this
+  lsn_t redo_lsn = log_manager_->GetNextLSN();
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  buffer_pool_manager_->GetDirtyPageTable(&dirty_pages);
+  for (const auto &[page_id, rec_lsn] : dirty_pages) {
+    redo_lsn = std::min(redo_lsn, rec_lsn);
+  }
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  transaction_manager_->GetActiveTransactions(&active_txns);
+
+  // A record must fit in a log buffer, large tables are spread over several records with the same redo lsn
+  LogRecord empty_record(redo_lsn, decltype(active_txns)(), decltype(dirty_pages)());
+  size_t max_entries = (LOG_BUFFER_SIZE - empty_record.GetSize()) / (sizeof(int32_t) + sizeof(lsn_t));
+  size_t txn_pos = 0;
+  size_t page_pos = 0;
+  checkpoint_lsn_ = INVALID_LSN;
+  do {
+    size_t txn_count = std::min(active_txns.size() - txn_pos, max_entries);
+    size_t page_count = std::min(dirty_pages.size() - page_pos, max_entries - txn_count);
+    LogRecord log_record(redo_lsn, {active_txns.begin() + txn_pos, active_txns.begin() + txn_pos + txn_count},
+                         {dirty_pages.begin() + page_pos, dirty_pages.begin() + page_pos + page_count});
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    if (checkpoint_lsn_ == INVALID_LSN) {
+      checkpoint_lsn_ = lsn;
+    }
+    txn_pos += txn_count;
+    page_pos += page_count;
+  } while (txn_pos < active_txns.size() || page_pos < dirty_pages.size());
+
+  // Write back the pages one at a time rather than all at once, the transactions only wait on the page being
+  // written. Those dirtied again meanwhile are left for the next checkpoint.
+  for (const auto &[page_id, rec_lsn] : dirty_pages) {
+    buffer_pool_manager_->WriteBackPage(page_id);
+  }
 }
 
 void CheckpointManager::EndCheckpoint() {
-  // Allow transactions to resume, completing the checkpoint.
+  if (!enable_logging || checkpoint_lsn_ == INVALID_LSN) {
+    return;
+  }
+  log_manager_->Flush(log_manager_->GetNextLSN() - 1);
+
+  // Recovery reads the log from the oldest change that may be missing on disk, or the oldest record of a running
+  // transaction, and from the last checkpoint at least
+  lsn_t keep_lsn = checkpoint_lsn_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  buffer_pool_manager_->GetDirtyPageTable(&dirty_pages);
+  for (const auto &[page_id, rec_lsn] : dirty_pages) {
+    keep_lsn = std::min(keep_lsn, rec_lsn);
+  }
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+  lsn_t begin_lsn = transaction_manager_->GetActiveTransactions(&active_txns);
+  if (begin_lsn != INVALID_LSN) {
+    keep_lsn = std::min(keep_lsn, begin_lsn);
+  }
+  log_manager_->TruncateLog(keep_lsn);
+  checkpoint_lsn_ = INVALID_LSN;
 }
 
 }  // namespace bustub
@@ -12,6 +12,9 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+#include <utility>
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,33 +25,222 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::scoped_lock lock(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  stop_ = false;
+  enable_logging = true;
+  flush_thread_ = new std::thread([this] {
+    std::unique_lock thread_lock(latch_);
+    while (!stop_) {
+      cv_.wait_for(thread_lock, log_timeout, [this] { return stop_ || flush_requested_; });
+      // Also the last flush once stopped
+      FlushBuffer(&thread_lock);
+    }
+  });
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::scoped_lock lock(latch_);
+    if (flush_thread_ == nullptr) {
+      return;
+    }
+    stop_ = true;
+  }
+  cv_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
+
+void LogManager::FlushBuffer(std::unique_lock<std::mutex> *lock) {
+  flushed_cv_.wait(*lock, [this] { return !flushing_; });
+  flush_requested_ = false;
+  // Close the buffer being filled: the appenders reserve in the other one from now on
+  uint64_t reservation = reservation_.load();
+  do {
+    if (OffsetOf(reservation) == 0) {
+      return;
+    }
+  } while (!reservation_.compare_exchange_weak(
+      reservation, MakeReservation(LsnOf(reservation), 1 - BufferOf(reservation), 0)));
+  int buffer = BufferOf(reservation);
+  int size = OffsetOf(reservation);
+  lsn_t last_lsn = LsnOf(reservation) - 1;
+  flushing_ = true;
+  // The appenders waiting for room go on filling the other buffer during the write
+  flushed_cv_.notify_all();
+  lock->unlock();
+  // The appenders that reserved space may still be copying their records, wait for the watermark. A copy never
+  // blocks, so this is short.
+  while (filled_[buffer].load() != size) {
+    std::this_thread::yield();
+  }
+  disk_manager_->WriteLog(buffers_[buffer], size);
+  filled_[buffer].store(0);
+  lock->lock();
+  flushing_ = false;
+  persistent_lsn_ = last_lsn;
+  flushed_cv_.notify_all();
+}
+
+void LogManager::WaitForRoom(uint64_t reservation) {
+  std::unique_lock lock(latch_);
+  while (BufferOf(reservation_.load()) == BufferOf(reservation)) {
+    if (flush_thread_ == nullptr) {
+      FlushBuffer(&lock);
+      continue;
+    }
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+}
+
+void LogManager::Flush(lsn_t lsn) {
+  std::unique_lock lock(latch_);
+  // Recovery continues the log after the records on disk, so every page lsn was handed out by this log
+  BUSTUB_ASSERT(lsn < GetNextLSN(), "Cannot flush a log record that was not appended.");
+  while (persistent_lsn_ < lsn) {
+    if (flush_thread_ == nullptr) {
+      FlushBuffer(&lock);
+      continue;
+    }
+    // Group commit: whoever asks while a write is in progress rides along on the next one
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+}
+
+void LogManager::TruncateLog(lsn_t lsn) {
+  // Take the log file from the writers, as if writing it
+  std::unique_lock lock(latch_);
+  flushed_cv_.wait(lock, [this] { return !flushing_; });
+  flushing_ = true;
+  lock.unlock();
+
+  // Find the first record to keep, walking the headers only
+  int offset = 0;
+  char header[LogRecord::HEADER_SIZE];
+  while (disk_manager_->ReadLog(header, LogRecord::HEADER_SIZE, offset)) {
+    int32_t size;
+    lsn_t record_lsn;
+    memcpy(&size, header, sizeof(int32_t));
+    memcpy(&record_lsn, header + 4, sizeof(lsn_t));
+    if (size < LogRecord::HEADER_SIZE || record_lsn >= lsn) {
+      break;
+    }
+    offset += size;
+  }
+  disk_manager_->TruncateLog(offset);
+
+  lock.lock();
+  flushing_ = false;
+  flushed_cv_.notify_all();
+}
+
+void LogManager::SetNextLSN(lsn_t lsn) {
+  std::scoped_lock lock(latch_);
+  uint64_t reservation = reservation_.load();
+  BUSTUB_ASSERT(OffsetOf(reservation) == 0 && !flushing_, "The log must be empty before recovery.");
+  reservation_.store(MakeReservation(lsn, BufferOf(reservation), 0));
+  persistent_lsn_ = lsn - 1;
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
- *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  // There would never be room for it
+  BUSTUB_ASSERT(log_record->size_ <= LOG_BUFFER_SIZE, "A log record cannot be larger than the log buffer.");
+  // Reserve the lsn and the bytes of the record at once
+  uint64_t reservation = reservation_.load();
+  while (true) {
+    int offset = OffsetOf(reservation);
+    if (offset + log_record->size_ > LOG_BUFFER_SIZE) {
+      WaitForRoom(reservation);
+      reservation = reservation_.load();
+      continue;
+    }
+    if (reservation_.compare_exchange_weak(reservation, MakeReservation(LsnOf(reservation) + 1, BufferOf(reservation),
+                                                                        offset + log_record->size_))) {
+      break;
+    }
+  }
+  int buffer = BufferOf(reservation);
+  log_record->lsn_ = LsnOf(reservation);
+  SerializeLogRecord(log_record, buffers_[buffer] + OffsetOf(reservation));
+  // The buffer cannot be written out before this, see FlushBuffer
+  filled_[buffer].fetch_add(log_record->size_);
+  return log_record->lsn_;
+}
+
+void LogManager::SerializeLogRecord(LogRecord *log_record, char *pos) {
+  // First, serialize the must have fields (20 bytes in total)
+  memcpy(pos, &log_record->size_, sizeof(int32_t));
+  memcpy(pos + 4, &log_record->lsn_, sizeof(lsn_t));
+  memcpy(pos + 8, &log_record->txn_id_, sizeof(txn_id_t));
+  memcpy(pos + 12, &log_record->prev_lsn_, sizeof(lsn_t));
+  memcpy(pos + 16, &log_record->log_record_type_, sizeof(LogRecordType));
+  pos += LogRecord::HEADER_SIZE;
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(pos, &log_record->insert_rid_, sizeof(RID));
+      log_record->insert_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(pos, &log_record->delete_rid_, sizeof(RID));
+      log_record->delete_tuple_.SerializeTo(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      memcpy(pos + sizeof(page_id_t), &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::CHECKPOINT: {
+      memcpy(pos, &log_record->redo_lsn_, sizeof(lsn_t));
+      pos += sizeof(lsn_t);
+      auto txn_count = static_cast<int32_t>(log_record->active_txns_.size());
+      memcpy(pos, &txn_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        memcpy(pos, &txn_id, sizeof(txn_id_t));
+        memcpy(pos + sizeof(txn_id_t), &last_lsn, sizeof(lsn_t));
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      auto page_count = static_cast<int32_t>(log_record->dirty_pages_.size());
+      memcpy(pos, &page_count, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        memcpy(pos, &page_id, sizeof(page_id_t));
+        memcpy(pos + sizeof(page_id_t), &rec_lsn, sizeof(lsn_t));
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    default:
+      // BEGIN, COMMIT and ABORT are the header only
+      break;
+  }
+}
 
 }  // namespace bustub
@@ -12,6 +12,14 @@
 
 #include "recovery/log_recovery.h"
 
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/logger.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -20,7 +28,121 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  auto remaining = log_buffer_ + LOG_BUFFER_SIZE - data;
+  if (remaining < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  int32_t size;
+  memcpy(&size, data, sizeof(int32_t));
+  // The log ends with zeros, and a record cut by the end of the buffer is read again from its start
+  if (size < LogRecord::HEADER_SIZE || size > remaining) {
+    return false;
+  }
+  log_record->size_ = size;
+  memcpy(&log_record->lsn_, data + 4, sizeof(lsn_t));
+  memcpy(&log_record->txn_id_, data + 8, sizeof(txn_id_t));
+  memcpy(&log_record->prev_lsn_, data + 12, sizeof(lsn_t));
+  memcpy(&log_record->log_record_type_, data + 16, sizeof(LogRecordType));
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  const char *end = data + size;
+  // Whether a tuple, its length and then its data, fits in the record at the given position. Checked before it is
+  // read, a torn or corrupt record must not be read past its end.
+  auto fits = [end](const char *at, ptrdiff_t before) {
+    at += before;
+    if (end - at < static_cast<ptrdiff_t>(sizeof(int32_t))) {
+      return false;
+    }
+    int32_t length;
+    memcpy(&length, at, sizeof(int32_t));
+    return length >= 0 && length <= end - at - static_cast<ptrdiff_t>(sizeof(int32_t));
+  };
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      if (!fits(pos, sizeof(RID))) {
+        return false;
+      }
+      memcpy(&log_record->insert_rid_, pos, sizeof(RID));
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      if (!fits(pos, sizeof(RID))) {
+        return false;
+      }
+      memcpy(&log_record->delete_rid_, pos, sizeof(RID));
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      if (!fits(pos, sizeof(RID))) {
+        return false;
+      }
+      memcpy(&log_record->update_rid_, pos, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      if (!fits(pos, 0)) {
+        return false;
+      }
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      if (end - pos < static_cast<ptrdiff_t>(2 * sizeof(page_id_t))) {
+        return false;
+      }
+      memcpy(&log_record->prev_page_id_, pos, sizeof(page_id_t));
+      memcpy(&log_record->page_id_, pos + sizeof(page_id_t), sizeof(page_id_t));
+      break;
+    case LogRecordType::CHECKPOINT: {
+      constexpr auto txn_entry_size = static_cast<ptrdiff_t>(sizeof(txn_id_t) + sizeof(lsn_t));
+      constexpr auto page_entry_size = static_cast<ptrdiff_t>(sizeof(page_id_t) + sizeof(lsn_t));
+      if (end - pos < static_cast<ptrdiff_t>(sizeof(lsn_t) + sizeof(int32_t))) {
+        return false;
+      }
+      memcpy(&log_record->redo_lsn_, pos, sizeof(lsn_t));
+      pos += sizeof(lsn_t);
+      int32_t txn_count;
+      memcpy(&txn_count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      // The page count follows the transactions
+      if (txn_count < 0 || txn_count > (end - pos - static_cast<ptrdiff_t>(sizeof(int32_t))) / txn_entry_size) {
+        return false;
+      }
+      for (int32_t i = 0; i < txn_count; i++) {
+        txn_id_t txn_id;
+        lsn_t last_lsn;
+        memcpy(&txn_id, pos, sizeof(txn_id_t));
+        memcpy(&last_lsn, pos + sizeof(txn_id_t), sizeof(lsn_t));
+        log_record->active_txns_.emplace_back(txn_id, last_lsn);
+        pos += sizeof(txn_id_t) + sizeof(lsn_t);
+      }
+      int32_t page_count;
+      memcpy(&page_count, pos, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      if (page_count < 0 || page_count > (end - pos) / page_entry_size) {
+        return false;
+      }
+      for (int32_t i = 0; i < page_count; i++) {
+        page_id_t page_id;
+        lsn_t rec_lsn;
+        memcpy(&page_id, pos, sizeof(page_id_t));
+        memcpy(&rec_lsn, pos + sizeof(page_id_t), sizeof(lsn_t));
+        log_record->dirty_pages_.emplace_back(page_id, rec_lsn);
+        pos += sizeof(page_id_t) + sizeof(lsn_t);
+      }
+      break;
+    }
+    case LogRecordType::BEGIN:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -29,12 +151,240 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  // One worker per partition, each pinning one page at a time
+  size_t num_workers = std::min<size_t>(std::max<size_t>(std::thread::hardware_concurrency(), 2),
+                                        buffer_pool_manager_->GetPoolSize());
+  std::vector<std::vector<RedoTask>> partitions(num_workers);
+  auto partition = [num_workers](page_id_t page_id) { return static_cast<uint32_t>(page_id) % num_workers; };
+
+  // Read the log a whole buffer at a time, a record cut at the end of the buffer starts the next read
+  offset_ = 0;
+  redo_lsn_ = INVALID_LSN;
+  next_lsn_ = 0;
+  while (disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_)) {
+    int pos = 0;
+    while (true) {
+      LogRecord log_record;
+      if (!DeserializeLogRecord(log_buffer_ + pos, &log_record)) {
+        break;
+      }
+      lsn_mapping_[log_record.lsn_] = offset_ + pos;
+      next_lsn_ = std::max(next_lsn_, log_record.lsn_ + 1);
+      pos += log_record.size_;
+      switch (log_record.log_record_type_) {
+        case LogRecordType::COMMIT:
+        case LogRecordType::ABORT:
+          active_txn_.erase(log_record.txn_id_);
+          continue;
+        case LogRecordType::BEGIN:
+          active_txn_[log_record.txn_id_] = log_record.lsn_;
+          continue;
+        case LogRecordType::CHECKPOINT:
+          // The log keeps every record of the active transactions back to their BEGIN, so the active transaction table
+          // is rebuilt from the records alone, only the redo lsn is needed
+          redo_lsn_ = log_record.redo_lsn_;
+          continue;
+        case LogRecordType::INSERT:
+          partitions[partition(log_record.insert_rid_.GetPageId())].emplace_back(log_record.insert_rid_.GetPageId(),
+                                                                                  log_record);
+          break;
+        case LogRecordType::MARKDELETE:
+        case LogRecordType::APPLYDELETE:
+        case LogRecordType::ROLLBACKDELETE:
+          partitions[partition(log_record.delete_rid_.GetPageId())].emplace_back(log_record.delete_rid_.GetPageId(),
+                                                                                  log_record);
+          break;
+        case LogRecordType::UPDATE:
+          partitions[partition(log_record.update_rid_.GetPageId())].emplace_back(log_record.update_rid_.GetPageId(),
+                                                                                  log_record);
+          break;
+        case LogRecordType::NEWPAGE:
+          partitions[partition(log_record.page_id_)].emplace_back(log_record.page_id_, log_record);
+          if (log_record.prev_page_id_ != INVALID_PAGE_ID) {
+            partitions[partition(log_record.prev_page_id_)].emplace_back(log_record.prev_page_id_, log_record);
+          }
+          break;
+        default:
+          break;
+      }
+      active_txn_[log_record.txn_id_] = log_record.lsn_;
+    }
+    // Nothing left but zeros or a torn record
+    if (pos == 0) {
+      break;
+    }
+    offset_ += pos;
+  }
+  // The records logged from now on, the ABORT records of the losers first, follow the ones on disk
+  log_manager_->SetNextLSN(next_lsn_);
+
+  // The pages are disjoint across partitions, so the workers never wait on each other
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers);
+  for (auto &tasks : partitions) {
+    workers.emplace_back([this, &tasks] {
+      for (auto &[page_id, log_record] : tasks) {
+        // The changes before the last checkpoint's redo lsn are all on disk already
+        if (log_record.lsn_ >= redo_lsn_) {
+          RedoRecord(page_id, &log_record);
+        }
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void LogRecovery::RedoRecord(page_id_t page_id, LogRecord *log_record) {
+  auto guard = buffer_pool_manager_->FetchPageWrite(page_id);
+  BUSTUB_ASSERT(guard.IsValid(), "Couldn't fetch a page to redo.");
+  auto page = guard.As<TablePage>();
+
+  // Linking the previous page to a new one is idempotent, and does not change the LSN of the previous page
+  if (log_record->log_record_type_ == LogRecordType::NEWPAGE && page_id != log_record->page_id_) {
+    if (page->GetNextPageId() != log_record->page_id_) {
+      page->SetNextPageId(log_record->page_id_);
+      guard.MarkDirty();
+    }
+    return;
+  }
+  if (page->GetLSN() >= log_record->lsn_) {
+    return;
+  }
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT: {
+      // Repeating history, the tuple goes back into the slot it was logged in
+      [[maybe_unused]] bool inserted = page->InsertTupleAt(log_record->insert_tuple_, log_record->insert_rid_);
+      BUSTUB_ASSERT(inserted, "Redo must insert the tuple into the slot it was logged in.");
+      break;
+    }
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple old_tuple;
+      page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::NEWPAGE:
+      page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+      break;
+    default:
+      break;
+  }
+  page->SetLSN(log_record->lsn_);
+  guard.MarkDirty();
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  // Undo the latest change first across all the losers, as the changes of different transactions may touch the
+  // same tuples
+  std::priority_queue<lsn_t> undo_lsns;
+  for (auto const &[txn_id, lsn] : active_txn_) {
+    undo_lsns.push(lsn);
+  }
+  while (!undo_lsns.empty()) {
+    lsn_t lsn = undo_lsns.top();
+    undo_lsns.pop();
+    auto mapping = lsn_mapping_.find(lsn);
+    if (mapping == lsn_mapping_.end()) {
+      LOG_DEBUG("The log record %d to undo was truncated", lsn);
+      continue;
+    }
+    offset_ = mapping->second;
+    LogRecord log_record;
+    if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_) ||
+        !DeserializeLogRecord(log_buffer_, &log_record)) {
+      LOG_DEBUG("I/O error while reading the log record %d to undo", lsn);
+      break;
+    }
+    UndoRecord(&log_record);
+    if (log_record.prev_lsn_ != INVALID_LSN) {
+      undo_lsns.push(log_record.prev_lsn_);
+    }
+  }
+  if (!active_txn_.empty()) {
+    LogAborts();
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+void LogRecovery::LogAborts() {
+  // The undone pages keep the lsn of the records undone on them: once on disk, a later recovery skips those records
+  // in redo, and the ABORT records keep it from undoing them again
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+  buffer_pool_manager_->GetDirtyPageTable(&dirty_pages);
+  for (const auto &[page_id, rec_lsn] : dirty_pages) {
+    buffer_pool_manager_->WriteBackPage(page_id);
+  }
+  lsn_t lsn = INVALID_LSN;
+  for (auto const &[txn_id, last_lsn] : active_txn_) {
+    LogRecord log_record(txn_id, last_lsn, LogRecordType::ABORT);
+    lsn = log_manager_->AppendLogRecord(&log_record);
+  }
+  log_manager_->Flush(lsn);
+}
+
+void LogRecovery::UndoRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    default:
+      // Nothing to undo for BEGIN, and a new page stays linked into its table, empty
+      return;
+  }
+  auto guard = buffer_pool_manager_->FetchPageWrite(page_id);
+  BUSTUB_ASSERT(guard.IsValid(), "Couldn't fetch a page to undo.");
+  auto page = guard.As<TablePage>();
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE: {
+      // Back into its own slot, the records before it name the tuple by its rid
+      [[maybe_unused]] bool restored = page->RestoreDeleted(log_record->delete_tuple_, log_record->delete_rid_);
+      BUSTUB_ASSERT(restored, "Undo must restore the tuple into the slot it was deleted from.");
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple new_tuple;
+      page->UpdateTuple(log_record->old_tuple_, &new_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    }
+    default:
+      break;
+  }
+  guard.MarkDirty();
+}
 
 }  // namespace bustub
@@ -10,12 +10,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -184,6 +188,58 @@ bool DiskManager::ReadLog(char *log_data, int size, int offset) {
   return true;
 }
 
+/**
+ * Truncate the log, keeping what follows offset
+ * The rest of the log is written to a new file first, which then replaces the log file, so that a crash in between
+ * leaves either the whole log or the truncated one. The new file is synced before the rename, and the directory
+ * after it, or the rename could reach the disk before the data it points to.
+ */
+void DiskManager::TruncateLog(int offset) {
+  int size = GetFileSize(log_name_);
+  if (offset <= 0 || offset > size) {
+    return;
+  }
+  std::vector<char> rest(size - offset);
+  log_io_.seekp(offset);
+  log_io_.read(rest.data(), rest.size());
+  if (log_io_.bad()) {
+    LOG_DEBUG("I/O error while reading log");
+    log_io_.clear();
+    return;
+  }
+
+  std::string tmp_name = log_name_ + ".tmp";
+  int tmp_fd = ::open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool written = tmp_fd >= 0 && ::write(tmp_fd, rest.data(), rest.size()) == static_cast<ssize_t>(rest.size()) &&
+                 ::fsync(tmp_fd) == 0;
+  if (tmp_fd >= 0) {
+    ::close(tmp_fd);
+  }
+  if (!written) {
+    LOG_DEBUG("I/O error while truncating log");
+    return;
+  }
+  log_io_.close();
+  if (std::rename(tmp_name.c_str(), log_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while truncating log");
+  } else {
+    auto slash = log_name_.find_last_of('/');
+    std::string dir_name = slash == std::string::npos ? "." : log_name_.substr(0, slash + 1);
+    int dir_fd = ::open(dir_name.c_str(), O_RDONLY);
+    if (dir_fd < 0 || ::fsync(dir_fd) != 0) {
+      LOG_DEBUG("I/O error while syncing the log directory");
+    }
+    if (dir_fd >= 0) {
+      ::close(dir_fd);
+    }
+  }
+  // reopen with original mode
+  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
+  if (!log_io_.is_open()) {
+    throw Exception("can't open dblog file");
+  }
+}
+
 /**
  * Allocate new page (operations like create index/table)
  * For now just keep an increasing counter
@@ -82,6 +82,68 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
   return true;
 }
 
+/*
+ * Batched point query: keys must be sorted in ascending order. Instead of a
+ * root-to-leaf descent per key, the leaf holding one key is kept latched for
+ * the next keys, and the sweep moves right to the sibling leaf when a key is
+ * past it. Only when a key is past the sibling too (the keys are sparse) is
+ * the tree descended again.
+ * @return : (index into keys, value) of every key that exists, in key order
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::GetValues(const std::vector<KeyType> &keys, std::vector<std::pair<size_t, ValueType>> *result) {
+  Page *page_ptr = nullptr;
+  IN_TREE_LEAF_PAGE_TYPE *leaf_ptr = nullptr;
+  auto release = [&](Page *page) {
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  };
+  auto past_leaf = [&](const KeyType &key) {
+    return leaf_ptr->GetSize() == 0 || comparator_(key, leaf_ptr->KeyAt(leaf_ptr->GetSize() - 1)) > 0;
+  };
+
+  for (size_t i = 0; i < keys.size(); i++){
+    const KeyType &key = keys[i];
+    if (page_ptr != nullptr && past_leaf(key)){
+      // Crab right to the sibling, like the index iterator does
+      page_id_t next_page_id = leaf_ptr->GetNextPageId();
+      Page *next_page_ptr = nullptr;
+      if (next_page_id != INVALID_PAGE_ID){
+        next_page_ptr = SafelyGetFrame(next_page_id, "Out of memory in GetValues");
+        next_page_ptr->RLatch();
+      }
+      release(page_ptr);
+      page_ptr = next_page_ptr;
+      if (page_ptr != nullptr){
+        leaf_ptr = reinterpret_cast<IN_TREE_LEAF_PAGE_TYPE *>(page_ptr->GetData());
+        if (past_leaf(key)){
+          release(page_ptr);
+          page_ptr = nullptr;
+        }
+      }
+    }
+    if (page_ptr == nullptr){
+      root_id_latch_.RLock();
+      if (IsEmpty()){
+        root_id_latch_.RUnlock();
+        return;
+      }
+      // FindLeafPage releases root_id_latch_ without a transaction
+      page_ptr = FindLeafPage(key, false, 0);
+      leaf_ptr = reinterpret_cast<IN_TREE_LEAF_PAGE_TYPE *>(page_ptr->GetData());
+    }
+
+    ValueType value;
+    if (leaf_ptr->Lookup(key, &value, comparator_)){
+      result->emplace_back(i, value);
+    }
+  }
+
+  if (page_ptr != nullptr){
+    release(page_ptr);
+  }
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "storage/index/b_plus_tree_index.h"
 
 namespace bustub {
@@ -48,6 +50,30 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, T
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys, std::vector<std::pair<size_t, RID>> *result) {
+  // construct the scan index keys, sorted by the index comparator
+  std::vector<size_t> order(keys.size());
+  std::vector<KeyType> index_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    order[i] = i;
+    index_keys[i].SetFromKey(keys[i]);
+  }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return comparator_(index_keys[a], index_keys[b]) < 0; });
+  std::vector<KeyType> sorted_keys;
+  sorted_keys.reserve(keys.size());
+  for (auto idx : order) {
+    sorted_keys.push_back(index_keys[idx]);
+  }
+
+  std::vector<std::pair<size_t, RID>> found;
+  container_.GetValues(sorted_keys, &found);
+  for (const auto &[sorted_idx, rid] : found) {
+    result->emplace_back(order[sorted_idx], rid);
+  }
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.begin(); }
 
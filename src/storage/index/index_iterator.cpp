@@ -35,9 +35,37 @@ INDEXITERATOR_TYPE::IndexIterator(Page* page_ptr, int index, BufferPoolManager*
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator(){
+  ReleaseLeafPage();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : page_id_(other.page_id_), index_(other.index_), page_ptr_(other.page_ptr_), leaf_ptr_(other.leaf_ptr_),
+      buffer_pool_manager_(other.buffer_pool_manager_){
+  other.page_id_ = INVALID_PAGE_ID;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept {
+  // A copy would have left both iterators releasing the same leaf, and the old leaf of this one latched
+  if (this != &other){
+    ReleaseLeafPage();
+    page_id_ = other.page_id_;
+    index_ = other.index_;
+    page_ptr_ = other.page_ptr_;
+    leaf_ptr_ = other.leaf_ptr_;
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    other.page_id_ = INVALID_PAGE_ID;
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::ReleaseLeafPage(){
   if (page_id_ != INVALID_PAGE_ID){
     page_ptr_->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id_, false);
+    page_id_ = INVALID_PAGE_ID;
   }
 }
 
@@ -43,11 +43,13 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
     return false;
   }
 
-  // Try to find a free slot to reuse.
+  // Try to find a free slot to reuse. The transaction that deleted its tuple, or the purge that freed it, may
+  // still hold the lock on it: waiting for them under the page latch could block them, so such a slot is skipped.
   uint32_t i;
   for (i = 0; i < GetTupleCount(); i++) {
-    // If the slot is empty, i.e. its tuple has size 0,
-    if (GetTupleSize(i) == 0) {
+    // If the slot is empty, i.e. its tuple has size 0, and nobody locks it,
+    if (GetTupleSize(i) == 0 &&
+        (lock_manager == nullptr || lock_manager->TryLockExclusive(txn, RID(GetTablePageId(), i)))) {
       // Then we break out of the loop at index i.
       break;
     }
@@ -58,25 +60,20 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
     return false;
   }
 
-  // Otherwise we claim available free space..
-  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
-  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
-
-  // Set the tuple.
-  SetTupleOffsetAtSlot(i, GetFreeSpacePointer());
-  SetTupleSize(i, tuple.size_);
-
+  // Acquire an exclusive lock on a new slot, unless the table lock of txn covers it. Nobody knew the slot, so the
+  // lock is granted right away.
   rid->Set(GetTablePageId(), i);
-  if (i == GetTupleCount()) {
-    SetTupleCount(GetTupleCount() + 1);
+  if (i == GetTupleCount() && lock_manager != nullptr) {
+    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
+    lock_manager->LockExclusive(txn, *rid);
   }
 
+  // Otherwise we claim available free space..
+  [[maybe_unused]] bool inserted = InsertTupleAt(tuple, *rid);
+  BUSTUB_ASSERT(inserted, "The slot was checked to be free, with room for the tuple.");
+
   // Write the log record.
   if (enable_logging) {
-    BUSTUB_ASSERT(!txn->IsSharedLocked(*rid) && !txn->IsExclusiveLocked(*rid), "A new tuple should not be locked.");
-    // Acquire an exclusive lock on the new tuple.
-    bool locked = lock_manager->LockExclusive(txn, *rid);
-    BUSTUB_ASSERT(locked, "Locking a new tuple should always work.");
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::INSERT, *rid, tuple);
     lsn_t lsn = log_manager->AppendLogRecord(&log_record);
     SetLSN(lsn);
@@ -85,6 +82,25 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn, Lock
   return true;
 }
 
+bool TablePage::InsertTupleAt(const Tuple &tuple, const RID &rid) {
+  uint32_t slot_num = rid.GetSlotNum();
+  bool new_slot = slot_num == GetTupleCount();
+  if (slot_num > GetTupleCount() || (!new_slot && GetTupleSize(slot_num) != 0) ||
+      GetFreeSpaceRemaining() < tuple.size_ + (new_slot ? SIZE_TUPLE : 0)) {
+    return false;
+  }
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+
+  // Set the tuple.
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  if (new_slot) {
+    SetTupleCount(GetTupleCount() + 1);
+  }
+  return true;
+}
+
 bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager, LogManager *log_manager) {
   uint32_t slot_num = rid.GetSlotNum();
   // If the slot number is invalid, abort the transaction.
@@ -106,11 +122,12 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_m
 
   if (enable_logging) {
     // Acquire an exclusive lock, upgrading from a shared lock if necessary.
-    if (txn->IsSharedLocked(rid)) {
+    // Nothing to lock if the table lock of txn already covers the tuple.
+    if (lock_manager != nullptr && txn->IsSharedLocked(rid)) {
       if (!lock_manager->LockUpgrade(txn, rid)) {
         return false;
       }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    } else if (lock_manager != nullptr && !txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
       return false;
     }
     Tuple dummy_tuple;
@@ -164,11 +181,12 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple *old_tuple, const RID
 
   if (enable_logging) {
     // Acquire an exclusive lock, upgrading from shared if necessary.
-    if (txn->IsSharedLocked(rid)) {
+    // Nothing to lock if the table lock of txn already covers the tuple.
+    if (lock_manager != nullptr && txn->IsSharedLocked(rid)) {
       if (!lock_manager->LockUpgrade(txn, rid)) {
         return false;
       }
-    } else if (!txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
+    } else if (lock_manager != nullptr && !txn->IsExclusiveLocked(rid) && !lock_manager->LockExclusive(txn, rid)) {
       return false;
     }
     LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, *old_tuple, new_tuple);
@@ -244,6 +262,19 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_ma
   }
 }
 
+bool TablePage::RestoreDeleted(const Tuple &tuple, const RID &rid) {
+  uint32_t slot_num = rid.GetSlotNum();
+  // ApplyDelete frees the slot but keeps it, only the tuple needs room.
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) != 0 || GetFreeSpaceRemaining() < tuple.size_) {
+    return false;
+  }
+  SetFreeSpacePointer(GetFreeSpacePointer() - tuple.size_);
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffsetAtSlot(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, SetDeletedFlag(tuple.size_));
+  return true;
+}
+
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn, LogManager *log_manager) {
   // Log the rollback.
   if (enable_logging) {
@@ -287,7 +318,8 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
 
   // Otherwise we have a valid tuple, try to acquire at least a shared lock.
   if (enable_logging) {
-    if (!txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) && !lock_manager->LockShared(txn, rid)) {
+    if (lock_manager != nullptr && !txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) &&
+        !lock_manager->LockShared(txn, rid)) {
       return false;
     }
   }
@@ -305,10 +337,24 @@ bool TablePage::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockMan
   return true;
 }
 
-bool TablePage::GetFirstTupleRid(RID *first_rid) {
+bool TablePage::GetTupleData(const RID &rid, const char **data, uint32_t *size) {
+  uint32_t slot_num = rid.GetSlotNum();
+  if (slot_num >= GetTupleCount()) {
+    return false;
+  }
+  uint32_t tuple_size = GetTupleSize(slot_num);
+  if (IsDeleted(tuple_size)) {
+    return false;
+  }
+  *data = GetData() + GetTupleOffsetAtSlot(slot_num);
+  *size = tuple_size;
+  return true;
+}
+
+bool TablePage::GetFirstTupleRid(RID *first_rid, const TupleFilter &filter, bool marked_deleted) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (IsOccupied(GetTupleSize(i), marked_deleted) && (!filter || filter(GetData() + GetTupleOffsetAtSlot(i)))) {
       first_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -317,11 +363,12 @@ bool TablePage::GetFirstTupleRid(RID *first_rid) {
   return false;
 }
 
-bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid) {
+bool TablePage::GetNextTupleRid(const RID &cur_rid, RID *next_rid, const TupleFilter &filter,
+                                bool marked_deleted) {
   BUSTUB_ASSERT(cur_rid.GetPageId() == GetTablePageId(), "Wrong table!");
   // Find and return the first valid tuple after our current slot number.
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (IsOccupied(GetTupleSize(i), marked_deleted) && (!filter || filter(GetData() + GetTupleOffsetAtSlot(i)))) {
       next_rid->Set(GetTablePageId(), i);
       return true;
     }
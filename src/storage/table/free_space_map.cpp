@@ -0,0 +1,71 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_space_map.cpp
+//
+// Identification: src/storage/table/free_space_map.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/free_space_map.h"
+
+#include <algorithm>
+
+namespace bustub {
+
+void FreeSpaceMap::AddPage(page_id_t page_id, uint32_t free_bytes) {
+  std::unique_lock lock(latch_);
+  if (entry_index_.count(page_id) != 0) {
+    return;
+  }
+  // No search or update runs while the latch is held exclusively, so the chunk latch is not needed.
+  if (chunks_.empty() || chunks_.back()->entries_.size() == CHUNK_SIZE) {
+    chunks_.push_back(std::make_unique<Chunk>());
+    chunks_.back()->entries_.reserve(CHUNK_SIZE);
+  }
+  auto &chunk = *chunks_.back();
+  entry_index_[page_id] = (chunks_.size() - 1) * CHUNK_SIZE + chunk.entries_.size();
+  chunk.entries_.emplace_back(page_id, free_bytes);
+  chunk.max_free_.store(std::max(chunk.max_free_.load(std::memory_order_relaxed), free_bytes),
+                        std::memory_order_relaxed);
+}
+
+void FreeSpaceMap::UpdatePage(page_id_t page_id, uint32_t free_bytes) {
+  std::shared_lock lock(latch_);
+  auto it = entry_index_.find(page_id);
+  if (it == entry_index_.end()) {
+    return;
+  }
+  auto &chunk = *chunks_[it->second / CHUNK_SIZE];
+  std::scoped_lock chunk_lock(chunk.latch_);
+  chunk.entries_[it->second % CHUNK_SIZE].second = free_bytes;
+  if (free_bytes > chunk.max_free_.load(std::memory_order_relaxed)) {
+    chunk.max_free_.store(free_bytes, std::memory_order_relaxed);
+  }
+}
+
+page_id_t FreeSpaceMap::FindPage(uint32_t needed) {
+  std::shared_lock lock(latch_);
+  for (auto &chunk : chunks_) {
+    // The bound is only raised under the chunk latch, a stale read at worst sends this insert to a later page.
+    if (chunk->max_free_.load(std::memory_order_relaxed) < needed) {
+      continue;
+    }
+    std::scoped_lock chunk_lock(chunk->latch_);
+    uint32_t max_free = 0;
+    for (const auto &[page_id, free_bytes] : chunk->entries_) {
+      if (free_bytes >= needed) {
+        return page_id;
+      }
+      max_free = std::max(max_free, free_bytes);
+    }
+    // Nothing fits here, tighten the bound so later searches skip this chunk.
+    chunk->max_free_.store(max_free, std::memory_order_relaxed);
+  }
+  return INVALID_PAGE_ID;
+}
+
+}  // namespace bustub
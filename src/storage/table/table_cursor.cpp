@@ -0,0 +1,80 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_cursor.cpp
+//
+// Identification: src/storage/table/table_cursor.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/table_cursor.h"
+
+#include <utility>
+
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+TableCursor::TableCursor(TableHeap *table_heap, page_id_t first_page_id, page_id_t stop_page_id, TupleFilter filter,
+                         bool marked_deleted)
+    : table_heap_(table_heap),
+      stop_page_id_(stop_page_id),
+      filter_(std::move(filter)),
+      marked_deleted_(marked_deleted) {
+  if (first_page_id != INVALID_PAGE_ID && first_page_id != stop_page_id_) {
+    page_guard_ = table_heap_->buffer_pool_manager_->FetchPageBasic(first_page_id);
+    BUSTUB_ASSERT(page_guard_.IsValid(), "Couldn't fetch a page of the table heap.");
+  }
+}
+
+bool TableCursor::Advance() {
+  while (page_guard_.IsValid()) {
+    RID next_rid;
+    auto page = GetPage();
+    page->RLatch();
+    bool found = rid_.GetPageId() == INVALID_PAGE_ID
+                     ? page->GetFirstTupleRid(&next_rid, filter_, marked_deleted_)
+                     : page->GetNextTupleRid(rid_, &next_rid, filter_, marked_deleted_);
+    auto next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    if (found) {
+      rid_ = next_rid;
+      return true;
+    }
+    // This page is done, move the pin to the next one.
+    page_guard_.Drop();
+    rid_ = RID();
+    if (next_page_id != INVALID_PAGE_ID && next_page_id != stop_page_id_) {
+      page_guard_ = table_heap_->buffer_pool_manager_->FetchPageBasic(next_page_id);
+      BUSTUB_ASSERT(page_guard_.IsValid(), "Couldn't fetch a page of the table heap.");
+    }
+  }
+  return false;
+}
+
+void TableCursor::Repin() {
+  page_guard_ = table_heap_->buffer_pool_manager_->FetchPageBasic(rid_.GetPageId());
+  BUSTUB_ASSERT(page_guard_.IsValid(), "Couldn't fetch a page of the table heap.");
+}
+
+bool TableCursor::GetTuple(Tuple *tuple, Transaction *txn) {
+  auto page = GetPage();
+  page->RLatch();
+  bool res;
+  try {
+    res = txn->IsSnapshot()
+              ? table_heap_->VisitSnapshot(page, rid_, txn, [tuple](const TupleView &view) { *tuple = Tuple(view); })
+              : page->GetTuple(rid_, tuple, txn, table_heap_->RowLockManager(txn, LockMode::SHARED));
+  } catch (TransactionAbortException &e) {
+    // A snapshot whose versions were not kept aborts
+    page->RUnlatch();
+    throw;
+  }
+  page->RUnlatch();
+  return res;
+}
+
+}  // namespace bustub
@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
@@ -26,14 +28,41 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
                      Transaction *txn)
-    : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
+    : buffer_pool_manager_(buffer_pool_manager),
+      lock_manager_(lock_manager),
+      log_manager_(log_manager) {
   // Initialize the first table page.
-  auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
-  BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
-  first_page->WLatch();
+  auto first_guard = buffer_pool_manager_->NewPageGuarded(&first_page_id_);
+  BUSTUB_ASSERT(first_guard.IsValid(), "Couldn't create a page for the table heap.");
+  auto first_page = first_guard.As<TablePage>();
   first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
-  first_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(first_page_id_, true);
+  auto free_bytes = first_page->GetFreeSpaceRemaining();
+  first_guard.MarkDirty();
+  first_guard.Drop();
+  // A new table has nothing to load, register its only page.
+  std::call_once(free_space_map_loaded_, [&] {
+    free_space_map_.AddPage(first_page_id_, free_bytes);
+    last_page_id_ = first_page_id_;
+  });
+}
+
+void TableHeap::LoadFreeSpaceMap() {
+  // The free space map is not persisted, the catalog only knows the first page. Rebuild it on the first insert
+  // rather than on open, since an opened table may not be recovered yet.
+  // A page that cannot be fetched ends the map, an insert reaching it from the tail aborts there.
+  auto page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto guard = buffer_pool_manager_->FetchPageRead(page_id);
+    if (!guard.IsValid()) {
+      break;
+    }
+    auto free_bytes = guard.As<TablePage>()->GetFreeSpaceRemaining();
+    auto next_page_id = guard.As<TablePage>()->GetNextPageId();
+    guard.Drop();
+    free_space_map_.AddPage(page_id, free_bytes);
+    last_page_id_ = page_id;
+    page_id = next_page_id;
+  }
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
@@ -41,71 +70,111 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  std::call_once(free_space_map_loaded_, &TableHeap::LoadFreeSpaceMap, this);
 
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
-  if (cur_page == nullptr) {
-    txn->SetState(TransactionState::ABORTED);
-    return false;
+  // Insert into a page the free space map says has enough space. The map is only a hint, so a failed try records
+  // the real free space of that page and asks again.
+  // INVARIANT: cur_guard holds the page with the tuple if it is valid when you leave the loop.
+  auto needed = TablePage::SpaceNeeded(tuple.size_);
+  WritePageGuard cur_guard;
+  for (auto page_id = free_space_map_.FindPage(needed); page_id != INVALID_PAGE_ID;
+       page_id = free_space_map_.FindPage(needed)) {
+    auto guard = buffer_pool_manager_->FetchPageWrite(page_id);
+    if (!guard.IsValid()) {
+      break;
+    }
+    auto page = guard.As<TablePage>();
+    if (page->InsertTuple(tuple, rid, txn, RowLockManager(txn, LockMode::EXCLUSIVE), log_manager_)) {
+      cur_guard = std::move(guard);
+      break;
+    }
+    auto free_bytes = page->GetFreeSpaceRemaining();
+    guard.Drop();
+    free_space_map_.UpdatePage(page_id, free_bytes);
   }
 
-  cur_page->WLatch();
-  // Insert into the first page with enough space. If no such page exists, create a new page and insert into that.
-  // INVARIANT: cur_page is WLatched if you leave the loop normally.
-  while (!cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_)) {
-    auto next_page_id = cur_page->GetNextPageId();
-    // If the next page is a valid page,
-    if (next_page_id != INVALID_PAGE_ID) {
-      // Unlatch and unpin the current page.
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-      // And repeat the process with the next page.
-      cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
-      cur_page->WLatch();
-    } else {
-      // Otherwise we have run out of valid pages. We need to create a new page.
-      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
-      // If we could not create a new page,
-      if (new_page == nullptr) {
-        // Then life sucks and we abort the transaction.
-        cur_page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), false);
-        txn->SetState(TransactionState::ABORTED);
-        return false;
-      }
-      // Otherwise we were able to create a new page. We initialize it now.
-      new_page->WLatch();
-      cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
-      cur_page = new_page;
+  // If no such page exists, insert at the tail of the table.
+  bool appended_page = false;
+  if (!cur_guard.IsValid()) {
+    cur_guard = InsertAtTail(tuple, rid, txn, &appended_page);
+    if (!cur_guard.IsValid()) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
     }
   }
-  /** Dyy: modify here! */
-  lock_manager_->LockExclusive(txn, *rid);
-  // This line has caused most of us to double-take and "whoa double unlatch".
-  // We are not, in fact, double unlatching. See the invariant above.
-  cur_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+  // Still under the page latch, so no snapshot reader sees the new tuple without its chain
+  versions_.RecordWrite(txn, *rid, false, Tuple{});
+  auto page_id = cur_guard.PageId();
+  auto free_bytes = cur_guard.As<TablePage>()->GetFreeSpaceRemaining();
+  cur_guard.MarkDirty();
+  cur_guard.Drop();
+  if (appended_page) {
+    free_space_map_.AddPage(page_id, free_bytes);
+  } else {
+    free_space_map_.UpdatePage(page_id, free_bytes);
+  }
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(*rid, WType::INSERT, Tuple{}, this);
   return true;
 }
 
+WritePageGuard TableHeap::InsertAtTail(const Tuple &tuple, RID *rid, Transaction *txn, bool *appended_page) {
+  auto cur_guard = buffer_pool_manager_->FetchPageWrite(last_page_id_);
+  // Insert into the tail page. If it is full, create a new page and insert into that.
+  // INVARIANT: cur_guard is valid if you leave the loop normally.
+  auto row_lock_manager = RowLockManager(txn, LockMode::EXCLUSIVE);
+  while (cur_guard.IsValid() &&
+         !cur_guard.As<TablePage>()->InsertTuple(tuple, rid, txn, row_lock_manager, log_manager_)) {
+    auto cur_page = cur_guard.As<TablePage>();
+    auto next_page_id = cur_page->GetNextPageId();
+    // If another insert appended a page since we read the tail, repeat the process with that page.
+    if (next_page_id != INVALID_PAGE_ID) {
+      cur_guard = buffer_pool_manager_->FetchPageWrite(next_page_id);
+      continue;
+    }
+    // Otherwise we have run out of valid pages. We need to create a new page.
+    auto new_guard = buffer_pool_manager_->NewPageGuarded(&next_page_id);
+    // If we could not create a new page, then life sucks and the caller aborts the transaction.
+    if (!new_guard.IsValid()) {
+      return new_guard;
+    }
+    // Otherwise we were able to create a new page. We initialize it now.
+    cur_page->SetNextPageId(next_page_id);
+    new_guard.As<TablePage>()->Init(next_page_id, PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
+    cur_guard.MarkDirty();
+    cur_guard = std::move(new_guard);
+    last_page_id_ = next_page_id;
+    *appended_page = true;
+  }
+  return cur_guard;
+}
+
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   // TODO(Amadou): remove empty page
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
   // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
+  if (!guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  auto page = guard.As<TablePage>();
+  if (!versions_.CanWrite(txn, rid)) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::WRITE_CONFLICT);
+  }
+  const char *data;
+  uint32_t size;
+  Tuple old_tuple;
+  if (page->GetTupleData(rid, &data, &size)) {
+    old_tuple = Tuple(TupleView(data, size, rid));
+  }
   // Otherwise, mark the tuple as deleted.
-  page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  if (page->MarkDelete(rid, txn, RowLockManager(txn, LockMode::EXCLUSIVE), log_manager_)) {
+    versions_.RecordWrite(txn, rid, true, old_tuple);
+  }
+  guard.MarkDirty();
+  guard.Drop();
   // Update the transaction's write set.
   txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
   return true;
@@ -113,18 +182,30 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
   // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
+  if (!guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
-  page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
+  auto page = guard.As<TablePage>();
+  if (!versions_.CanWrite(txn, rid)) {
+    txn->SetState(TransactionState::ABORTED);
+    throw TransactionAbortException(txn->GetTransactionId(), AbortReason::WRITE_CONFLICT);
+  }
+  bool is_updated =
+      page->UpdateTuple(tuple, &old_tuple, rid, txn, RowLockManager(txn, LockMode::EXCLUSIVE), log_manager_);
+  auto free_bytes = page->GetFreeSpaceRemaining();
+  if (is_updated) {
+    versions_.RecordWrite(txn, rid, true, old_tuple);
+    guard.MarkDirty();
+  }
+  guard.Drop();
+  if (is_updated) {
+    free_space_map_.UpdatePage(rid.GetPageId(), free_bytes);
+  }
   // Update the transaction's write set.
   if (is_updated && txn->GetState() != TransactionState::ABORTED) {
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
@@ -132,63 +213,203 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   return is_updated;
 }
 
+void TableHeap::Purge(const std::vector<RID> &rids, Transaction *txn) {
+  for (auto const &rid : rids) {
+    // A reader still holding a lock on the deleted tuple may look at it, leave it to a later pass
+    if (lock_manager_ != nullptr && !lock_manager_->TryLockExclusive(txn, rid)) {
+      versions_.DeferPurge(rid);
+      continue;
+    }
+    auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+    BUSTUB_ASSERT(guard.IsValid(), "Couldn't find a page containing that RID.");
+    auto page = guard.As<TablePage>();
+    page->ApplyDelete(rid, txn, log_manager_);
+    auto free_bytes = page->GetFreeSpaceRemaining();
+    guard.MarkDirty();
+    guard.Drop();
+    free_space_map_.UpdatePage(rid.GetPageId(), free_bytes);
+  }
+}
+
 void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+  BUSTUB_ASSERT(guard.IsValid(), "Couldn't find a page containing that RID.");
   // Delete the tuple from the page.
-  page->WLatch();
+  auto page = guard.As<TablePage>();
   page->ApplyDelete(rid, txn, log_manager_);
   lock_manager_->Unlock(txn, rid);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  auto free_bytes = page->GetFreeSpaceRemaining();
+  guard.MarkDirty();
+  guard.Drop();
+  // The freed space can take new inserts.
+  free_space_map_.UpdatePage(rid.GetPageId(), free_bytes);
 }
 
 void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
-  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  auto guard = buffer_pool_manager_->FetchPageWrite(rid.GetPageId());
+  BUSTUB_ASSERT(guard.IsValid(), "Couldn't find a page containing that RID.");
   // Rollback the delete.
-  page->WLatch();
-  page->RollbackDelete(rid, txn, log_manager_);
-  page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+  guard.As<TablePage>()->RollbackDelete(rid, txn, log_manager_);
+  guard.MarkDirty();
 }
 
 bool TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn) {
   // Find the page which contains the tuple.
-  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  auto guard = buffer_pool_manager_->FetchPageRead(rid.GetPageId());
   // If the page could not be found, then abort the transaction.
-  if (page == nullptr) {
+  if (!guard.IsValid()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  if (txn->IsSnapshot()) {
+    return VisitSnapshot(guard.As<TablePage>(), rid, txn, [tuple](const TupleView &view) { *tuple = Tuple(view); });
+  }
   // Read the tuple from the page.
-  page->RLatch();
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
-  page->RUnlatch();
-  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
-  return res;
+  return guard.As<TablePage>()->GetTuple(rid, tuple, txn, RowLockManager(txn, LockMode::SHARED));
+}
+
+LockManager *TableHeap::RowLockManager(Transaction *txn, LockMode mode) {
+  LockMode table_mode;
+  if (has_oid_ && txn->IsTableLocked(oid_, &table_mode) && LockManager::Covers(table_mode, mode)) {
+    return nullptr;
+  }
+  return lock_manager_;
+}
+
+bool TableHeap::LockRowShared(Transaction *txn, const RID &rid) {
+  return has_oid_ ? lock_manager_->LockRowShared(txn, oid_, rid) : lock_manager_->LockShared(txn, rid);
+}
+
+bool TableHeap::VisitSnapshot(TablePage *page, const RID &rid, Transaction *txn,
+                              const std::function<void(const TupleView &)> &visitor) {
+  Tuple older;
+  switch (versions_.Resolve(txn, rid, &older)) {
+    case VersionStore::Visibility::NEWEST: {
+      // A tuple marked deleted is gone for this snapshot too
+      const char *data;
+      uint32_t size;
+      if (!page->GetTupleData(rid, &data, &size)) {
+        return false;
+      }
+      visitor(TupleView(data, size, rid));
+      return true;
+    }
+    case VersionStore::Visibility::OLDER:
+      visitor(TupleView(older.GetData(), older.GetLength(), rid));
+      return true;
+    case VersionStore::Visibility::NONE:
+      break;
+  }
+  return false;
+}
+
+bool TableHeap::VisitTuple(const RID &rid, Transaction *txn, const std::function<void(const TupleView &)> &visitor) {
+  // Acquire the lock first, the visitor runs under the page latch. Mirrors TablePage::GetTuple.
+  // Snapshot reads take no lock.
+  if (enable_logging && !txn->IsSnapshot() && !txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid)) {
+    if (RowLockManager(txn, LockMode::SHARED) != nullptr && !LockRowShared(txn, rid)) {
+      return false;
+    }
+  }
+  auto guard = buffer_pool_manager_->FetchPageRead(rid.GetPageId());
+  // If the page could not be found, then abort the transaction.
+  if (!guard.IsValid()) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  if (txn->IsSnapshot()) {
+    return VisitSnapshot(guard.As<TablePage>(), rid, txn, visitor);
+  }
+  const char *data;
+  uint32_t size;
+  if (!guard.As<TablePage>()->GetTupleData(rid, &data, &size)) {
+    return false;
+  }
+  visitor(TupleView(data, size, rid));
+  return true;
 }
 
-TableIterator TableHeap::Begin(Transaction *txn) {
-  // Start an iterator from the first page.
+void TableHeap::VisitTuples(const std::vector<RID> &rids, Transaction *txn,
+                            const std::function<void(size_t idx, const TupleView &)> &visitor) {
+  std::vector<size_t> order(rids.size());
+  for (size_t i = 0; i < rids.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rids[a].Get() < rids[b].Get(); });
+
+  BasicPageGuard guard;
+  for (auto idx : order) {
+    const RID &rid = rids[idx];
+    if (enable_logging && !txn->IsSnapshot() && !txn->IsSharedLocked(rid) && !txn->IsExclusiveLocked(rid) &&
+        RowLockManager(txn, LockMode::SHARED) != nullptr) {
+      // The lock may wait for a long time, do not keep a frame of the buffer pool pinned meanwhile
+      guard.Drop();
+      if (!LockRowShared(txn, rid)) {
+        continue;
+      }
+    }
+    // The latch is taken per tuple once its lock is held, the page stays pinned for the next tuples
+    if (!guard.IsValid() || guard.PageId() != rid.GetPageId()) {
+      guard = buffer_pool_manager_->FetchPageBasic(rid.GetPageId());
+      // If the page could not be found, then abort the transaction.
+      if (!guard.IsValid()) {
+        txn->SetState(TransactionState::ABORTED);
+        return;
+      }
+    }
+    const char *data;
+    uint32_t size;
+    guard.GetPage()->RLatch();
+    if (txn->IsSnapshot()) {
+      VisitSnapshot(guard.As<TablePage>(), rid, txn, [&](const TupleView &view) { visitor(idx, view); });
+    } else if (guard.As<TablePage>()->GetTupleData(rid, &data, &size)) {
+      visitor(idx, TupleView(data, size, rid));
+    }
+    guard.GetPage()->RUnlatch();
+  }
+}
+
+TableIterator TableHeap::Begin(Transaction *txn) { return Begin(txn, first_page_id_, INVALID_PAGE_ID); }
+
+TableIterator TableHeap::Begin(Transaction *txn, page_id_t first_page_id, page_id_t stop_page_id,
+                               const TupleFilter &filter) {
+  // Start an iterator from the first page of the range.
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
   RID rid;
-  auto page_id = first_page_id_;
-  while (page_id != INVALID_PAGE_ID) {
-    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
-    page->RLatch();
+  auto page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID && page_id != stop_page_id) {
+    auto guard = buffer_pool_manager_->FetchPageRead(page_id);
+    // If the page could not be found, then abort the transaction.
+    if (!guard.IsValid()) {
+      txn->SetState(TransactionState::ABORTED);
+      return End();
+    }
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
-    page->RUnlatch();
-    buffer_pool_manager_->UnpinPage(page_id, false);
-    if (found_tuple) {
+    if (guard.As<TablePage>()->GetFirstTupleRid(&rid, filter)) {
       break;
     }
-    page_id = page->GetNextPageId();
+    page_id = guard.As<TablePage>()->GetNextPageId();
   }
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn, stop_page_id, filter);
+}
+
+bool TableHeap::GetPageIds(Transaction *txn, std::vector<page_id_t> *page_ids) {
+  page_ids->clear();
+  auto page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto guard = buffer_pool_manager_->FetchPageRead(page_id);
+    // If the page could not be found, then abort the transaction.
+    if (!guard.IsValid()) {
+      txn->SetState(TransactionState::ABORTED);
+      page_ids->clear();
+      return false;
+    }
+    page_ids->push_back(page_id);
+    page_id = guard.As<TablePage>()->GetNextPageId();
+  }
+  return true;
 }
 
 TableIterator TableHeap::End() { return TableIterator(this, RID(INVALID_PAGE_ID, 0), nullptr); }
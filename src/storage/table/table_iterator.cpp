@@ -16,8 +16,13 @@
 
 namespace bustub {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, page_id_t stop_page_id,
+                             TupleFilter filter)
+    : table_heap_(table_heap),
+      tuple_(new Tuple(rid)),
+      txn_(txn),
+      stop_page_id_(stop_page_id),
+      filter_(std::move(filter)) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
   }
@@ -35,32 +40,28 @@ Tuple *TableIterator::operator->() {
 
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  auto cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId());
+  assert(cur_guard.IsValid());  // all pages are pinned
 
   RID next_tuple_rid;
-  if (!cur_page->GetNextTupleRid(tuple_->rid_,
-                                 &next_tuple_rid)) {  // end of this page
-    while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
-      if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
+  if (!cur_guard.As<TablePage>()->GetNextTupleRid(tuple_->rid_, &next_tuple_rid, filter_)) {  // end of this page
+    auto next_page_id = cur_guard.As<TablePage>()->GetNextPageId();
+    while (next_page_id != INVALID_PAGE_ID && next_page_id != stop_page_id_) {
+      cur_guard = buffer_pool_manager->FetchPageRead(next_page_id);
+      if (cur_guard.As<TablePage>()->GetFirstTupleRid(&next_tuple_rid, filter_)) {
         break;
       }
+      next_page_id = cur_guard.As<TablePage>()->GetNextPageId();
     }
   }
   tuple_->rid_ = next_tuple_rid;
 
+  // The next tuple is in the page we already hold, copy it from there rather than fetching it again.
+  // The guard releases the page only once the tuple is copied.
   if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    cur_guard.As<TablePage>()->GetTuple(tuple_->rid_, tuple_, txn_,
+                                        table_heap_->RowLockManager(txn_, LockMode::SHARED));
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
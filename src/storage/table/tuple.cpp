@@ -53,6 +53,19 @@ Tuple::Tuple(std::vector<Value> values, const Schema *schema) : allocated_(true)
   }
 }
 
+Tuple::Tuple(const TupleView &view) : allocated_(true), rid_(view.GetRid()), size_(view.GetLength()) {
+  data_ = new char[size_];
+  memcpy(data_, view.GetData(), size_);
+}
+
+Tuple Tuple::Borrow(const TupleView &view) {
+  Tuple tuple(view.GetRid());
+  tuple.size_ = view.GetLength();
+  // Never written through: a borrowed tuple is only read, and never freed since it is not allocated
+  tuple.data_ = const_cast<char *>(view.GetData());
+  return tuple;
+}
+
 Tuple::Tuple(const Tuple &other) : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_) {
   if (allocated_) {
     delete[] data_;
@@ -87,13 +100,33 @@ Tuple &Tuple::operator=(const Tuple &other) {
   return *this;
 }
 
+Tuple::Tuple(Tuple &&other) noexcept
+    : allocated_(other.allocated_), rid_(other.rid_), size_(other.size_), data_(other.data_) {
+  other.allocated_ = false;
+  other.size_ = 0;
+  other.data_ = nullptr;
+}
+
+Tuple &Tuple::operator=(Tuple &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  if (allocated_) {
+    delete[] data_;
+  }
+  allocated_ = other.allocated_;
+  rid_ = other.rid_;
+  size_ = other.size_;
+  data_ = other.data_;
+  other.allocated_ = false;
+  other.size_ = 0;
+  other.data_ = nullptr;
+  return *this;
+}
+
 Value Tuple::GetValue(const Schema *schema, const uint32_t column_idx) const {
-  assert(schema);
   assert(data_);
-  const TypeId column_type = schema->GetColumn(column_idx).GetType();
-  const char *data_ptr = GetDataPtr(schema, column_idx);
-  // the third parameter "is_inlined" is unused
-  return Value::DeserializeFrom(data_ptr, column_type);
+  return GetView().GetValue(schema, column_idx);
 }
 
 Tuple Tuple::KeyFromTuple(const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs) {
@@ -106,18 +139,7 @@ Tuple Tuple::KeyFromTuple(const Schema &schema, const Schema &key_schema, const
 }
 
 const char *Tuple::GetDataPtr(const Schema *schema, const uint32_t column_idx) const {
-  assert(schema);
-  assert(data_);
-  const auto &col = schema->GetColumn(column_idx);
-  bool is_inlined = col.IsInlined();
-  // For inline type, data is stored where it is.
-  if (is_inlined) {
-    return (data_ + col.GetOffset());
-  }
-  // We read the relative offset from the tuple data.
-  int32_t offset = *reinterpret_cast<int32_t *>(data_ + col.GetOffset());
-  // And return the beginning address of the real data for the VARCHAR type.
-  return (data_ + offset);
+  return TupleView::GetColumnPtr(data_, schema, column_idx);
 }
 
 std::string Tuple::ToString(const Schema *schema) const {
@@ -11,10 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager.h"
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <future>  // NOLINT
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "gtest/gtest.h"
+#include "recovery/log_manager.h"
 
 namespace bustub {
 
@@ -141,4 +147,139 @@ TEST(BufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, PageGuardTest) {
+  const size_t buffer_pool_size = 5;
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManager(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  Page *page0;
+  {
+    // Scenario: A new page stays pinned and write latched as long as its guard lives.
+    auto guard = bpm->NewPageGuarded(&page_id_temp);
+    ASSERT_TRUE(guard.IsValid());
+    EXPECT_EQ(0, guard.PageId());
+    page0 = guard.As<Page>();
+    EXPECT_EQ(1, page0->GetPinCount());
+    snprintf(page0->GetData(), PAGE_SIZE, "Hello");
+    guard.MarkDirty();
+
+    // Scenario: Moving a guard hands the pin over without touching the pool.
+    WritePageGuard moved = std::move(guard);
+    EXPECT_FALSE(guard.IsValid());  // NOLINT
+    EXPECT_TRUE(moved.IsValid());
+    EXPECT_EQ(1, page0->GetPinCount());
+  }
+  // Scenario: Dropping the last guard unpins the page.
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  {
+    // Scenario: Read guards share the page, each holding its own pin.
+    auto guard1 = bpm->FetchPageRead(0);
+    auto guard2 = bpm->FetchPageRead(0);
+    EXPECT_EQ(2, page0->GetPinCount());
+    EXPECT_EQ(0, strcmp(guard1.As<Page>()->GetData(), "Hello"));
+    guard1.Drop();
+    EXPECT_FALSE(guard1.IsValid());
+    EXPECT_EQ(1, page0->GetPinCount());
+    // Scenario: Assigning over a guard releases what it held.
+    guard2 = ReadPageGuard();
+    EXPECT_EQ(0, page0->GetPinCount());
+  }
+
+  // Scenario: Once every frame is pinned by a guard, fetching yields an empty guard.
+  std::vector<BasicPageGuard> guards;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto guard = bpm->NewPageGuarded(&page_id_temp);
+    ASSERT_TRUE(guard.IsValid());
+    guard.Drop();
+    guards.push_back(bpm->FetchPageBasic(page_id_temp));
+  }
+  EXPECT_FALSE(bpm->FetchPageRead(0).IsValid());
+
+  // Scenario: Once the guards are gone, the page we wrote can be read back from disk.
+  guards.clear();
+  {
+    auto guard = bpm->FetchPageRead(0);
+    ASSERT_TRUE(guard.IsValid());
+    EXPECT_EQ(0, strcmp(guard.As<Page>()->GetData(), "Hello"));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerTest, EvictionFlushesLogOutsideLatchTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManager(2, disk_manager, log_manager);
+  log_manager->RunFlushThread();
+
+  // The log writes wait until the promise is set
+  std::promise<void> promise;
+  std::future<void> future = promise.get_future();
+  disk_manager->SetFlushLogFuture(&future);
+
+  // page0 carries an lsn that is not on disk yet, page1 stays in the pool
+  page_id_t page_id0;
+  page_id_t page_id1;
+  Page *page0 = bpm->NewPage(&page_id0);
+  ASSERT_NE(nullptr, page0);
+  LogRecord log_record(0, INVALID_LSN, LogRecordType::BEGIN);
+  page0->SetLSN(log_manager->AppendLogRecord(&log_record));
+  snprintf(page0->GetData() + 8, PAGE_SIZE - 8, "Hello");
+  bpm->UnpinPage(page_id0, true);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id1));
+  bpm->UnpinPage(page_id1, false);
+  ASSERT_NE(nullptr, bpm->FetchPage(page_id1));
+
+  // Evicting page0 waits for the log flush, without holding up the fetches of the pages in the pool
+  std::atomic<bool> evicted{false};
+  std::thread evictor([&] {
+    page_id_t page_id2;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id2));
+    evicted = true;
+    bpm->UnpinPage(page_id2, false);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  std::atomic<bool> fetched{false};
+  std::thread fetcher([&] {
+    EXPECT_NE(nullptr, bpm->FetchPage(page_id1));
+    fetched = true;
+    bpm->UnpinPage(page_id1, false);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(fetched);
+  EXPECT_FALSE(evicted);
+  promise.set_value();
+  evictor.join();
+  fetcher.join();
+  EXPECT_TRUE(evicted);
+  EXPECT_GE(log_manager->GetPersistentLSN(), page0->GetLSN());
+
+  // page0 was written back before its frame was reused
+  bpm->UnpinPage(page_id1, false);
+  page0 = bpm->FetchPage(page_id0);
+  ASSERT_NE(nullptr, page0);
+  EXPECT_EQ(0, strcmp(page0->GetData() + 8, "Hello"));
+  bpm->UnpinPage(page_id0, false);
+
+  log_manager->StopFlushThread();
+  disk_manager->SetFlushLogFuture(nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
 }  // namespace bustub
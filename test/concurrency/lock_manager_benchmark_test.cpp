@@ -0,0 +1,112 @@
+/**
+ * lock_manager_benchmark_test.cpp
+ */
+
+#include <chrono>  // NOLINT
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/config.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+/*
+ * Lock/unlock throughput with many threads. The numbers are printed for comparison across changes,
+ * only the outcome of every transaction is checked.
+ */
+
+static constexpr int NUM_THREADS = 8;
+static constexpr int NUM_TXNS_PER_THREAD = 200;
+static constexpr int NUM_LOCKS_PER_TXN = 50;
+
+/**
+ * Run NUM_TXNS_PER_THREAD transactions on each of NUM_THREADS threads, each transaction taking
+ * NUM_LOCKS_PER_TXN locks and then committing, and print the lock throughput.
+ * @param name the name of the workload
+ * @param lock the function locking the idx'th row of a transaction of a thread
+ */
+void RunThroughput(const std::string &name,
+                   const std::function<bool(LockManager *, Transaction *, int thread, int idx)> &lock) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  auto task = [&](int thread) {
+    for (int i = 0; i < NUM_TXNS_PER_THREAD; i++) {
+      Transaction *txn = txn_mgr.Begin();
+      for (int idx = 0; idx < NUM_LOCKS_PER_TXN; idx++) {
+        EXPECT_TRUE(lock(&lock_mgr, txn, thread, idx));
+      }
+      txn_mgr.Commit(txn);
+      EXPECT_EQ(txn->GetState(), TransactionState::COMMITTED);
+      delete txn;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(NUM_THREADS);
+  for (int i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(task, i);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double num_locks = static_cast<double>(NUM_THREADS) * NUM_TXNS_PER_THREAD * NUM_LOCKS_PER_TXN;
+  std::cout << name << ": " << static_cast<int64_t>(num_locks / elapsed.count()) << " lock/unlock pairs per second"
+            << std::endl;
+}
+
+// Every thread locks its own rows exclusively: throughput is limited by the lock table latches only
+TEST(LockManagerBenchmarkTest, DisjointExclusiveTest) {
+  RunThroughput("disjoint exclusive", [](LockManager *lock_mgr, Transaction *txn, int thread, int idx) {
+    return lock_mgr->LockExclusive(txn, RID{thread, static_cast<uint32_t>(idx)});
+  });
+}
+
+// Every thread share-locks the same rows: the requests queue up on the same few RIDs
+TEST(LockManagerBenchmarkTest, HotSharedTest) {
+  RunThroughput("hot shared", [](LockManager *lock_mgr, Transaction *txn, int thread, int idx) {
+    return lock_mgr->LockShared(txn, RID{0, static_cast<uint32_t>(idx)});
+  });
+}
+
+// Transactions begin and commit without any lock: throughput is limited by the transaction manager only
+TEST(LockManagerBenchmarkTest, BeginCommitTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  static constexpr int NUM_BEGINS_PER_THREAD = 20000;
+
+  auto task = [&]() {
+    for (int i = 0; i < NUM_BEGINS_PER_THREAD; i++) {
+      Transaction *txn = txn_mgr.Begin();
+      txn_mgr.Commit(txn);
+      EXPECT_EQ(txn->GetState(), TransactionState::COMMITTED);
+      delete txn;
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(NUM_THREADS);
+  for (int i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(task);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  double num_txns = static_cast<double>(NUM_THREADS) * NUM_BEGINS_PER_THREAD;
+  std::cout << "begin commit: " << static_cast<int64_t>(num_txns / elapsed.count()) << " transactions per second"
+            << std::endl;
+}
+
+}  // namespace bustub
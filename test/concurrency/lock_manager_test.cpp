@@ -2,6 +2,7 @@
  * lock_manager_test.cpp
  */
 
+#include <atomic>
 #include <random>
 #include <thread>  // NOLINT
 
@@ -153,6 +154,99 @@ void UpgradeTest() {
 }
 TEST(LockManagerTest, UpgradeLockTest) { UpgradeTest(); }
 
+// Lock queues are dropped once nobody holds or waits for their RID, and requests are recycled
+TEST(LockManagerTest, QueueCleanupTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  for (int round = 0; round < 3; round++) {
+    Transaction *txn0 = txn_mgr.Begin();
+    Transaction *txn1 = txn_mgr.Begin();
+    for (int i = 0; i < 100; i++) {
+      RID rid{round, static_cast<uint32_t>(i)};
+      EXPECT_TRUE(lock_mgr.LockShared(txn0, rid));
+      EXPECT_TRUE(lock_mgr.LockShared(txn1, rid));
+    }
+    EXPECT_EQ(lock_mgr.GetQueueCount(), 100);
+
+    // The queue stays while txn1 still shares the rid, then goes with the last lock
+    txn_mgr.Commit(txn0);
+    EXPECT_EQ(lock_mgr.GetQueueCount(), 100);
+    EXPECT_TRUE(lock_mgr.LockUpgrade(txn1, RID{round, 0}));
+    CheckTxnLockSize(txn1, 99, 1);
+    txn_mgr.Commit(txn1);
+    EXPECT_EQ(lock_mgr.GetQueueCount(), 0);
+    CheckTxnLockSize(txn1, 0, 0);
+    EXPECT_EQ(txn1->GetLockRequest(RID{round, 0}), nullptr);
+    delete txn0;
+    delete txn1;
+  }
+}
+
+// Intention locks on tables, their upgrades, and escalation of many row locks to one table lock
+TEST(LockManagerTest, HierarchicalLockTest) {
+  EXPECT_TRUE(LockManager::AreCompatible(LockMode::INTENTION_SHARED, LockMode::SHARED_INTENTION_EXCLUSIVE));
+  EXPECT_TRUE(LockManager::AreCompatible(LockMode::INTENTION_EXCLUSIVE, LockMode::INTENTION_EXCLUSIVE));
+  EXPECT_FALSE(LockManager::AreCompatible(LockMode::INTENTION_EXCLUSIVE, LockMode::SHARED));
+  EXPECT_FALSE(LockManager::AreCompatible(LockMode::SHARED_INTENTION_EXCLUSIVE, LockMode::SHARED_INTENTION_EXCLUSIVE));
+  EXPECT_FALSE(LockManager::AreCompatible(LockMode::INTENTION_SHARED, LockMode::EXCLUSIVE));
+
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  LockMode mode;
+
+  // Row locks of different rows in one table, under IS and IX
+  Transaction *txn0 = txn_mgr.Begin();
+  Transaction *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockRowShared(txn0, 0, RID{0, 0}));
+  EXPECT_TRUE(lock_mgr.LockRowExclusive(txn1, 0, RID{0, 1}));
+  EXPECT_TRUE(txn0->IsTableLocked(0, &mode));
+  EXPECT_EQ(mode, LockMode::INTENTION_SHARED);
+  EXPECT_TRUE(txn1->IsTableLocked(0, &mode));
+  EXPECT_EQ(mode, LockMode::INTENTION_EXCLUSIVE);
+  CheckTxnLockSize(txn0, 1, 0);
+  CheckTxnLockSize(txn1, 0, 1);
+
+  // S on the table waits for the IX of txn1, then upgrades IS
+  std::atomic<bool> granted{false};
+  std::thread t0([&] {
+    EXPECT_TRUE(lock_mgr.LockTable(txn0, 0, LockMode::SHARED));
+    granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(granted);
+  txn_mgr.Commit(txn1);
+  t0.join();
+  EXPECT_TRUE(granted);
+  EXPECT_TRUE(txn0->IsTableLocked(0, &mode));
+  EXPECT_EQ(mode, LockMode::SHARED);
+
+  // S covers reading any row, writing one takes IX on top of it
+  EXPECT_TRUE(lock_mgr.LockRowShared(txn0, 0, RID{0, 2}));
+  CheckTxnLockSize(txn0, 1, 0);
+  EXPECT_TRUE(lock_mgr.LockRowExclusive(txn0, 0, RID{0, 0}));
+  EXPECT_TRUE(txn0->IsTableLocked(0, &mode));
+  EXPECT_EQ(mode, LockMode::SHARED_INTENTION_EXCLUSIVE);
+  CheckTxnLockSize(txn0, 0, 1);
+  txn_mgr.Commit(txn0);
+  EXPECT_TRUE(txn0->GetTableLockSet()->empty());
+
+  // Past the threshold, the whole table is locked instead of more rows
+  Transaction *txn2 = txn_mgr.Begin();
+  for (uint32_t i = 0; i < LOCK_ESCALATION_THRESHOLD + 10; i++) {
+    EXPECT_TRUE(lock_mgr.LockRowShared(txn2, 1, RID{static_cast<int32_t>(i / 100), i % 100}));
+  }
+  CheckTxnLockSize(txn2, LOCK_ESCALATION_THRESHOLD, 0);
+  EXPECT_TRUE(txn2->IsTableLocked(1, &mode));
+  EXPECT_EQ(mode, LockMode::SHARED);
+  txn_mgr.Commit(txn2);
+  CheckTxnLockSize(txn2, 0, 0);
+  EXPECT_EQ(lock_mgr.GetQueueCount(), 0);
+
+  delete txn0;
+  delete txn1;
+  delete txn2;
+}
+
 TEST(LockManagerTest, GraphEdgeTest) {
   LockManager lock_mgr{};
   TransactionManager txn_mgr{&lock_mgr};
@@ -195,12 +289,7 @@ TEST(LockManagerTest, GraphEdgeTest) {
   }
 }
 
-/**
- * In my implementation you must call RunCycleDetection()
- * to initialize some internal data structure. So this test
- * is not supported...
- */
-TEST(LockManagerTest, DISABLED_BasicCycleTest) {
+TEST(LockManagerTest, BasicCycleTest) {
   LockManager lock_mgr{}; /* Use Deadlock detection */
   TransactionManager txn_mgr{&lock_mgr};
 
@@ -219,7 +308,6 @@ TEST(LockManagerTest, DISABLED_BasicCycleTest) {
 
 TEST(LockManagerTest, BasicDeadlockDetectionTest) {
   LockManager lock_mgr{};
-  cycle_detection_interval = std::chrono::milliseconds(500);
   TransactionManager txn_mgr{&lock_mgr};
   RID rid0{0, 0};
   RID rid1{1, 1};
@@ -264,13 +352,74 @@ TEST(LockManagerTest, BasicDeadlockDetectionTest) {
     }
   });
 
-  // Sleep for enough time to break cycle
-  std::this_thread::sleep_for(cycle_detection_interval * 2);
-
   t0.join();
   t1.join();
 
   delete txn0;
   delete txn1;
 }
+
+// Under WAIT_DIE an older txn waits for a younger one, a younger one aborts rather than wait for an older one
+TEST(LockManagerTest, WaitDieTest) {
+  LockManager lock_mgr{DeadlockMode::WAIT_DIE};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{1, 1};
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockExclusive(txn0, rid0));
+  EXPECT_TRUE(lock_mgr.LockShared(txn1, rid1));
+
+  std::atomic<bool> granted{false};
+  std::thread t0([&] {
+    EXPECT_TRUE(lock_mgr.LockExclusive(txn0, rid1));
+    granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(granted);
+  CheckGrowing(txn0);
+
+  EXPECT_THROW(lock_mgr.LockExclusive(txn1, rid0), TransactionAbortException);
+  CheckAborted(txn1);
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+  txn_mgr.Abort(txn1);
+  t0.join();
+  EXPECT_TRUE(granted);
+  txn_mgr.Commit(txn0);
+  CheckCommitted(txn0);
+
+  delete txn0;
+  delete txn1;
+}
+
+// Under WOUND_WAIT an older txn aborts the younger one it waits for, and gets the lock once it is released
+TEST(LockManagerTest, WoundWaitTest) {
+  LockManager lock_mgr{DeadlockMode::WOUND_WAIT};
+  TransactionManager txn_mgr{&lock_mgr};
+  RID rid0{0, 0};
+  RID rid1{1, 1};
+  auto *txn0 = txn_mgr.Begin();
+  auto *txn1 = txn_mgr.Begin();
+  EXPECT_TRUE(lock_mgr.LockExclusive(txn1, rid0));
+
+  std::atomic<bool> granted{false};
+  std::thread t0([&] {
+    EXPECT_TRUE(lock_mgr.LockShared(txn0, rid0));
+    granted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(granted);
+  CheckAborted(txn1);
+
+  // The wounded txn finds out on its next lock request
+  EXPECT_THROW(lock_mgr.LockShared(txn1, rid1), TransactionAbortException);
+  txn_mgr.Abort(txn1);
+  t0.join();
+  EXPECT_TRUE(granted);
+  CheckGrowing(txn0);
+  txn_mgr.Commit(txn0);
+
+  delete txn0;
+  delete txn1;
+}
 }  // namespace bustub
@@ -2,11 +2,14 @@
  * transaction_test.cpp
  */
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -21,9 +24,12 @@
 #include "execution/expressions/column_value_expression.h"
 #include "execution/expressions/comparison_expression.h"
 #include "execution/expressions/constant_value_expression.h"
+#include "execution/plans/delete_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
 #include "execution/plans/nested_index_join_plan.h"
 #include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/update_plan.h"
 #include "gtest/gtest.h"
 #include "storage/b_plus_tree_test_util.h"  // NOLINT
 #include "type/value_factory.h"
@@ -465,4 +471,279 @@ TEST_F(TransactionTest, HugeReadTest) {
   delete key_schema;
 }
 
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, LockEscalationTest) {
+  // txn1: INSERT INTO empty_table2 more rows than LOCK_ESCALATION_THRESHOLD; Commit
+  // txn2: SELECT * FROM empty_table2, its row locks escalate to a SHARED table lock
+  // txn2: reads every row again through the table heap, which takes no row lock the table lock covers
+  const size_t num_rows = LOCK_ESCALATION_THRESHOLD + 100;
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto txn1 = GetTxnManager()->Begin();
+  auto exec_ctx1 = std::make_unique<ExecutorContext>(txn1, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager());
+  std::vector<std::vector<Value>> raw_vals{};
+  for (size_t i = 0; i < num_rows; i++) {
+    auto value = static_cast<int32_t>(i);
+    raw_vals.push_back({ValueFactory::GetIntegerValue(value), ValueFactory::GetIntegerValue(value)});
+  }
+  InsertPlanNode insert_plan{std::move(raw_vals), table_info->oid_};
+  GetExecutionEngine()->Execute(&insert_plan, nullptr, txn1, exec_ctx1.get());
+  GetTxnManager()->Commit(txn1);
+
+  auto txn2 = GetTxnManager()->Begin(nullptr, IsolationLevel::REPEATABLE_READ);
+  auto exec_ctx2 = std::make_unique<ExecutorContext>(txn2, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager());
+  auto &schema = table_info->schema_;
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto out_schema = MakeOutputSchema({{"colA", colA}});
+  SeqScanPlanNode scan_plan{out_schema, nullptr, table_info->oid_};
+  std::vector<Tuple> result_set{};
+  GetExecutionEngine()->Execute(&scan_plan, &result_set, txn2, exec_ctx2.get());
+  ASSERT_EQ(result_set.size(), num_rows);
+  LockMode mode;
+  ASSERT_TRUE(txn2->IsTableLocked(table_info->oid_, &mode));
+  EXPECT_EQ(mode, LockMode::SHARED);
+  CheckTxnLockSize(txn2, LOCK_ESCALATION_THRESHOLD, 0);
+
+  // With logging on, the table heap locks the rows it reads itself
+  enable_logging = true;
+  size_t count = 0;
+  for (auto iter = table_info->table_->Begin(txn2); iter != table_info->table_->End(); ++iter) {
+    count++;
+  }
+  enable_logging = false;
+  EXPECT_EQ(count, num_rows);
+  CheckTxnLockSize(txn2, LOCK_ESCALATION_THRESHOLD, 0);
+
+  GetTxnManager()->Commit(txn2);
+  CheckTxnLockSize(txn2, 0, 0);
+  delete txn1;
+  delete txn2;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, EscalatedWriterBlocksIndexScanTest) {
+  // txn1: INSERT INTO empty_table2 more rows than LOCK_ESCALATION_THRESHOLD, indexed on colA; Commit
+  // txn2: locks the last rows exclusively until it escalates to an EXCLUSIVE table lock
+  // txn3: SELECT colA, colB FROM empty_table2 LIMIT 10 through the index, its first batches hold none of the rows
+  //       txn2 locked itself but it must wait for txn2 all the same
+  const size_t num_rows = LOCK_ESCALATION_THRESHOLD + 1 + 4 * BATCH_SIZE;
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto &schema = table_info->schema_;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  auto index_info = GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "empty_table2", schema, *key_schema, {0}, 8);
+  auto txn1 = GetTxnManager()->Begin();
+  auto exec_ctx1 = std::make_unique<ExecutorContext>(txn1, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager());
+  std::vector<std::vector<Value>> raw_vals{};
+  for (size_t i = 0; i < num_rows; i++) {
+    auto value = static_cast<int32_t>(i);
+    raw_vals.push_back({ValueFactory::GetIntegerValue(value), ValueFactory::GetIntegerValue(value)});
+  }
+  InsertPlanNode insert_plan{std::move(raw_vals), table_info->oid_};
+  GetExecutionEngine()->Execute(&insert_plan, nullptr, txn1, exec_ctx1.get());
+  GetTxnManager()->Commit(txn1);
+
+  std::vector<RID> rids;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End(); ++iter) {
+    rids.push_back(iter->GetRid());
+  }
+  ASSERT_EQ(rids.size(), num_rows);
+  auto txn2 = GetTxnManager()->Begin();
+  for (size_t i = num_rows; i-- > num_rows - LOCK_ESCALATION_THRESHOLD - 1;) {
+    ASSERT_TRUE(GetLockManager()->LockRowExclusive(txn2, table_info->oid_, rids[i]));
+  }
+  LockMode mode;
+  ASSERT_TRUE(txn2->IsTableLocked(table_info->oid_, &mode));
+  ASSERT_EQ(mode, LockMode::EXCLUSIVE);
+
+  auto txn3 = GetTxnManager()->Begin(nullptr, IsolationLevel::REPEATABLE_READ);
+  auto exec_ctx3 = std::make_unique<ExecutorContext>(txn3, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager());
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  IndexScanPlanNode scan_plan{out_schema, nullptr, index_info->index_oid_};
+  LimitPlanNode limit_plan{out_schema, &scan_plan, 10, 0};
+  std::vector<Tuple> result_set{};
+  std::atomic<bool> done{false};
+  // With logging on, the table heap locks the rows it reads itself
+  enable_logging = true;
+  std::thread reader([&] {
+    GetExecutionEngine()->Execute(&limit_plan, &result_set, txn3, exec_ctx3.get());
+    done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(done);
+  GetTxnManager()->Commit(txn2);
+  reader.join();
+  enable_logging = false;
+  ASSERT_EQ(result_set.size(), 10);
+  ASSERT_TRUE(txn3->IsTableLocked(table_info->oid_, &mode));
+  EXPECT_EQ(mode, LockMode::INTENTION_SHARED);
+
+  GetTxnManager()->Commit(txn3);
+  delete txn1;
+  delete txn2;
+  delete txn3;
+  delete key_schema;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, SnapshotIsolationTest) {
+  // txn0: INSERT INTO empty_table2 VALUES (0, 0), (1, 10), (2, 20); Commit
+  // txn_r (snapshot) and txn_w begin
+  // txn_w: UPDATE empty_table2 SET colB = 100 WHERE colA = 1; DELETE FROM empty_table2 WHERE colA = 2;
+  //        INSERT INTO empty_table2 VALUES (3, 30)
+  // txn_r: SELECT * FROM empty_table2, before and after txn_w commits
+  auto table_info = GetCatalog()->GetTable("empty_table2");
+  auto &schema = table_info->schema_;
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  SeqScanPlanNode scan_plan{out_schema, nullptr, table_info->oid_};
+  std::vector<std::unique_ptr<ExecutorContext>> exec_ctxs;
+  auto execute = [&](const AbstractPlanNode *plan, Transaction *txn) {
+    exec_ctxs.emplace_back(
+        std::make_unique<ExecutorContext>(txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()));
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(plan, &result_set, txn, exec_ctxs.back().get());
+    return result_set;
+  };
+  auto scan = [&](Transaction *txn) {
+    std::vector<std::pair<int32_t, int32_t>> rows;
+    auto result_set = execute(&scan_plan, txn);
+    for (auto &tuple : result_set) {
+      rows.emplace_back(tuple.GetValue(out_schema, 0).GetAs<int32_t>(), tuple.GetValue(out_schema, 1).GetAs<int32_t>());
+    }
+    std::sort(rows.begin(), rows.end());
+    return rows;
+  };
+  auto where_col_a = [&](int32_t val) {
+    return MakeComparisonExpression(colA, MakeConstantValueExpression(ValueFactory::GetIntegerValue(val)),
+                                    ComparisonType::Equal);
+  };
+  using Rows = std::vector<std::pair<int32_t, int32_t>>;
+
+  auto txn0 = GetTxnManager()->Begin();
+  InsertPlanNode insert_plan{{{ValueFactory::GetIntegerValue(0), ValueFactory::GetIntegerValue(0)},
+                              {ValueFactory::GetIntegerValue(1), ValueFactory::GetIntegerValue(10)},
+                              {ValueFactory::GetIntegerValue(2), ValueFactory::GetIntegerValue(20)}},
+                             table_info->oid_};
+  execute(&insert_plan, txn0);
+  GetTxnManager()->Commit(txn0);
+
+  auto txn_r = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  auto txn_w = GetTxnManager()->Begin();
+  SeqScanPlanNode scan_1{out_schema, where_col_a(1), table_info->oid_};
+  std::unordered_map<uint32_t, UpdateInfo> set_b_100{{1, UpdateInfo(UpdateType::Set, 100)}};
+  UpdatePlanNode update_plan{&scan_1, table_info->oid_, set_b_100};
+  execute(&update_plan, txn_w);
+  SeqScanPlanNode scan_2{out_schema, where_col_a(2), table_info->oid_};
+  DeletePlanNode delete_plan{&scan_2, table_info->oid_};
+  execute(&delete_plan, txn_w);
+  InsertPlanNode insert_plan_3{{{ValueFactory::GetIntegerValue(3), ValueFactory::GetIntegerValue(30)}},
+                               table_info->oid_};
+  execute(&insert_plan_3, txn_w);
+
+  // The rows txn_w locks exclusively neither block nor show to the snapshot, which takes no lock
+  Rows before{{0, 0}, {1, 10}, {2, 20}};
+  EXPECT_EQ(scan(txn_r), before);
+  CheckTxnLockSize(txn_r, 0, 0);
+  GetTxnManager()->Commit(txn_w);
+  EXPECT_EQ(scan(txn_r), before);
+  EXPECT_EQ(table_info->table_->GetVersionStore()->GetChainCount(), 3);
+
+  auto txn_n = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  Rows after{{0, 0}, {1, 100}, {3, 30}};
+  EXPECT_EQ(scan(txn_n), after);
+
+  // txn_r sees its own writes, but loses to txn_w on the row txn_w updated first
+  SeqScanPlanNode scan_0{out_schema, where_col_a(0), table_info->oid_};
+  std::unordered_map<uint32_t, UpdateInfo> set_b_1{{1, UpdateInfo(UpdateType::Set, 1)}};
+  UpdatePlanNode update_0{&scan_0, table_info->oid_, set_b_1};
+  execute(&update_0, txn_r);
+  EXPECT_EQ(scan(txn_r), (Rows{{0, 1}, {1, 10}, {2, 20}}));
+  UpdatePlanNode update_1{&scan_1, table_info->oid_, set_b_1};
+  execute(&update_1, txn_r);
+  CheckAborted(txn_r);
+  EXPECT_EQ(scan(txn_n), after);
+  GetTxnManager()->Commit(txn_n);
+  // The last snapshot ended, every older version is dropped and the deleted row purged
+  EXPECT_EQ(table_info->table_->GetVersionStore()->GetChainCount(), 0);
+
+  // Writes keep versions with no snapshot active too, so a snapshot that begins meanwhile still reads its own
+  auto txn1 = GetTxnManager()->Begin();
+  InsertPlanNode insert_plan_4{{{ValueFactory::GetIntegerValue(4), ValueFactory::GetIntegerValue(40)}},
+                               table_info->oid_};
+  execute(&insert_plan_4, txn1);
+  EXPECT_EQ(table_info->table_->GetVersionStore()->GetChainCount(), 1);
+  auto txn_s = GetTxnManager()->Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  EXPECT_EQ(scan(txn_s), after);
+  GetTxnManager()->Commit(txn1);
+  EXPECT_EQ(scan(txn_s), after);
+  EXPECT_EQ(txn_s->GetState(), TransactionState::GROWING);
+  GetTxnManager()->Commit(txn_s);
+  EXPECT_EQ(table_info->table_->GetVersionStore()->GetChainCount(), 0);
+
+  // A commit with no snapshot active drops its chains right away
+  auto txn2 = GetTxnManager()->Begin();
+  execute(&update_0, txn2);
+  EXPECT_EQ(table_info->table_->GetVersionStore()->GetChainCount(), 1);
+  GetTxnManager()->Commit(txn2);
+  EXPECT_EQ(table_info->table_->GetVersionStore()->GetChainCount(), 0);
+  auto txn3 = GetTxnManager()->Begin();
+  EXPECT_EQ(scan(txn3), (Rows{{0, 1}, {1, 100}, {3, 30}, {4, 40}}));
+  GetTxnManager()->Commit(txn3);
+
+  exec_ctxs.clear();
+  delete txn0;
+  delete txn_r;
+  delete txn_w;
+  delete txn_n;
+  delete txn1;
+  delete txn_s;
+  delete txn2;
+  delete txn3;
+}
+
+
+// NOLINTNEXTLINE
+TEST(TransactionManagerTest, BlockAllTransactionsTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  auto txn0 = txn_mgr.Begin();
+  EXPECT_EQ(TransactionManager::GetTransaction(txn0->GetTransactionId()), txn0);
+
+  // Blocking waits for txn0 to finish
+  std::atomic<bool> blocked{false};
+  std::thread checkpoint([&] {
+    txn_mgr.BlockAllTransactions();
+    blocked = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(blocked);
+  txn_mgr.Commit(txn0);
+  checkpoint.join();
+  EXPECT_TRUE(blocked);
+  // Finished transactions leave the registry
+  EXPECT_EQ(TransactionManager::GetTransaction(txn0->GetTransactionId()), nullptr);
+
+  // New transactions wait until resumed
+  std::atomic<bool> begun{false};
+  Transaction *txn1 = nullptr;
+  std::thread worker([&] {
+    txn1 = txn_mgr.Begin();
+    begun = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(begun);
+  txn_mgr.ResumeTransactions();
+  worker.join();
+  EXPECT_TRUE(begun);
+  txn_mgr.Abort(txn1);
+  EXPECT_EQ(TransactionManager::GetTransaction(txn1->GetTransactionId()), nullptr);
+
+  delete txn0;
+  delete txn1;
+}
+
 }  // namespace bustub
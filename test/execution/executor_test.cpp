@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <cstdio>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -19,22 +21,28 @@
 
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
 
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/table_generator.h"
 #include "concurrency/transaction_manager.h"
+#include "execution/bloom_filter.h"
 #include "execution/execution_engine.h"
 #include "execution/executor_context.h"
+#include "execution/executor_factory.h"
+#include "execution/expression_compiler.h"
 #include "execution/executors/aggregation_executor.h"
 #include "execution/executors/insert_executor.h"
 #include "execution/executors/nested_loop_join_executor.h"
 #include "execution/executors/nested_index_join_executor.h"
+#include "execution/executors/seq_scan_executor.h"
 #include "execution/expressions/aggregate_value_expression.h"
 #include "execution/expressions/column_value_expression.h"
 #include "execution/expressions/comparison_expression.h"
 #include "execution/expressions/constant_value_expression.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/index_scan_plan.h"
+#include "execution/task_scheduler.h"
 #include "gtest/gtest.h"
 #include "storage/b_plus_tree_test_util.h"  // NOLINT
 #include "storage/table/tuple.h"
@@ -170,6 +178,67 @@ TEST_F(ExecutorTest, SimpleSeqScanTest) {
   ASSERT_EQ(result_set.size(), 500);
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, StreamingResultTest) {
+  // SELECT colA, colB FROM empty_table2, over several batches of output
+  static constexpr int32_t TABLE_SIZE = 5000;
+  TableMetadata *table_info = GetExecutorContext()->GetCatalog()->GetTable("empty_table2");
+  Schema &schema = table_info->schema_;
+  for (int32_t i = 0; i < TABLE_SIZE; i++) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i % 10)}, &schema};
+    RID rid;
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, GetTxn()));
+  }
+  auto *colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto *colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto *out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  SeqScanPlanNode plan{out_schema, nullptr, table_info->oid_};
+
+  // Pull every row through a cursor, in table order
+  auto cursor = GetExecutionEngine()->Open(&plan, GetTxn(), GetExecutorContext());
+  Tuple tuple;
+  int32_t count = 0;
+  while (cursor->Next(&tuple)) {
+    ASSERT_EQ(tuple.GetValue(out_schema, 0).GetAs<int32_t>(), count);
+    count++;
+  }
+  ASSERT_EQ(count, TABLE_SIZE);
+  ASSERT_FALSE(cursor->Next(&tuple));
+
+  // Push batches into a sink, no batch exceeds BATCH_SIZE
+  count = 0;
+  int batches = 0;
+  ASSERT_TRUE(GetExecutionEngine()->Stream(&plan, [&](TupleBatch *batch) {
+    EXPECT_LE(batch->Size(), static_cast<size_t>(BATCH_SIZE));
+    count += batch->Size();
+    batches++;
+    return true;
+  }, GetTxn(), GetExecutorContext()));
+  ASSERT_EQ(count, TABLE_SIZE);
+  ASSERT_GT(batches, 1);
+
+  // A sink that declines more rows stops the query after the first batch
+  batches = 0;
+  ASSERT_TRUE(GetExecutionEngine()->Stream(&plan, [&](TupleBatch *batch) {
+    batches++;
+    return false;
+  }, GetTxn(), GetExecutorContext()));
+  ASSERT_EQ(batches, 1);
+
+  // A query whose transaction can no longer lock aborts that transaction and reports the failure
+  Transaction *txn = GetTxnManager()->Begin();
+  txn->SetState(TransactionState::SHRINKING);
+  ExecutorContext exec_ctx{txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()};
+  batches = 0;
+  ASSERT_FALSE(GetExecutionEngine()->Stream(&plan, [&](TupleBatch *batch) {
+    batches++;
+    return true;
+  }, txn, &exec_ctx));
+  ASSERT_EQ(batches, 0);
+  ASSERT_EQ(txn->GetState(), TransactionState::ABORTED);
+  delete txn;
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, DyySeqScanTest) {
   // SELECT colA, colB FROM test_1
@@ -222,6 +291,272 @@ TEST_F(ExecutorTest, DyySeqScanTest_2) {
   ASSERT_EQ(result_set.size(), 1000);
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BatchPredicateTest) {
+  // Every comparison over colA, in both operand orders, must select the same tuples batch-at-a-time
+  // as tuple-at-a-time
+  TableMetadata *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  Schema &schema = table_info->schema_;
+  TupleBatch batch;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End() && !batch.IsFull(); ++iter) {
+    batch.Append(Tuple(*iter), iter->GetRid());
+  }
+  ASSERT_EQ(batch.Size(), TEST1_SIZE);
+
+  auto *colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto *const500 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(500));
+  for (auto comp_type : {ComparisonType::Equal, ComparisonType::NotEqual, ComparisonType::LessThan,
+                         ComparisonType::LessThanOrEqual, ComparisonType::GreaterThan,
+                         ComparisonType::GreaterThanOrEqual}) {
+    for (auto *predicate :
+         {MakeComparisonExpression(colA, const500, comp_type), MakeComparisonExpression(const500, colA, comp_type)}) {
+      SelectionBitmap selection;
+      predicate->EvaluateBatch(batch, &schema, &selection);
+      ASSERT_EQ(selection.Size(), batch.Size());
+      size_t selected = 0;
+      for (size_t i = 0; i < batch.Size(); i++) {
+        bool expected = AbstractExpression::IsTrue(predicate->Evaluate(&batch.GetTuple(i), &schema));
+        ASSERT_EQ(selection.Test(i), expected);
+        selected += expected ? 1 : 0;
+      }
+      ASSERT_EQ(selection.Count(), selected);
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BatchPredicateNullTest) {
+  // Comparisons on DECIMAL and VARCHAR columns holding NULLs, and against NULL constants, select the same tuples
+  // batch-at-a-time as tuple-at-a-time: a comparison with a NULL is never true
+  Column col_a{"a", TypeId::INTEGER};
+  Column col_d{"d", TypeId::DECIMAL};
+  Column col_v{"v", TypeId::VARCHAR, 16};
+  Schema schema{{col_a, col_d, col_v}};
+  // More than two bitmap words, so that both the word-at-a-time loop and the tail run
+  TupleBatch batch;
+  for (int i = 0; i < 150; i++) {
+    Value a = i % 7 == 0 ? ValueFactory::GetNullValueByType(TypeId::INTEGER) : ValueFactory::GetIntegerValue(i % 100);
+    Value d = i % 5 == 0 ? ValueFactory::GetNullValueByType(TypeId::DECIMAL) : ValueFactory::GetDecimalValue(i / 4.0);
+    Value v = ValueFactory::GetVarcharValue(std::to_string(i % 10));
+    batch.Append(Tuple({a, d, v}, &schema), RID(0, i));
+  }
+
+  auto *a = MakeColumnValueExpression(schema, 0, "a");
+  auto *d = MakeColumnValueExpression(schema, 0, "d");
+  auto *v = MakeColumnValueExpression(schema, 0, "v");
+  std::vector<std::pair<const AbstractExpression *, const AbstractExpression *>> operands{
+      {a, MakeConstantValueExpression(ValueFactory::GetIntegerValue(50))},
+      {a, MakeConstantValueExpression(ValueFactory::GetNullValueByType(TypeId::INTEGER))},
+      {d, MakeConstantValueExpression(ValueFactory::GetDecimalValue(20.25))},
+      {d, MakeConstantValueExpression(ValueFactory::GetNullValueByType(TypeId::DECIMAL))},
+      {v, MakeConstantValueExpression(ValueFactory::GetVarcharValue("5"))},
+      {v, MakeConstantValueExpression(ValueFactory::GetNullValueByType(TypeId::VARCHAR))}};
+  for (auto comp_type : {ComparisonType::Equal, ComparisonType::NotEqual, ComparisonType::LessThan,
+                         ComparisonType::LessThanOrEqual, ComparisonType::GreaterThan,
+                         ComparisonType::GreaterThanOrEqual}) {
+    for (auto [column, constant] : operands) {
+      for (auto *predicate : {MakeComparisonExpression(column, constant, comp_type),
+                              MakeComparisonExpression(constant, column, comp_type)}) {
+        SelectionBitmap selection;
+        predicate->EvaluateBatch(batch, &schema, &selection);
+        ASSERT_EQ(selection.Size(), batch.Size());
+        for (size_t i = 0; i < batch.Size(); i++) {
+          Value lhs = column->Evaluate(&batch.GetTuple(i), &schema);
+          bool expected = AbstractExpression::IsTrue(predicate->Evaluate(&batch.GetTuple(i), &schema));
+          ASSERT_EQ(selection.Test(i), expected) << "row " << i;
+          if (lhs.IsNull() || constant->Evaluate(&batch.GetTuple(i), &schema).IsNull()) {
+            ASSERT_FALSE(expected) << "row " << i;
+          }
+        }
+      }
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, CompiledExpressionTest) {
+  // Compiled predicates and projections must agree with the interpreted expressions
+  TableMetadata *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  Schema &schema = table_info->schema_;
+  TupleBatch batch;
+  for (auto iter = table_info->table_->Begin(GetTxn()); iter != table_info->table_->End() && !batch.IsFull(); ++iter) {
+    batch.Append(Tuple(*iter), iter->GetRid());
+  }
+
+  auto *colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto *colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto *colC = MakeColumnValueExpression(schema, 0, "colC");
+  auto *const500 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(500));
+  for (auto comp_type : {ComparisonType::Equal, ComparisonType::NotEqual, ComparisonType::LessThan,
+                         ComparisonType::LessThanOrEqual, ComparisonType::GreaterThan,
+                         ComparisonType::GreaterThanOrEqual}) {
+    for (auto *predicate :
+         {MakeComparisonExpression(colA, const500, comp_type), MakeComparisonExpression(const500, colA, comp_type),
+          MakeComparisonExpression(colB, colC, comp_type)}) {
+      CompiledPredicate compiled = ExpressionCompiler::CompilePredicate(predicate, &schema);
+      ASSERT_TRUE(compiled.IsCompiled());
+      SelectionBitmap selection;
+      compiled.EvaluateBatch(batch, &selection);
+      for (size_t i = 0; i < batch.Size(); i++) {
+        bool expected = predicate->Evaluate(&batch.GetTuple(i), &schema).GetAs<bool>();
+        ASSERT_EQ(compiled.Evaluate(batch.GetTuple(i)), expected);
+        ASSERT_EQ(selection.Test(i), expected);
+      }
+    }
+  }
+  // Aggregates are not compiled
+  ASSERT_FALSE(ExpressionCompiler::CompilePredicate(MakeAggregateValueExpression(false, 0), &schema).IsCompiled());
+
+  // colC, colA, colB: the adjacent colA, colB are one copy
+  auto *out_schema = MakeOutputSchema({{"colC", colC}, {"colA", colA}, {"colB", colB}});
+  auto projection = ExpressionCompiler::CompileProjection(out_schema, &schema);
+  ASSERT_NE(projection, nullptr);
+  for (size_t i = 0; i < batch.Size(); i++) {
+    Tuple projected = projection->Project(batch.GetTuple(i));
+    for (uint32_t col = 0; col < out_schema->GetColumnCount(); col++) {
+      ASSERT_EQ(projected.GetValue(out_schema, col).GetAs<int32_t>(),
+                out_schema->GetColumn(col).GetExpr()->Evaluate(&batch.GetTuple(i), &schema).GetAs<int32_t>());
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, PushdownTableIteratorTest) {
+  // A predicate pushed into the table iterator only lets matching tuples out of their pages
+  TableMetadata *table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  Schema &schema = table_info->schema_;
+  auto *colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto *predicate = MakeComparisonExpression(
+      MakeConstantValueExpression(ValueFactory::GetIntegerValue(500)), colA, ComparisonType::LessThanOrEqual);
+  CompiledPredicate compiled = ExpressionCompiler::CompilePredicate(predicate, &schema);
+  ASSERT_TRUE(compiled.IsCompiled());
+
+  TableHeap *table = table_info->table_.get();
+  size_t count = 0;
+  for (auto iter = table->Begin(GetTxn(), table->GetFirstPageId(), INVALID_PAGE_ID, compiled.GetRowFunction());
+       iter != table->End(); ++iter) {
+    ASSERT_GE(iter->GetValue(&schema, 0).GetAs<int32_t>(), 500);
+    count++;
+  }
+  ASSERT_EQ(count, TEST1_SIZE - 500);
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, ParallelSeqScanTest) {
+  // SELECT colA, colB FROM empty_table2 WHERE colA < 15000, over enough pages for many morsels
+  static constexpr int32_t TABLE_SIZE = 20000;
+  TableMetadata *table_info = GetExecutorContext()->GetCatalog()->GetTable("empty_table2");
+  Schema &schema = table_info->schema_;
+  for (int32_t i = 0; i < TABLE_SIZE; i++) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i % 10)}, &schema};
+    RID rid;
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, GetTxn()));
+  }
+  std::vector<page_id_t> page_ids;
+  ASSERT_TRUE(table_info->table_->GetPageIds(GetTxn(), &page_ids));
+  ASSERT_GT(page_ids.size(), 4 * MORSEL_SIZE);
+
+  auto *colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto *colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto *const15000 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(15000));
+  auto *predicate = MakeComparisonExpression(colA, const15000, ComparisonType::LessThan);
+  auto *out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+
+  // Every qualifying tuple comes out of the exchange exactly once
+  SeqScanPlanNode plan{out_schema, predicate, table_info->oid_, 4};
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), 15000);
+  std::vector<bool> seen(15000, false);
+  for (const auto &tuple : result_set) {
+    auto a = tuple.GetValue(out_schema, 0).GetAs<int32_t>();
+    ASSERT_TRUE(a >= 0 && a < 15000);
+    ASSERT_FALSE(seen[a]);
+    seen[a] = true;
+    ASSERT_EQ(tuple.GetValue(out_schema, 1).GetAs<int32_t>(), a % 10);
+  }
+
+  // Tuple-at-a-time Next() drains the same tuples
+  SeqScanExecutor executor{GetExecutorContext(), &plan};
+  executor.Init();
+  Tuple tuple;
+  RID rid;
+  size_t count = 0;
+  while (executor.Next(&tuple, &rid)) {
+    count++;
+  }
+  ASSERT_EQ(count, 15000);
+
+  // A consumer that stops early shuts the workers down
+  LimitPlanNode limit_plan{out_schema, &plan, 10, 0};
+  result_set.clear();
+  GetExecutionEngine()->Execute(&limit_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), 10);
+
+  // Two scans open at once, with more producers each than the pool has workers: those of the first one, whose
+  // consumer does not read on, are parked instead of holding the workers the second one needs
+  auto parallelism = static_cast<uint32_t>(GetExecutorContext()->GetTaskScheduler()->GetWorkerCount() + 1);
+  SeqScanPlanNode wide_plan{out_schema, predicate, table_info->oid_, parallelism};
+  SeqScanExecutor first{GetExecutorContext(), &wide_plan};
+  SeqScanExecutor second{GetExecutorContext(), &wide_plan};
+  first.Init();
+  ASSERT_TRUE(first.Next(&tuple, &rid));
+  second.Init();
+  count = 0;
+  while (second.Next(&tuple, &rid)) {
+    count++;
+  }
+  ASSERT_EQ(count, 15000);
+  count = 1;
+  while (first.Next(&tuple, &rid)) {
+    count++;
+  }
+  ASSERT_EQ(count, 15000);
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, TaskSchedulerTest) {
+  TaskScheduler scheduler{4};
+
+  // Every task runs exactly once, on some worker, accumulating into that worker's slot
+  PerWorker<size_t> counts(&scheduler, [] { return size_t{0}; });
+  {
+    TaskGroup group{&scheduler};
+    for (int i = 0; i < 1000; i++) {
+      group.Run([&] { counts.Local()++; });
+    }
+    group.Wait();
+  }
+  size_t total = 0;
+  for (size_t w = 0; w < counts.Size(); w++) {
+    total += counts.At(w);
+  }
+  ASSERT_EQ(total, 1000);
+
+  // A task may spawn and wait for tasks of its own, even with every worker waiting
+  std::atomic<size_t> leaves{0};
+  {
+    TaskGroup group{&scheduler};
+    for (int i = 0; i < 8; i++) {
+      group.Run([&] {
+        TaskGroup inner{&scheduler};
+        for (int j = 0; j < 100; j++) {
+          inner.Run([&] { leaves++; });
+        }
+        inner.Wait();
+      });
+    }
+    group.Wait();
+  }
+  ASSERT_EQ(leaves, 800);
+
+  // The first exception of a group reaches its waiter
+  TaskGroup group{&scheduler};
+  group.Run([] { throw Exception(ExceptionType::INVALID, "task failed"); });
+  group.Run([] {});
+  ASSERT_THROW(group.Wait(), Exception);
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, SimpleRawInsertTest) {
   // INSERT INTO empty_table2 VALUES (100, 10), (101, 11), (102, 12)
@@ -319,6 +654,75 @@ TEST_F(ExecutorTest, SimpleSelectInsertTest) {
   ASSERT_EQ(result_set1.size(), 500);
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BatchedIndexJoinTest) {
+  // INSERT INTO empty_table2 VALUES (0, 0), (2, 2), ..., (4998, 4998 % 7), indexed on colA
+  static constexpr int32_t INNER_SIZE = 2500;
+  std::vector<std::vector<Value>> raw_vals;
+  for (int32_t i = 0; i < INNER_SIZE; i++) {
+    raw_vals.push_back({ValueFactory::GetIntegerValue(2 * i), ValueFactory::GetIntegerValue(2 * i % 7)});
+  }
+  auto inner_info = GetExecutorContext()->GetCatalog()->GetTable("empty_table2");
+  InsertPlanNode insert_plan{std::move(raw_vals), inner_info->oid_};
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  auto index_info = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "empty_table2", inner_info->schema_, *key_schema, {0}, 8);
+  GetExecutionEngine()->Execute(&insert_plan, nullptr, GetTxn(), GetExecutorContext());
+
+  // Keys out of order, sparse and missing are all probed in one call
+  auto outer_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  const Schema *outer_schema = MakeOutputSchema({{"colA", MakeColumnValueExpression(outer_info->schema_, 0, "colA")}});
+  std::vector<Tuple> keys;
+  for (int32_t key : {4998, 0, 3001, 2500, 1, 3000}) {
+    keys.emplace_back(std::vector<Value>{ValueFactory::GetIntegerValue(key)}, outer_schema);
+  }
+  std::vector<std::pair<size_t, RID>> matches;
+  reinterpret_cast<B_PLUS_TREE_INDEX_TYPE *>(index_info->index_.get())->ScanKeys(keys, &matches);
+  std::vector<size_t> matched;
+  for (const auto &match : matches) {
+    Tuple inner_tuple;
+    ASSERT_TRUE(inner_info->table_->GetTuple(match.second, &inner_tuple, GetTxn()));
+    ASSERT_EQ(inner_tuple.GetValue(&inner_info->schema_, 0).GetAs<int32_t>(),
+              keys[match.first].GetValue(outer_schema, 0).GetAs<int32_t>());
+    matched.push_back(match.first);
+  }
+  ASSERT_EQ(matched, (std::vector<size_t>{1, 3, 5, 0}));
+
+  // SELECT t1.colA, t2.colB FROM test_1 t1 JOIN empty_table2 t2 ON t1.colA = t2.colA
+  SeqScanPlanNode outer_plan{outer_schema, nullptr, outer_info->oid_};
+  auto predicate = MakeComparisonExpression(MakeColumnValueExpression(*outer_schema, 0, "colA"),
+                                            MakeColumnValueExpression(inner_info->schema_, 1, "colA"),
+                                            ComparisonType::Equal);
+  const Schema *out_schema = MakeOutputSchema({{"leftA", MakeColumnValueExpression(*outer_schema, 0, "colA")},
+                                               {"rightB", MakeColumnValueExpression(inner_info->schema_, 1, "colB")}});
+  NestedIndexJoinPlanNode join_plan{out_schema, {&outer_plan}, predicate, inner_info->oid_, "index1", outer_schema,
+                                    &inner_info->schema_};
+  auto check = [&](const Tuple &tuple) {
+    auto a = tuple.GetValue(out_schema, 0).GetAs<int32_t>();
+    ASSERT_EQ(a % 2, 0);
+    ASSERT_EQ(tuple.GetValue(out_schema, 1).GetAs<int32_t>(), a % 7);
+  };
+
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&join_plan, &result_set, GetTxn(), GetExecutorContext());
+  for (const auto &tuple : result_set) {
+    check(tuple);
+  }
+  ASSERT_EQ(result_set.size(), TEST1_SIZE / 2);
+
+  auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), &join_plan);
+  executor->Init();
+  size_t tuple_count = 0;
+  Tuple tuple;
+  RID rid;
+  while (executor->Next(&tuple, &rid)) {
+    check(tuple);
+    tuple_count++;
+  }
+  ASSERT_EQ(tuple_count, TEST1_SIZE / 2);
+  delete key_schema;
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, SimpleRawInsertWithIndexTest) {
   // INSERT INTO empty_table2 VALUES (100, 10), (101, 11), (102, 12)
@@ -489,6 +893,155 @@ TEST_F(ExecutorTest, SimpleNestedLoopJoinTest) {
   }
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BatchNestedLoopJoinTest) {
+  // SELECT t1.colA, t2.colA FROM test_1 t1 JOIN test_1 t2 ON t1.colB = t2.colB
+  // pulled tuple-at-a-time and batch-at-a-time, both must produce the same join
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  const Schema *scan_schema = MakeOutputSchema(
+      {{"colA", MakeColumnValueExpression(schema, 0, "colA")}, {"colB", MakeColumnValueExpression(schema, 0, "colB")}});
+  SeqScanPlanNode scan_plan1{scan_schema, nullptr, table_info->oid_};
+  SeqScanPlanNode scan_plan2{scan_schema, nullptr, table_info->oid_};
+  auto predicate = MakeComparisonExpression(MakeColumnValueExpression(*scan_schema, 0, "colB"),
+                                            MakeColumnValueExpression(*scan_schema, 1, "colB"), ComparisonType::Equal);
+  const Schema *out_schema = MakeOutputSchema({{"leftA", MakeColumnValueExpression(*scan_schema, 0, "colA")},
+                                               {"leftB", MakeColumnValueExpression(*scan_schema, 0, "colB")},
+                                               {"rightB", MakeColumnValueExpression(*scan_schema, 1, "colB")}});
+  NestedLoopJoinPlanNode join_plan{out_schema, {&scan_plan1, &scan_plan2}, predicate};
+
+  // Expected size: sum of squared group sizes of colB
+  std::vector<size_t> group_sizes(10, 0);
+  {
+    auto scan = ExecutorFactory::CreateExecutor(GetExecutorContext(), &scan_plan1);
+    scan->Init();
+    Tuple tuple;
+    RID rid;
+    while (scan->Next(&tuple, &rid)) {
+      group_sizes[tuple.GetValue(scan_schema, 1).GetAs<int32_t>()]++;
+    }
+  }
+  size_t expected = 0;
+  for (auto size : group_sizes) {
+    expected += size * size;
+  }
+
+  auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), &join_plan);
+  executor->Init();
+  size_t tuple_count = 0;
+  Tuple tuple;
+  RID rid;
+  while (executor->Next(&tuple, &rid)) {
+    tuple_count++;
+  }
+  ASSERT_EQ(tuple_count, expected);
+
+  executor->Init();
+  size_t batch_count = 0;
+  TupleBatch batch;
+  while (executor->NextBatch(&batch)) {
+    ASSERT_LE(batch.Size(), BATCH_SIZE);
+    for (size_t i = 0; i < batch.Size(); i++) {
+      ASSERT_EQ(batch.GetTuple(i).GetValue(out_schema, 1).GetAs<int32_t>(),
+                batch.GetTuple(i).GetValue(out_schema, 2).GetAs<int32_t>());
+    }
+    batch_count += batch.Size();
+  }
+  ASSERT_EQ(batch_count, expected);
+}
+
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, BloomFilterJoinTest) {
+  // A Bloom filter never rejects an inserted key, and rarely accepts another one
+  BloomFilter filter;
+  filter.Reset(500);
+  for (int32_t i = 0; i < 1000; i += 2) {
+    filter.Insert(ValueFactory::GetIntegerValue(i));
+  }
+  size_t false_positives = 0;
+  for (int32_t i = 0; i < 1000; i++) {
+    bool may_contain = filter.MayContain(ValueFactory::GetIntegerValue(i));
+    if (i % 2 == 0) {
+      ASSERT_TRUE(may_contain);
+    } else if (may_contain) {
+      false_positives++;
+    }
+  }
+  ASSERT_LT(false_positives, 25);
+  ASSERT_FALSE(filter.MayContain(ValueFactory::GetNullValueByType(TypeId::INTEGER)));
+
+  // A scan drops the tuples the filter rules out
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+  auto &schema = table_info->schema_;
+  const Schema *scan_schema = MakeOutputSchema(
+      {{"colA", MakeColumnValueExpression(schema, 0, "colA")}, {"colB", MakeColumnValueExpression(schema, 0, "colB")}});
+  SeqScanPlanNode scan_plan{scan_schema, nullptr, table_info->oid_};
+  filter.Reset(3);
+  for (int32_t key : {1, 500, 999}) {
+    filter.Insert(ValueFactory::GetIntegerValue(key));
+  }
+  {
+    SeqScanExecutor scan{GetExecutorContext(), &scan_plan};
+    scan.SetBloomFilter(0, &filter);
+    scan.Init();
+    std::unordered_set<int32_t> keys;
+    Tuple tuple;
+    RID rid;
+    while (scan.Next(&tuple, &rid)) {
+      keys.insert(tuple.GetValue(scan_schema, 0).GetAs<int32_t>());
+    }
+    ASSERT_EQ(keys.count(1) + keys.count(500) + keys.count(999), 3);
+    ASSERT_LT(keys.size(), 50);
+  }
+
+  // SELECT t1.colA, t2.colA FROM test_1 t1 JOIN test_1 t2 ON t1.colA = t2.colA WHERE t1.colA < 10
+  // the right scan only yields rows whose key is in the left block
+  auto *const10 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(10));
+  SeqScanPlanNode left_plan{scan_schema,
+                            MakeComparisonExpression(MakeColumnValueExpression(schema, 0, "colA"), const10,
+                                                     ComparisonType::LessThan),
+                            table_info->oid_};
+  auto predicate = MakeComparisonExpression(MakeColumnValueExpression(*scan_schema, 1, "colA"),
+                                            MakeColumnValueExpression(*scan_schema, 0, "colA"), ComparisonType::Equal);
+  const Schema *out_schema = MakeOutputSchema({{"leftA", MakeColumnValueExpression(*scan_schema, 0, "colA")},
+                                               {"rightA", MakeColumnValueExpression(*scan_schema, 1, "colA")}});
+  NestedLoopJoinPlanNode join_plan{out_schema, {&left_plan, &scan_plan}, predicate};
+  auto executor = ExecutorFactory::CreateExecutor(GetExecutorContext(), &join_plan);
+  executor->Init();
+  size_t tuple_count = 0;
+  Tuple tuple;
+  RID rid;
+  while (executor->Next(&tuple, &rid)) {
+    ASSERT_EQ(tuple.GetValue(out_schema, 0).GetAs<int32_t>(), tuple.GetValue(out_schema, 1).GetAs<int32_t>());
+    tuple_count++;
+  }
+  ASSERT_EQ(tuple_count, 10);
+
+  std::vector<Tuple> result_set;
+  GetExecutionEngine()->Execute(&join_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), 10);
+
+  // Keys of different types that compare equal hash differently, so a DECIMAL = INTEGER join is not filtered
+  Schema decimal_schema{{Column{"colD", TypeId::DECIMAL}}};
+  auto decimal_info = GetCatalog()->CreateTable(GetTxn(), "decimal_keys", decimal_schema);
+  for (int32_t i = 0; i < 10; i++) {
+    RID decimal_rid;
+    ASSERT_TRUE(decimal_info->table_->InsertTuple(Tuple{{ValueFactory::GetDecimalValue(i)}, &decimal_schema},
+                                                  &decimal_rid, GetTxn()));
+  }
+  const Schema *decimal_scan_schema =
+      MakeOutputSchema({{"colD", MakeColumnValueExpression(decimal_schema, 0, "colD")}});
+  SeqScanPlanNode decimal_plan{decimal_scan_schema, nullptr, decimal_info->oid_};
+  auto mixed_predicate =
+      MakeComparisonExpression(MakeColumnValueExpression(*decimal_scan_schema, 0, "colD"),
+                               MakeColumnValueExpression(*scan_schema, 1, "colA"), ComparisonType::Equal);
+  const Schema *mixed_schema = MakeOutputSchema({{"rightA", MakeColumnValueExpression(*scan_schema, 1, "colA")}});
+  NestedLoopJoinPlanNode mixed_plan{mixed_schema, {&decimal_plan, &scan_plan}, mixed_predicate};
+  result_set.clear();
+  GetExecutionEngine()->Execute(&mixed_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(result_set.size(), 10);
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, SimpleAggregationTest) {
   // SELECT COUNT(colA), SUM(colA), min(colA), max(colA) from test_1;
@@ -600,6 +1153,66 @@ TEST_F(ExecutorTest, SimpleGroupByAggregation) {
   }
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, ParallelGroupByAggregation) {
+  // SELECT colB, count(colA), sum(colC), min(colA), max(colA) FROM test_1 Group By colB
+  // run serially and with 4 workers, both must agree
+  std::unique_ptr<AbstractPlanNode> scan_plan;
+  const Schema *scan_schema;
+  {
+    auto table_info = GetExecutorContext()->GetCatalog()->GetTable("test_1");
+    auto &schema = table_info->schema_;
+    auto colA = MakeColumnValueExpression(schema, 0, "colA");
+    auto colB = MakeColumnValueExpression(schema, 0, "colB");
+    auto colC = MakeColumnValueExpression(schema, 0, "colC");
+    scan_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}, {"colC", colC}});
+    scan_plan = std::make_unique<SeqScanPlanNode>(scan_schema, nullptr, table_info->oid_);
+  }
+
+  const Schema *agg_schema = nullptr;
+  auto make_agg_plan = [&](uint32_t parallelism) {
+    const AbstractExpression *colA = MakeColumnValueExpression(*scan_schema, 0, "colA");
+    const AbstractExpression *colB = MakeColumnValueExpression(*scan_schema, 0, "colB");
+    const AbstractExpression *colC = MakeColumnValueExpression(*scan_schema, 0, "colC");
+    std::vector<const AbstractExpression *> group_by_cols{colB};
+    std::vector<const AbstractExpression *> aggregate_cols{colA, colC, colA, colA};
+    std::vector<AggregationType> agg_types{AggregationType::CountAggregate, AggregationType::SumAggregate,
+                                           AggregationType::MinAggregate, AggregationType::MaxAggregate};
+    agg_schema = MakeOutputSchema({{"colB", MakeAggregateValueExpression(true, 0)},
+                                   {"countA", MakeAggregateValueExpression(false, 0)},
+                                   {"sumC", MakeAggregateValueExpression(false, 1)},
+                                   {"minA", MakeAggregateValueExpression(false, 2)},
+                                   {"maxA", MakeAggregateValueExpression(false, 3)}});
+    return std::make_unique<AggregationPlanNode>(agg_schema, scan_plan.get(), nullptr, std::move(group_by_cols),
+                                                 std::move(aggregate_cols), std::move(agg_types), parallelism);
+  };
+
+  auto run = [&](uint32_t parallelism) {
+    auto agg_plan = make_agg_plan(parallelism);
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(agg_plan.get(), &result_set, GetTxn(), GetExecutorContext());
+    std::map<int32_t, std::vector<int32_t>> groups;
+    for (const auto &tuple : result_set) {
+      auto colB = tuple.GetValue(agg_schema, 0).GetAs<int32_t>();
+      EXPECT_EQ(groups.count(colB), 0);
+      for (uint32_t i = 1; i < 5; i++) {
+        groups[colB].push_back(tuple.GetValue(agg_schema, i).GetAs<int32_t>());
+      }
+    }
+    return groups;
+  };
+
+  auto serial = run(1);
+  auto parallel = run(4);
+  ASSERT_EQ(serial.size(), 10);
+  ASSERT_EQ(serial, parallel);
+  int32_t total = 0;
+  for (const auto &group : parallel) {
+    total += group.second[0];
+  }
+  ASSERT_EQ(total, TEST1_SIZE);
+}
+
 // NOLINTNEXTLINE
 TEST_F(ExecutorTest, DyyLimitTest) {
   // SELECT colA, colB FROM test_1 WHERE colA < 500 limit 10 offset 100
@@ -689,4 +1302,73 @@ TEST_F(ExecutorTest, DyyIndexScan) {
   delete key_schema;
 }
 
+// NOLINTNEXTLINE
+TEST_F(ExecutorTest, IndexOnlyScanTest) {
+  // INSERT INTO empty_table2 VALUES (0, 0), (1, 1), ..., (999, 9)
+  std::vector<std::vector<Value>> raw_vals;
+  for (int32_t i = 0; i < 1000; i++) {
+    raw_vals.push_back({ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(i % 10)});
+  }
+  auto table_info = GetExecutorContext()->GetCatalog()->GetTable("empty_table2");
+  InsertPlanNode insert_plan{std::move(raw_vals), table_info->oid_};
+
+  // index1 on (colA, colB) covers the scan below, index2 on colA does not
+  Schema *covering_key_schema = ParseCreateStatement("a integer,b integer");
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  auto covering_index = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index1", "empty_table2", table_info->schema_, *covering_key_schema, {0, 1}, 8);
+  auto index = GetExecutorContext()->GetCatalog()->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      GetTxn(), "index2", "empty_table2", table_info->schema_, *key_schema, {0}, 8);
+  // The rows are committed, the scans below lock them
+  Transaction *insert_txn = GetTxnManager()->Begin();
+  ExecutorContext insert_ctx{insert_txn, GetCatalog(), GetBPM(), GetTxnManager(), GetLockManager()};
+  GetExecutionEngine()->Execute(&insert_plan, nullptr, insert_txn, &insert_ctx);
+  GetTxnManager()->Commit(insert_txn);
+  delete insert_txn;
+
+  // SELECT colA, colB FROM empty_table2 WHERE colB < 5, answered from the keys alone or from the heap
+  auto &schema = table_info->schema_;
+  auto colA = MakeColumnValueExpression(schema, 0, "colA");
+  auto colB = MakeColumnValueExpression(schema, 0, "colB");
+  auto const5 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(5));
+  auto predicate = MakeComparisonExpression(colB, const5, ComparisonType::LessThan);
+  auto out_schema = MakeOutputSchema({{"colA", colA}, {"colB", colB}});
+  for (auto index_info : {covering_index, index}) {
+    IndexScanPlanNode index_scan_plan{out_schema, predicate, index_info->index_oid_};
+    std::vector<Tuple> result_set;
+    GetExecutionEngine()->Execute(&index_scan_plan, &result_set, GetTxn(), GetExecutorContext());
+    ASSERT_EQ(result_set.size(), 500);
+    for (size_t i = 0; i < result_set.size(); i++) {
+      auto a = result_set[i].GetValue(out_schema, 0).GetAs<int32_t>();
+      ASSERT_EQ(a, i / 5 * 10 + i % 5);
+      ASSERT_EQ(result_set[i].GetValue(out_schema, 1).GetAs<int32_t>(), a % 10);
+    }
+  }
+
+  // With locking on, the index-only scan locks every row while the iterator latches its leaf. Nobody writes the
+  // rows, so each lock is granted right away and the table heap is never fetched.
+  std::vector<page_id_t> page_ids;
+  ASSERT_TRUE(table_info->table_->GetPageIds(GetTxn(), &page_ids));
+  std::vector<size_t> fetch_counts;
+  for (auto page_id : page_ids) {
+    fetch_counts.push_back(GetBPM()->GetFetchCount(page_id));
+  }
+  IndexScanPlanNode index_scan_plan{out_schema, predicate, covering_index->index_oid_};
+  std::vector<Tuple> result_set;
+  enable_logging = true;
+  GetExecutionEngine()->Execute(&index_scan_plan, &result_set, GetTxn(), GetExecutorContext());
+  enable_logging = false;
+  ASSERT_EQ(result_set.size(), 500);
+  for (size_t i = 0; i < page_ids.size(); i++) {
+    EXPECT_EQ(fetch_counts[i], GetBPM()->GetFetchCount(page_ids[i]));
+  }
+  LockMode table_mode;
+  ASSERT_TRUE(GetTxn()->IsTableLocked(table_info->oid_, &table_mode));
+  EXPECT_EQ(LockMode::INTENTION_SHARED, table_mode);
+  EXPECT_EQ(1000, GetTxn()->GetSharedLockSet()->size());
+
+  delete covering_key_schema;
+  delete key_schema;
+}
+
 }  // namespace bustub
@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
+#include <cstring>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "common/bustub_instance.h"
@@ -27,7 +31,7 @@
 namespace bustub {
 
 // NOLINTNEXTLINE
-TEST(RecoveryTest, DISABLED_RedoTest) {
+TEST(RecoveryTest, RedoTest) {
   remove("test.db");
   remove("test.log");
 
@@ -88,7 +92,8 @@ TEST(RecoveryTest, DISABLED_RedoTest) {
   delete txn;
 
   LOG_INFO("Begin recovery");
-  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
 
   ASSERT_FALSE(enable_logging);
 
@@ -122,7 +127,7 @@ TEST(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST(RecoveryTest, DISABLED_UndoTest) {
+TEST(RecoveryTest, UndoTest) {
   remove("test.db");
   remove("test.log");
   BustubInstance *bustub_instance = new BustubInstance("test.db");
@@ -177,7 +182,8 @@ TEST(RecoveryTest, DISABLED_UndoTest) {
   delete txn;
 
   LOG_INFO("Recovery started..");
-  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
 
   ASSERT_FALSE(enable_logging);
 
@@ -206,7 +212,7 @@ TEST(RecoveryTest, DISABLED_UndoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST(RecoveryTest, DISABLED_CheckpointTest) {
+TEST(RecoveryTest, CheckpointTest) {
   remove("test.db");
   remove("test.log");
   BustubInstance *bustub_instance = new BustubInstance("test.db");
@@ -234,6 +240,7 @@ TEST(RecoveryTest, DISABLED_CheckpointTest) {
   auto val_1 = tuple.GetValue(&schema, 1);
 
   // set log time out very high so that flush doesn't happen before checkpoint is performed
+  auto old_log_timeout = log_timeout;
   log_timeout = std::chrono::seconds(15);
 
   // insert a ton of tuples
@@ -302,6 +309,7 @@ TEST(RecoveryTest, DISABLED_CheckpointTest) {
   }
 
   EXPECT_TRUE(all_pages_lte);
+  log_timeout = old_log_timeout;
 
   delete txn;
   delete txn1;
@@ -314,4 +322,484 @@ TEST(RecoveryTest, DISABLED_CheckpointTest) {
   remove("test.db");
   remove("test.log");
 }
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, GroupCommitTest) {
+  remove("test.db");
+  remove("test.log");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+  // Commits must not wait for the periodic flush
+  auto old_log_timeout = log_timeout;
+  log_timeout = std::chrono::seconds(15);
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Each insert pins up to two pages, the threads must not exhaust the buffer pool
+  constexpr int num_threads = 4;
+  constexpr int num_txns_per_thread = 100;
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < num_txns_per_thread; j++) {
+        Transaction *txn = bustub_instance->transaction_manager_->Begin();
+        RID rid;
+        EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+        bustub_instance->transaction_manager_->Commit(txn);
+        // The commit record is on disk once Commit returns
+        EXPECT_LE(txn->GetPrevLSN(), bustub_instance->log_manager_->GetPersistentLSN());
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(bustub_instance->log_manager_->GetPersistentLSN(), bustub_instance->log_manager_->GetNextLSN() - 1);
+  // One write per commit at most, the commits arriving during a write share the next one
+  int num_flushes = bustub_instance->disk_manager_->GetNumFlushes();
+  EXPECT_LE(num_flushes, num_threads * num_txns_per_thread + 1);
+  LOG_INFO("%d commits in %d log writes", num_threads * num_txns_per_thread + 1, num_flushes);
+
+  // The log starts with the BEGIN record of the first transaction
+  char header[20];
+  ASSERT_TRUE(bustub_instance->disk_manager_->ReadLog(header, sizeof(header), 0));
+  int32_t size;
+  lsn_t lsn;
+  LogRecordType type;
+  memcpy(&size, header, sizeof(size));
+  memcpy(&lsn, header + 4, sizeof(lsn));
+  memcpy(&type, header + 16, sizeof(type));
+  EXPECT_EQ(size, 20);
+  EXPECT_EQ(lsn, 0);
+  EXPECT_EQ(type, LogRecordType::BEGIN);
+
+  log_timeout = old_log_timeout;
+  delete test_table;
+  delete bustub_instance;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, ConcurrentAppendTest) {
+  remove("test.db");
+  remove("test.log");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  LogManager *log_manager = bustub_instance->log_manager_;
+  log_manager->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Enough records to fill the buffers many times over
+  constexpr int num_threads = 8;
+  constexpr int num_records_per_thread = 2000;
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      lsn_t prev_lsn = INVALID_LSN;
+      for (int j = 0; j < num_records_per_thread; j++) {
+        LogRecord log_record = j % 2 == 0 ? LogRecord(i, prev_lsn, LogRecordType::INSERT, RID{i, 0}, tuple)
+                                          : LogRecord(i, prev_lsn, LogRecordType::BEGIN);
+        lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+        EXPECT_GT(lsn, prev_lsn);
+        prev_lsn = lsn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(log_manager->GetNextLSN(), num_threads * num_records_per_thread);
+  log_manager->Flush(log_manager->GetNextLSN() - 1);
+  EXPECT_EQ(log_manager->GetPersistentLSN(), log_manager->GetNextLSN() - 1);
+
+  // Every lsn was handed out once, and the records lie in the log in lsn order
+  int offset = 0;
+  lsn_t expected_lsn = 0;
+  char header[20];
+  while (bustub_instance->disk_manager_->ReadLog(header, sizeof(header), offset)) {
+    int32_t size;
+    lsn_t lsn;
+    memcpy(&size, header, sizeof(size));
+    memcpy(&lsn, header + 4, sizeof(lsn));
+    if (size == 0) {
+      break;
+    }
+    ASSERT_EQ(lsn, expected_lsn);
+    expected_lsn++;
+    offset += size;
+  }
+  EXPECT_EQ(expected_lsn, num_threads * num_records_per_thread);
+
+  delete bustub_instance;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, ParallelRedoTest) {
+  remove("test.db");
+  remove("test.log");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Many more pages than the buffer pool holds, so that some reach the disk before the crash and some do not
+  constexpr int num_committed = 2000;
+  constexpr int num_lost = 200;
+  Transaction *txn1 = bustub_instance->transaction_manager_->Begin();
+  std::vector<RID> rids(num_committed);
+  for (auto &rid : rids) {
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn1));
+  }
+  bustub_instance->transaction_manager_->Commit(txn1);
+  delete txn1;
+
+  // The loser inserts and deletes, and never commits. It crashes while rolling back its last insert.
+  Transaction *txn2 = bustub_instance->transaction_manager_->Begin();
+  RID rid2;
+  for (int i = 0; i < num_lost; i++) {
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid2, txn2));
+    ASSERT_TRUE(test_table->MarkDelete(rids[i * 7], txn2));
+  }
+  test_table->ApplyDelete(rid2, txn2);
+  delete txn2;
+  delete test_table;
+
+  LOG_INFO("System crash before commit");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+
+  // Exactly the committed tuples are back, also after a crash right after the recovery: the losers have their ABORT
+  // records by then, they are not undone twice
+  for (int round = 0; round < 2; round++) {
+    auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                         bustub_instance->log_manager_);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    delete log_recovery;
+
+    txn = bustub_instance->transaction_manager_->Begin();
+    test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                               bustub_instance->log_manager_, first_page_id);
+    int count = 0;
+    for (auto iter = test_table->Begin(txn); iter != test_table->End(); ++iter) {
+      count++;
+    }
+    EXPECT_EQ(count, num_committed);
+    for (int i = 0; i < num_lost; i++) {
+      Tuple old_tuple;
+      ASSERT_TRUE(test_table->GetTuple(rids[i * 7], &old_tuple, txn));
+    }
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+    delete test_table;
+
+    delete bustub_instance;
+    bustub_instance = new BustubInstance("test.db");
+  }
+
+  delete bustub_instance;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, FuzzyCheckpointTest) {
+  remove("test.db");
+  remove("test.log");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Checkpoints are taken while the inserters keep committing, none of them is blocked
+  constexpr int num_threads = 3;
+  constexpr int num_txns_per_thread = 40;
+  constexpr int num_inserts_per_txn = 10;
+  std::atomic<int> num_running{num_threads};
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < num_txns_per_thread; j++) {
+        Transaction *txn = bustub_instance->transaction_manager_->Begin();
+        for (int k = 0; k < num_inserts_per_txn; k++) {
+          RID rid;
+          EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+        }
+        bustub_instance->transaction_manager_->Commit(txn);
+        EXPECT_EQ(txn->GetState(), TransactionState::COMMITTED);
+        delete txn;
+      }
+      num_running--;
+    });
+  }
+  int num_checkpoints = 0;
+  while (num_running > 0 || num_checkpoints == 0) {
+    bustub_instance->checkpoint_manager_->BeginCheckpoint();
+    bustub_instance->checkpoint_manager_->EndCheckpoint();
+    num_checkpoints++;
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // The loser is running across the last checkpoint, its records are kept back to its BEGIN
+  Transaction *txn1 = bustub_instance->transaction_manager_->Begin();
+  constexpr int num_lost = 20;
+  for (int i = 0; i < num_lost; i++) {
+    RID rid;
+    ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn1));
+  }
+  bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+
+  // The log was truncated: it no longer starts with the first record
+  char header[20];
+  ASSERT_TRUE(bustub_instance->disk_manager_->ReadLog(header, sizeof(header), 0));
+  lsn_t first_lsn;
+  memcpy(&first_lsn, header + 4, sizeof(lsn_t));
+  EXPECT_GT(first_lsn, 0);
+  EXPECT_LE(first_lsn, txn1->GetBeginLSN());
+
+  LOG_INFO("System crash before commit");
+  delete txn1;
+  delete test_table;
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  // Exactly the committed tuples are back
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  int count = 0;
+  for (auto iter = test_table->Begin(txn); iter != test_table->End(); ++iter) {
+    count++;
+  }
+  EXPECT_EQ(count, num_threads * num_txns_per_thread * num_inserts_per_txn);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+
+  delete bustub_instance;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, WriteAfterRecoveryTest) {
+  remove("test.db");
+  remove("test.log");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // Each run commits some tuples, leaves a loser, writes its pages back and crashes
+  constexpr int num_committed = 50;
+  constexpr int num_lost = 10;
+  auto run = [&] {
+    Transaction *txn1 = bustub_instance->transaction_manager_->Begin();
+    for (int i = 0; i < num_committed; i++) {
+      RID rid;
+      ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn1));
+    }
+    bustub_instance->transaction_manager_->Commit(txn1);
+    delete txn1;
+    Transaction *txn2 = bustub_instance->transaction_manager_->Begin();
+    for (int i = 0; i < num_lost; i++) {
+      RID rid;
+      ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txn2));
+    }
+    std::vector<std::pair<page_id_t, lsn_t>> dirty_pages;
+    bustub_instance->buffer_pool_manager_->GetDirtyPageTable(&dirty_pages);
+    for (const auto &[page_id, rec_lsn] : dirty_pages) {
+      bustub_instance->buffer_pool_manager_->WriteBackPage(page_id);
+    }
+    delete txn2;
+    delete test_table;
+    LOG_INFO("System crash before commit");
+    delete bustub_instance;
+    bustub_instance = new BustubInstance("test.db");
+  };
+  auto recover = [&](int num_expected) {
+    auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                         bustub_instance->log_manager_);
+    log_recovery->Redo();
+    log_recovery->Undo();
+    delete log_recovery;
+
+    txn = bustub_instance->transaction_manager_->Begin();
+    test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                               bustub_instance->log_manager_, first_page_id);
+    int count = 0;
+    for (auto iter = test_table->Begin(txn); iter != test_table->End(); ++iter) {
+      count++;
+    }
+    EXPECT_EQ(count, num_expected);
+    bustub_instance->transaction_manager_->Commit(txn);
+    delete txn;
+  };
+
+  run();
+  recover(num_committed);
+  lsn_t next_lsn = bustub_instance->log_manager_->GetNextLSN();
+  EXPECT_GT(next_lsn, 0);
+  EXPECT_EQ(bustub_instance->log_manager_->GetPersistentLSN(), next_lsn - 1);
+
+  // The second run logs after the records of the first one, its pages carry larger lsns than those on disk, and the
+  // second recovery neither skips its records nor confuses them with those of the first run
+  bustub_instance->log_manager_->RunFlushThread();
+  run();
+  recover(2 * num_committed);
+  EXPECT_GT(bustub_instance->log_manager_->GetNextLSN(), next_lsn);
+
+  delete test_table;
+  delete bustub_instance;
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(RecoveryTest, LargeCheckpointTest) {
+  remove("test.db");
+  remove("test.log");
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // More active transactions than one CHECKPOINT record of a log buffer can list, the first one is a loser
+  constexpr int num_txns = LOG_BUFFER_SIZE / 8 + 1;
+  std::vector<Transaction *> txns(num_txns);
+  for (auto &active : txns) {
+    active = bustub_instance->transaction_manager_->Begin();
+  }
+  RID rid;
+  ASSERT_TRUE(test_table->InsertTuple(tuple, &rid, txns[0]));
+  bustub_instance->checkpoint_manager_->BeginCheckpoint();
+  bustub_instance->checkpoint_manager_->EndCheckpoint();
+  for (int i = 1; i < num_txns; i++) {
+    bustub_instance->transaction_manager_->Commit(txns[i]);
+  }
+  bustub_instance->log_manager_->Flush(bustub_instance->log_manager_->GetNextLSN() - 1);
+
+  // The checkpoint went over several records, each fitting in a log buffer
+  int offset = 0;
+  int num_checkpoints = 0;
+  char header[20];
+  while (bustub_instance->disk_manager_->ReadLog(header, sizeof(header), offset)) {
+    int32_t size;
+    LogRecordType type;
+    memcpy(&size, header, sizeof(size));
+    memcpy(&type, header + 16, sizeof(type));
+    if (size == 0) {
+      break;
+    }
+    if (type == LogRecordType::CHECKPOINT) {
+      EXPECT_LE(size, LOG_BUFFER_SIZE);
+      num_checkpoints++;
+    }
+    offset += size;
+  }
+  EXPECT_GE(num_checkpoints, 2);
+
+  LOG_INFO("System crash before commit");
+  for (auto active : txns) {
+    delete active;
+  }
+  delete test_table;
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_,
+                                       bustub_instance->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  // The loser's tuple is gone
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  EXPECT_EQ(test_table->Begin(txn), test_table->End());
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+
+  delete bustub_instance;
+  remove("test.db");
+  remove("test.log");
+}
 }  // namespace bustub
@@ -21,6 +21,7 @@
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +72,303 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, FreeSpaceMapTest) {
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::INTEGER};
+  Schema schema{{col1, col2}};
+  Tuple tuple{{ValueFactory::GetIntegerValue(1), ValueFactory::GetIntegerValue(2)}, &schema};
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(50, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *insert_txn = new Transaction(0);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, insert_txn);
+
+  // A bulk load fills every page before appending the next one.
+  std::vector<RID> rid_v;
+  for (int i = 0; i < 2000; ++i) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, insert_txn));
+    rid_v.push_back(rid);
+  }
+  std::vector<page_id_t> page_ids;
+  ASSERT_TRUE(table->GetPageIds(insert_txn, &page_ids));
+  ASSERT_GT(page_ids.size(), 2);
+  for (size_t i = 0; i + 1 < page_ids.size(); i++) {
+    auto page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(page_ids[i]));
+    EXPECT_LT(page->GetFreeSpaceRemaining(), TablePage::SpaceNeeded(tuple.GetLength()));
+    buffer_pool_manager->UnpinPage(page_ids[i], false);
+  }
+
+  // Space freed in the middle of the table is reused before the tail grows.
+  auto hole_page_id = page_ids[1];
+  size_t deleted = 0;
+  for (const auto &rid : rid_v) {
+    if (rid.GetPageId() == hole_page_id) {
+      ASSERT_TRUE(table->MarkDelete(rid, insert_txn));
+      table->ApplyDelete(rid, insert_txn);
+      deleted++;
+    }
+  }
+  auto *reinsert_txn = new Transaction(1);
+  for (size_t i = 0; i < deleted; i++) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, reinsert_txn));
+    EXPECT_EQ(hole_page_id, rid.GetPageId());
+  }
+  std::vector<page_id_t> reinsert_page_ids;
+  ASSERT_TRUE(table->GetPageIds(reinsert_txn, &reinsert_page_ids));
+  EXPECT_EQ(page_ids, reinsert_page_ids);
+
+  disk_manager->ShutDown();
+  remove("test.db");  // remove db file
+  remove("test.log");
+  delete reinsert_txn;
+  delete insert_txn;
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, InsertSkipsLockedSlotTest) {
+  Column col1{"a", TypeId::INTEGER};
+  Schema schema{{col1}};
+  Tuple tuple{{ValueFactory::GetIntegerValue(1)}, &schema};
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(50, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *insert_txn = new Transaction(0);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, insert_txn);
+
+  std::vector<RID> rid_v(3);
+  for (auto &rid : rid_v) {
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, insert_txn));
+  }
+  ASSERT_TRUE(table->MarkDelete(rid_v[1], insert_txn));
+  table->ApplyDelete(rid_v[1], insert_txn);
+
+  // The freed slot is still locked, e.g. by the purge that freed it: the insert must not wait for it under the
+  // page latch, it takes a new slot of the same page instead.
+  auto *holder_txn = new Transaction(1);
+  ASSERT_TRUE(lock_manager->LockExclusive(holder_txn, rid_v[1]));
+  auto *reinsert_txn = new Transaction(2);
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, reinsert_txn));
+  EXPECT_EQ(rid_v[1].GetPageId(), rid.GetPageId());
+  EXPECT_EQ(3, rid.GetSlotNum());
+  EXPECT_TRUE(reinsert_txn->IsExclusiveLocked(rid));
+
+  // Once unlocked, the slot is reused.
+  ASSERT_TRUE(lock_manager->Unlock(holder_txn, rid_v[1]));
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, reinsert_txn));
+  EXPECT_EQ(rid_v[1], rid);
+  EXPECT_TRUE(reinsert_txn->IsExclusiveLocked(rid));
+
+  disk_manager->ShutDown();
+  remove("test.db");  // remove db file
+  remove("test.log");
+  delete reinsert_txn;
+  delete holder_txn;
+  delete insert_txn;
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, TableCursorTest) {
+  Column col1{"a", TypeId::INTEGER};
+  Column col2{"b", TypeId::INTEGER};
+  Schema schema{{col1, col2}};
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(50, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+
+  std::vector<RID> rid_v;
+  for (int i = 0; i < 1000; ++i) {
+    Tuple tuple{{ValueFactory::GetIntegerValue(i), ValueFactory::GetIntegerValue(-i)}, &schema};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+    rid_v.push_back(rid);
+  }
+  // Every third tuple is gone.
+  for (size_t i = 0; i < rid_v.size(); i += 3) {
+    ASSERT_TRUE(table->MarkDelete(rid_v[i], txn));
+  }
+
+  // The cursor visits the live tuples in order, reading them in place or copying them out.
+  {
+    TableCursor cursor(table, table->GetFirstPageId());
+    for (size_t i = 0; i < rid_v.size(); i++) {
+      if (i % 3 == 0) {
+        continue;
+      }
+      ASSERT_TRUE(cursor.Advance());
+      EXPECT_EQ(rid_v[i], cursor.GetRid());
+      TupleView view;
+      cursor.RLatch();
+      ASSERT_TRUE(cursor.GetTupleView(&view));
+      EXPECT_EQ(schema.GetLength(), view.GetLength());
+      EXPECT_EQ(static_cast<int32_t>(i), view.GetValue(&schema, 0).GetAs<int32_t>());
+      cursor.RUnlatch();
+      Tuple tuple;
+      ASSERT_TRUE(cursor.GetTuple(&tuple, txn));
+      EXPECT_EQ(-static_cast<int32_t>(i), tuple.GetValue(&schema, 1).GetAs<int32_t>());
+    }
+    EXPECT_FALSE(cursor.Advance());
+  }
+
+  // A page range stops in front of its stop page, and a filter skips tuples in place.
+  std::vector<page_id_t> page_ids;
+  ASSERT_TRUE(table->GetPageIds(txn, &page_ids));
+  ASSERT_GT(page_ids.size(), 1);
+  {
+    TableCursor cursor(table, page_ids[0], page_ids[1],
+                       [](const char *data) { return *reinterpret_cast<const int32_t *>(data) % 2 == 0; });
+    size_t count = 0;
+    while (cursor.Advance()) {
+      EXPECT_EQ(page_ids[0], cursor.GetRid().GetPageId());
+      count++;
+    }
+    size_t expected = 0;
+    for (size_t i = 0; i < rid_v.size(); i++) {
+      expected += rid_v[i].GetPageId() == page_ids[0] && i % 3 != 0 && i % 2 == 0 ? 1 : 0;
+    }
+    EXPECT_EQ(expected, count);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");  // remove db file
+  remove("test.log");
+  delete txn;
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, UnfetchablePageTest) {
+  Column col1{"a", TypeId::INTEGER};
+  Schema schema{{col1}};
+  Tuple tuple{{ValueFactory::GetIntegerValue(1)}, &schema};
+
+  const size_t pool_size = 3;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(pool_size, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+  std::vector<page_id_t> page_ids;
+  while (page_ids.size() < 2 * pool_size) {
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+    ASSERT_TRUE(table->GetPageIds(txn, &page_ids));
+  }
+
+  // With every frame pinned elsewhere the pages of the table cannot be fetched: the walks fail and abort the
+  // transaction instead of reading through an empty guard.
+  std::vector<page_id_t> pinned(pool_size);
+  for (auto &page_id : pinned) {
+    ASSERT_NE(nullptr, buffer_pool_manager->NewPage(&page_id));
+  }
+  auto *scan_txn = new Transaction(1);
+  EXPECT_FALSE(table->GetPageIds(scan_txn, &page_ids));
+  EXPECT_TRUE(page_ids.empty());
+  EXPECT_EQ(TransactionState::ABORTED, scan_txn->GetState());
+  auto *begin_txn = new Transaction(2);
+  EXPECT_TRUE(table->Begin(begin_txn) == table->End());
+  EXPECT_EQ(TransactionState::ABORTED, begin_txn->GetState());
+
+  for (auto page_id : pinned) {
+    buffer_pool_manager->UnpinPage(page_id, false);
+  }
+  EXPECT_TRUE(table->GetPageIds(txn, &page_ids));
+  EXPECT_EQ(2 * pool_size, page_ids.size());
+
+  disk_manager->ShutDown();
+  remove("test.db");  // remove db file
+  remove("test.log");
+  delete begin_txn;
+  delete scan_txn;
+  delete txn;
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, TupleViewTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::BIGINT};
+  Column col3{"c", TypeId::VARCHAR, 16};
+  Schema schema{{col1, col2, col3}};
+  Tuple tuple{{ValueFactory::GetVarcharValue("hello"), ValueFactory::GetBigIntValue(42),
+               ValueFactory::GetVarcharValue("world")},
+              &schema};
+
+  // A view reads the same values as the tuple it points to, without copying it.
+  TupleView view = tuple.GetView();
+  EXPECT_EQ(tuple.GetData(), view.GetData());
+  for (uint32_t i = 0; i < schema.GetColumnCount(); i++) {
+    EXPECT_EQ(CmpBool::CmpTrue, view.GetValue(&schema, i).CompareEquals(tuple.GetValue(&schema, i)));
+  }
+
+  // Borrowing shares the memory, constructing from a view copies it.
+  Tuple borrowed = Tuple::Borrow(view);
+  EXPECT_FALSE(borrowed.IsAllocated());
+  EXPECT_EQ(tuple.GetData(), borrowed.GetData());
+  Tuple copied{view};
+  EXPECT_TRUE(copied.IsAllocated());
+  EXPECT_NE(tuple.GetData(), copied.GetData());
+  EXPECT_EQ("world", copied.GetValue(&schema, 2).ToString());
+
+  // A table tuple is visited in its page.
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManager(50, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *txn = new Transaction(0);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+  RID rid;
+  ASSERT_TRUE(table->InsertTuple(tuple, &rid, txn));
+  bool visited = false;
+  EXPECT_TRUE(table->VisitTuple(rid, txn, [&](const TupleView &page_view) {
+    visited = true;
+    EXPECT_EQ(rid, page_view.GetRid());
+    EXPECT_EQ(tuple.GetLength(), page_view.GetLength());
+    EXPECT_EQ("hello", page_view.GetValue(&schema, 0).ToString());
+  }));
+  EXPECT_TRUE(visited);
+  ASSERT_TRUE(table->MarkDelete(rid, txn));
+  EXPECT_FALSE(table->VisitTuple(rid, txn, [&](const TupleView &page_view) { FAIL(); }));
+
+  disk_manager->ShutDown();
+  remove("test.db");  // remove db file
+  remove("test.log");
+  delete txn;
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
 }  // namespace bustub